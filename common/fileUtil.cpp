@@ -0,0 +1,135 @@
+//
+// Small file helpers shared by the frame writers.
+//
+
+#include <algorithm>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fileUtil.h"
+
+bool writeFileV(const char *fileName,
+                const struct iovec *pieces,
+                int numPieces)
+{
+    int fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "open('%s') failed: %d\n", fileName, errno);
+        return false;
+    }
+
+    std::vector<struct iovec> remaining(pieces, pieces + numPieces);
+    size_t first = 0;
+    bool ok = true;
+
+    while (first < remaining.size())
+    {
+        int count = (int)std::min<size_t>(remaining.size() - first, IOV_MAX);
+        ssize_t written = writev(fd, &remaining[first], count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "writev('%s') failed: %d\n", fileName, errno);
+            ok = false;
+            break;
+        }
+
+        // Skip the pieces that were written completely and trim the
+        // one that was only partly written.
+        while (first < remaining.size() &&
+               (size_t)written >= remaining[first].iov_len)
+        {
+            written -= remaining[first].iov_len;
+            ++first;
+        }
+        if (first < remaining.size())
+        {
+            remaining[first].iov_base = (char *)remaining[first].iov_base + written;
+            remaining[first].iov_len -= written;
+        }
+    }
+
+    if (close(fd) != 0 && ok)
+    {
+        fprintf(stderr, "close('%s') failed: %d\n", fileName, errno);
+        ok = false;
+    }
+
+    return ok;
+}
+
+
+bool syncFile(const std::string &fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0 || fsync(fd) != 0)
+    {
+        fprintf(stderr, "fsync('%s') failed: %d\n", fileName.c_str(), errno);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    close(fd);
+
+    size_t slash = fileName.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : fileName.substr(0, slash + 1);
+    int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0 || fsync(dirFd) != 0)
+    {
+        fprintf(stderr, "fsync('%s') failed: %d\n", dir.c_str(), errno);
+        if (dirFd >= 0)
+            close(dirFd);
+        return false;
+    }
+    close(dirFd);
+
+    return true;
+}
+
+
+bool readFileRange(const std::string &fileName,
+                   size_t offset,
+                   void *buffer,
+                   size_t numBytes,
+                   size_t &fileSize)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    fileSize = ok ? info.st_size : 0;
+
+    size_t done = 0;
+    while (ok && done < numBytes)
+    {
+        ssize_t got = pread(fd, (char *)buffer + done, numBytes - done, offset + done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            ok = false;
+        else
+            done += got;
+    }
+
+    close(fd);
+    return ok;
+}
+
+
+bool ensureDirectory(const std::string &dir)
+{
+    if (dir.empty() || mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST)
+        return true;
+
+    fprintf(stderr, "mkdir('%s') failed: %d\n", dir.c_str(), errno);
+    return false;
+}
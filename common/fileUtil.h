@@ -0,0 +1,52 @@
+//
+// Small file helpers shared by the frame writers.
+//
+
+#ifndef OSPRAY_DEMOS_FILE_UTIL_H
+#define OSPRAY_DEMOS_FILE_UTIL_H
+
+#include <string>
+#include <sys/uio.h>
+
+//
+// Create or truncate fileName and write the given pieces to it with
+// writev, retrying partial writes. Returns false (after printing why)
+// on failure.
+//
+bool writeFileV(const char *fileName,
+                const struct iovec *pieces,
+                int numPieces);
+
+//
+// Create dir if it doesn't exist yet. Parent directories are not
+// created.
+//
+bool ensureDirectory(const std::string &dir);
+
+//
+// Flush fileName and its directory entry to disk, so it survives a
+// crash of the machine.
+//
+bool syncFile(const std::string &fileName);
+
+//
+// Read up to numBytes from offset of fileName into buffer and report
+// the file's size. Returns false if the file can't be read.
+//
+bool readFileRange(const std::string &fileName,
+                   size_t offset,
+                   void *buffer,
+                   size_t numBytes,
+                   size_t &fileSize);
+
+//
+// Where the time spent writing one frame file went: turning pixels
+// into the file's encoding, and getting the bytes out.
+//
+struct FileWriteTimes
+{
+    double convert;
+    double write;
+};
+
+#endif
@@ -0,0 +1,107 @@
+//
+// A content-addressed cache of rendered frames on local disk.
+//
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "frameCache.h"
+#include "fileUtil.h"
+
+uint64_t fnv1a(const void *bytes, size_t numBytes, uint64_t hash)
+{
+    const unsigned char *byte = (const unsigned char *)bytes;
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= byte[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+FrameCache::FrameCache(const std::string &dir)
+    : dir(dir),
+      usable(ensureDirectory(dir))
+{}
+
+
+std::string FrameCache::fileName(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".frame", key);
+    return dir + "/" + name;
+}
+
+
+bool FrameCache::load(uint64_t key, void *pixels, size_t numBytes) const
+{
+    if (!usable)
+        return false;
+
+    std::string name = fileName(key);
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // A frame of another size is from different framebuffer settings
+    // that happened to collide; treat it as a miss.
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && (size_t)info.st_size == numBytes;
+
+    char *out = (char *)pixels;
+    size_t done = 0;
+    while (ok && done < numBytes)
+    {
+        ssize_t got = read(fd, out + done, numBytes - done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+        {
+            fprintf(stderr, "read('%s') failed: %d\n", name.c_str(), errno);
+            ok = false;
+            break;
+        }
+        done += got;
+    }
+
+    close(fd);
+    return ok;
+}
+
+
+bool FrameCache::store(uint64_t key, const void *pixels, size_t numBytes) const
+{
+    if (!usable)
+        return false;
+
+    // Temporary names are unique per process and call, so concurrent
+    // writers of the same key each rename a complete file into place.
+    static std::atomic<unsigned> counter(0);
+    std::string name = fileName(key);
+    char suffix[48];
+    snprintf(suffix, sizeof(suffix), ".%ld.%u.tmp", (long)getpid(), counter++);
+    std::string tempName = name + suffix;
+
+    struct iovec piece = {(void *)pixels, numBytes};
+    if (!writeFileV(tempName.c_str(), &piece, 1))
+    {
+        unlink(tempName.c_str());
+        return false;
+    }
+
+    if (rename(tempName.c_str(), name.c_str()) != 0)
+    {
+        fprintf(stderr, "rename('%s', '%s') failed: %d\n",
+                tempName.c_str(), name.c_str(), errno);
+        unlink(tempName.c_str());
+        return false;
+    }
+
+    return true;
+}
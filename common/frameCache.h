@@ -0,0 +1,60 @@
+//
+// A content-addressed cache of rendered frames on local disk.
+//
+
+#ifndef OSPRAY_DEMOS_FRAME_CACHE_H
+#define OSPRAY_DEMOS_FRAME_CACHE_H
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// 64 bit FNV-1a hash of bytes. Pass a previous result as hash to
+// extend it with more data.
+//
+const uint64_t FNV1A_OFFSET = 14695981039346656037ULL;
+
+uint64_t fnv1a(const void *bytes, size_t numBytes, uint64_t hash = FNV1A_OFFSET);
+
+inline uint64_t fnv1a(const std::string &str, uint64_t hash = FNV1A_OFFSET)
+{
+    return fnv1a(str.data(), str.size(), hash);
+}
+
+//
+// Raw framebuffer contents stored by key, one file per frame named
+// after the key. The caller decides what goes into a key; anything
+// that changes the image has to be part of it. Files are written under
+// a temporary name and renamed into place, so an interrupted or
+// concurrent run never leaves a partial frame behind.
+//
+class FrameCache
+{
+  public:
+    //
+    // Use dir as the cache, creating it if needed. Check ok() after.
+    //
+    explicit FrameCache(const std::string &dir);
+
+    bool ok() const { return usable; }
+
+    //
+    // Fill pixels with the frame stored under key. Returns false if
+    // there is none, or if the stored frame is not numBytes long.
+    //
+    bool load(uint64_t key, void *pixels, size_t numBytes) const;
+
+    //
+    // Store numBytes of pixels under key, replacing any earlier frame.
+    //
+    bool store(uint64_t key, const void *pixels, size_t numBytes) const;
+
+  private:
+    std::string fileName(uint64_t key) const;
+
+    std::string dir;
+    bool        usable;
+};
+
+#endif
@@ -0,0 +1,67 @@
+//
+// A progress journal for resuming interrupted movie renders.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "frameJournal.h"
+
+FrameJournal::FrameJournal(const std::string &fileName)
+    : fileName(fileName),
+      fd(-1)
+{
+    // Lines without their newline were torn by a crash and are ignored.
+    FILE *file = fopen(fileName.c_str(), "r");
+    if (file)
+    {
+        char line[64];
+        int frameIdx;
+        char newline;
+        while (fgets(line, sizeof(line), file))
+        {
+            if (sscanf(line, "frame %d%c", &frameIdx, &newline) != 2 ||
+                newline != '\n' || frameIdx < 0)
+                continue;
+            if ((size_t)frameIdx >= done.size())
+                done.resize(frameIdx + 1, 0);
+            done[frameIdx] = 1;
+        }
+        fclose(file);
+    }
+
+    fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+        fprintf(stderr, "open('%s') failed: %d\n", fileName.c_str(), errno);
+}
+
+
+FrameJournal::~FrameJournal()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+
+bool FrameJournal::contains(int frameIdx) const
+{
+    return frameIdx >= 0 && (size_t)frameIdx < done.size() && done[frameIdx];
+}
+
+
+bool FrameJournal::record(int frameIdx)
+{
+    if (fd < 0)
+        return false;
+
+    char line[32];
+    int lineBytes = snprintf(line, sizeof(line), "frame %d\n", frameIdx);
+    if (write(fd, line, lineBytes) != lineBytes || fdatasync(fd) != 0)
+    {
+        fprintf(stderr, "Writing to journal '%s' failed: %d\n", fileName.c_str(), errno);
+        return false;
+    }
+    return true;
+}
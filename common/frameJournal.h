@@ -0,0 +1,53 @@
+//
+// A progress journal for resuming interrupted movie renders.
+//
+
+#ifndef OSPRAY_DEMOS_FRAME_JOURNAL_H
+#define OSPRAY_DEMOS_FRAME_JOURNAL_H
+
+#include <string>
+#include <vector>
+
+//
+// An append-only file with one "frame N" line per frame that is safely
+// on disk. A frame is only recorded after its file has been synced, so
+// after a crash the journal never lists a frame that was lost; at
+// worst it misses the last few that did make it.
+//
+// Several processes may record into one journal at once: every line
+// goes out in a single O_APPEND write.
+//
+class FrameJournal
+{
+  public:
+    //
+    // Open fileName, creating it if needed, and read the frames earlier
+    // runs recorded. Check ok() after.
+    //
+    explicit FrameJournal(const std::string &fileName);
+    ~FrameJournal();
+
+    FrameJournal(const FrameJournal &) = delete;
+    FrameJournal &operator=(const FrameJournal &) = delete;
+
+    bool ok() const { return fd >= 0; }
+
+    //
+    // Whether an earlier run recorded frame frameIdx. Frames recorded
+    // by this run aren't included, so this is safe to call while
+    // another thread records.
+    //
+    bool contains(int frameIdx) const;
+
+    //
+    // Append frameIdx and flush it to disk.
+    //
+    bool record(int frameIdx);
+
+  private:
+    std::string       fileName;
+    int               fd;
+    std::vector<char> done;
+};
+
+#endif
@@ -0,0 +1,365 @@
+//
+// Frame sinks: where the movie demos send their rendered frames.
+//
+
+#include <chrono>
+#include <vector>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frameSink.h"
+#include "fileUtil.h"
+#include "pfmFile.h"
+#include "pngFile.h"
+#include "ppmFile.h"
+#include "yuvConvert.h"
+
+namespace {
+
+uint32_t getBigEndian(const unsigned char *bytes)
+{
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 |
+           (uint32_t)bytes[2] << 8 | (uint32_t)bytes[3];
+}
+
+
+//
+// A sink writing one file per frame, <dir>/frame_<index>.<ext>.
+//
+class FileSink : public FrameSink
+{
+  public:
+    FileSink(const std::string &dir, const char *ext)
+        : dir(dir),
+          ext(ext)
+    {}
+
+    bool sync(int frameIdx) override
+    {
+        return syncFile(fileName(frameIdx));
+    }
+
+  protected:
+    std::string fileName(int frameIdx) const
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "frame_%i.%s", frameIdx, ext);
+        return dir.empty() ? std::string(name) : dir + "/" + name;
+    }
+
+    //
+    // Whether the frame file starts with header and is exactly
+    // fileBytes long.
+    //
+    bool hasHeader(int frameIdx, const std::string &header, size_t fileBytes) const
+    {
+        std::vector<char> head(header.size());
+        size_t size = 0;
+        return readFileRange(fileName(frameIdx), 0, head.data(), head.size(), size) &&
+               size == fileBytes &&
+               memcmp(head.data(), header.data(), head.size()) == 0;
+    }
+
+  private:
+    std::string dir;
+    const char *ext;
+};
+
+
+class PPMSink : public FileSink
+{
+  public:
+    PPMSink(const std::string &dir)
+        : FileSink(dir, "ppm")
+    {}
+
+    void writeFrame(const Frame &frame) override
+    {
+        writePPM(fileName(frame.frameIdx).c_str(),
+                 frame.width, frame.height, (const uint32_t *)frame.pixels,
+                 &times);
+    }
+
+    bool verifyFrame(int frameIdx, int width, int height) const override
+    {
+        char header[64];
+        snprintf(header, sizeof(header), "P6\n%i %i\n255\n", width, height);
+        return hasHeader(frameIdx, header, strlen(header) + 3 * (size_t)width * height + 1);
+    }
+};
+
+
+class PFMSink : public FileSink
+{
+  public:
+    PFMSink(const std::string &dir)
+        : FileSink(dir, "pfm")
+    {}
+
+    FramePixelFormat format() const override { return FRAME_RGBA32F; }
+
+    void writeFrame(const Frame &frame) override
+    {
+        writePFM(fileName(frame.frameIdx).c_str(),
+                 frame.width, frame.height, (const float *)frame.pixels,
+                 &times);
+    }
+
+    bool verifyFrame(int frameIdx, int width, int height) const override
+    {
+        char header[64];
+        snprintf(header, sizeof(header), "PF\n%i %i\n-1.0\n", width, height);
+        return hasHeader(frameIdx, header,
+                         strlen(header) + 3 * sizeof(float) * (size_t)width * height);
+    }
+};
+
+
+class PNGSink : public FileSink
+{
+  public:
+    PNGSink(const std::string &dir, int level, int numThreads)
+        : FileSink(dir, "png"),
+          level(level),
+          numThreads(numThreads)
+    {}
+
+    void writeFrame(const Frame &frame) override
+    {
+        writePNG(fileName(frame.frameIdx).c_str(),
+                 frame.width, frame.height, (const uint32_t *)frame.pixels,
+                 level, numThreads, &times);
+    }
+
+    //
+    // writePNG puts out the signature, IHDR, one IDAT chunk and IEND,
+    // so the IDAT length gives the exact file size.
+    //
+    bool verifyFrame(int frameIdx, int width, int height) const override
+    {
+        static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        const size_t headBytes = 8 + 25 + 8;
+
+        unsigned char head[headBytes];
+        size_t size = 0;
+        std::string name = fileName(frameIdx);
+        if (!readFileRange(name, 0, head, headBytes, size) ||
+            memcmp(head, signature, 8) != 0 ||
+            memcmp(head + 12, "IHDR", 4) != 0 ||
+            getBigEndian(head + 16) != (uint32_t)width ||
+            getBigEndian(head + 20) != (uint32_t)height ||
+            memcmp(head + 37, "IDAT", 4) != 0 ||
+            size != headBytes + getBigEndian(head + 33) + 4 + 12)
+            return false;
+
+        unsigned char iend[8];
+        return readFileRange(name, size - 8, iend, sizeof(iend), size) &&
+               memcmp(iend, "IEND", 4) == 0;
+    }
+
+  private:
+    int level;
+    int numThreads;
+};
+
+
+class NullSink : public FrameSink
+{
+  public:
+    void writeFrame(const Frame &) override {}
+};
+
+
+//
+// Streams every frame into a single YUV4MPEG2 file or pipe. YUV 4:2:0
+// takes half the bytes of RGB, and piping straight into an encoder
+// avoids writing and re-reading intermediate frame files.
+//
+class Y4MSink : public FrameSink
+{
+  public:
+    Y4MSink(FILE *stream, bool isPipe)
+        : stream(stream),
+          isPipe(isPipe),
+          width(0),
+          height(0),
+          failed(false)
+    {}
+
+    ~Y4MSink() override
+    {
+        if (isPipe)
+        {
+            int status = pclose(stream);
+            if (status != 0)
+                fprintf(stderr, "y4m sink: encoder exited with status %d\n", status);
+        }
+        else
+        {
+            fclose(stream);
+        }
+    }
+
+    void writeFrame(const Frame &frame) override
+    {
+        if (failed)
+            return;
+
+        if (width == 0)
+        {
+            width  = frame.width;
+            height = frame.height;
+            fprintf(stream, "YUV4MPEG2 W%i H%i F%i:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+                    width, height, framesPerSecond);
+        }
+        else if (frame.width != width || frame.height != height)
+        {
+            fprintf(stderr, "y4m sink: frame size changed mid-stream\n");
+            failed = true;
+            return;
+        }
+
+        static const char frameHeader[] = "FRAME\n";
+        const size_t headerBytes = sizeof(frameHeader) - 1;
+        const size_t lumaBytes   = (size_t)width * height;
+        const size_t chromaBytes = (size_t)chromaWidth(width) * chromaHeight(height);
+
+        buffer.resize(headerBytes + lumaBytes + 2 * chromaBytes);
+        unsigned char *y = buffer.data() + headerBytes;
+        unsigned char *u = y + lumaBytes;
+        unsigned char *v = u + chromaBytes;
+
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+
+        memcpy(buffer.data(), frameHeader, headerBytes);
+        convertYUV420Flipped((const uint32_t *)frame.pixels, width, height, y, u, v);
+        Clock::time_point converted = Clock::now();
+
+        if (fwrite(buffer.data(), 1, buffer.size(), stream) != buffer.size())
+        {
+            fprintf(stderr, "y4m sink: write failed: %d\n", errno);
+            failed = true;
+        }
+
+        times.convert = std::chrono::duration<double>(converted - start).count();
+        times.write   = std::chrono::duration<double>(Clock::now() - converted).count();
+    }
+
+  private:
+    static const int framesPerSecond = 25;
+
+    FILE                      *stream;
+    bool                       isPipe;
+    int                        width;
+    int                        height;
+    bool                       failed;
+    std::vector<unsigned char> buffer;
+};
+
+std::unique_ptr<FrameSink> createY4MSink(const std::string &target)
+{
+    if (target.empty())
+    {
+        fprintf(stderr, "The y4m sink needs a target: y4m:FILE or y4m:|COMMAND\n");
+        return nullptr;
+    }
+
+    if (target[0] == '|')
+    {
+        // Report a dead encoder as a failed write rather than dying
+        // from SIGPIPE.
+        signal(SIGPIPE, SIG_IGN);
+
+        FILE *pipe = popen(target.c_str() + 1, "w");
+        if (pipe == nullptr)
+        {
+            fprintf(stderr, "popen('%s') failed: %d\n", target.c_str() + 1, errno);
+            return nullptr;
+        }
+        return std::unique_ptr<FrameSink>(new Y4MSink(pipe, true));
+    }
+
+    FILE *file = fopen(target.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "fopen('%s', 'wb') failed: %d\n", target.c_str(), errno);
+        return nullptr;
+    }
+    return std::unique_ptr<FrameSink>(new Y4MSink(file, false));
+}
+
+}
+
+
+size_t framePixelBytes(FramePixelFormat format)
+{
+    return format == FRAME_RGBA32F ? 4 * sizeof(float) : 4;
+}
+
+
+std::unique_ptr<FrameSink> createFrameSink(const std::string &spec,
+                                           const std::string &dir)
+{
+    std::string kind = spec.substr(0, spec.find(':'));
+    std::string args = kind.size() < spec.size() ? spec.substr(kind.size() + 1) : "";
+
+    if (kind == "null")
+        return std::unique_ptr<FrameSink>(new NullSink());
+    if (kind == "y4m")
+        return createY4MSink(args);
+
+    if (kind != "ppm" && kind != "pfm" && kind != "png")
+    {
+        fprintf(stderr, "Unknown frame sink '%s' (expected ppm, pfm, "
+                "png[:level[:threads]], y4m:TARGET or null)\n", spec.c_str());
+        return nullptr;
+    }
+
+    if (!ensureDirectory(dir))
+        return nullptr;
+
+    if (kind == "ppm")
+        return std::unique_ptr<FrameSink>(new PPMSink(dir));
+    if (kind == "pfm")
+        return std::unique_ptr<FrameSink>(new PFMSink(dir));
+
+    int level = 1;
+    int numThreads = 0;
+    if (sscanf(args.c_str(), "%d:%d", &level, &numThreads) < 1 && !args.empty())
+    {
+        fprintf(stderr, "Bad png sink options '%s'\n", args.c_str());
+        return nullptr;
+    }
+    if (level < 0 || level > 9)
+    {
+        fprintf(stderr, "png compression level must be 0-9, got %d\n", level);
+        return nullptr;
+    }
+    return std::unique_ptr<FrameSink>(new PNGSink(dir, level, numThreads));
+}
+
+
+bool isStreamingFrameSink(const std::string &spec)
+{
+    return spec.compare(0, spec.find(':'), "y4m") == 0;
+}
+
+
+FrameSinkOptions parseFrameSinkOptions(int argc, const char **argv)
+{
+    FrameSinkOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--sink") == 0 && i + 1 < argc)
+            options.spec = argv[++i];
+        else if (strcmp(argv[i], "--frames-dir") == 0 && i + 1 < argc)
+            options.dir = argv[++i];
+    }
+
+    return options;
+}
@@ -0,0 +1,127 @@
+//
+// Frame sinks: where the movie demos send their rendered frames.
+//
+// A sink is chosen at runtime from a short spec string:
+//
+//   ppm                     binary PPM files (the default)
+//   pfm                     PFM files from a float framebuffer
+//   png[:level[:threads]]   PNG files deflated on several threads,
+//                           level 0-9 (default 1)
+//   null                    discard frames, for timing runs
+//   y4m:FILE                one YUV4MPEG2 (4:2:0) stream in FILE
+//   y4m:|COMMAND            the same stream piped to COMMAND's stdin,
+//                           e.g. an ffmpeg encode reading from -
+//
+// File sinks write <dir>/frame_<index>.<ext>. The y4m sink ignores
+// <dir> and expects frames in order, which makeMovieFrames guarantees.
+//
+
+#ifndef OSPRAY_DEMOS_FRAME_SINK_H
+#define OSPRAY_DEMOS_FRAME_SINK_H
+
+#include <memory>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fileUtil.h"
+
+//
+// Layout of the pixels handed to a sink.
+//
+enum FramePixelFormat
+{
+    FRAME_RGBA8,   // 4 bytes per pixel, as from an OSP_FB_SRGBA framebuffer
+    FRAME_RGBA32F  // 4 floats per pixel, as from OSP_FB_RGBA32F
+};
+
+size_t framePixelBytes(FramePixelFormat format);
+
+//
+// A rendered frame. Rows are stored bottom row first, as they come out
+// of ospMapFrameBuffer.
+//
+struct Frame
+{
+    int              frameIdx;
+    int              width;
+    int              height;
+    FramePixelFormat format;
+    const void      *pixels;
+};
+
+class FrameSink
+{
+  public:
+    virtual ~FrameSink() {}
+
+    //
+    // The pixel format this sink wants frames rendered in.
+    //
+    virtual FramePixelFormat format() const { return FRAME_RGBA8; }
+
+    virtual void writeFrame(const Frame &frame) = 0;
+
+    //
+    // How long the last writeFrame call spent converting the pixels
+    // and writing them out. Sinks that do neither report zeros.
+    //
+    const FileWriteTimes &lastWriteTimes() const { return times; }
+
+    //
+    // Make frame frameIdx, already written, durable: flush it and its
+    // directory entry to disk. Returns false for sinks that can't, i.e.
+    // everything but the file sinks, or when flushing fails.
+    //
+    virtual bool sync(int /* frameIdx */) { return false; }
+
+    //
+    // Whether frame frameIdx is already on disk as a complete
+    // width x height frame, judged by its header and size without
+    // decoding the pixels.
+    //
+    virtual bool verifyFrame(int /* frameIdx */, int /* width */, int /* height */) const
+    {
+        return false;
+    }
+
+  protected:
+    FileWriteTimes times = {0.0, 0.0};
+};
+
+//
+// Build a sink from a spec string (see above). Returns nullptr and
+// prints the reason when the spec can't be understood.
+//
+std::unique_ptr<FrameSink> createFrameSink(const std::string &spec,
+                                           const std::string &dir = "frames");
+
+//
+// Whether spec names a sink that writes one stream and so needs every
+// frame, in order, from a single process.
+//
+bool isStreamingFrameSink(const std::string &spec);
+
+//
+// Sink options as given on the command line.
+//
+//   --sink SPEC        which sink to use (default ppm)
+//   --frames-dir DIR   where file sinks write (default frames)
+//
+struct FrameSinkOptions
+{
+    std::string spec;
+    std::string dir;
+
+    FrameSinkOptions()
+        : spec("ppm"),
+          dir("frames")
+    {}
+};
+
+//
+// Pick the sink options out of argv, leaving everything else alone.
+//
+FrameSinkOptions parseFrameSinkOptions(int argc, const char **argv);
+
+#endif
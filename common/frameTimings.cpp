@@ -0,0 +1,217 @@
+//
+// Per-frame timing of the stages of movie generation.
+//
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+#include "frameTimings.h"
+
+namespace {
+
+const char *stageNames[FRAME_STAGE_COUNT] = {
+    "prepare",
+    "camera_commit",
+    "render",
+    "map",
+    "convert",
+    "write",
+    "reset",
+};
+
+//
+// Nearest-rank percentile of sorted values.
+//
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+struct Summary
+{
+    double min;
+    double median;
+    double p95;
+    double p99;
+    double max;
+};
+
+Summary summarize(const std::vector<double> &sorted)
+{
+    if (sorted.empty())
+        return {0.0, 0.0, 0.0, 0.0, 0.0};
+
+    return {sorted.front(),
+            percentile(sorted, 50.0),
+            percentile(sorted, 95.0),
+            percentile(sorted, 99.0),
+            sorted.back()};
+}
+
+bool endsWith(const std::string &str, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+}
+
+
+const char *frameStageName(FrameStage stage)
+{
+    return stage < FRAME_STAGE_COUNT ? stageNames[stage] : "total";
+}
+
+
+void FrameTimings::record(int frameIdx, FrameStage stage, double seconds)
+{
+    if (frameIdx < 0 || stage >= FRAME_STAGE_COUNT)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if ((size_t)frameIdx >= frames.size())
+    {
+        StageTimes zero;
+        zero.fill(0.0);
+        frames.resize(frameIdx + 1, zero);
+        seen.resize(frameIdx + 1, 0);
+    }
+    frames[frameIdx][stage] += seconds;
+    seen[frameIdx] = 1;
+}
+
+
+std::vector<double> FrameTimings::sortedMillis(int stage) const
+{
+    std::vector<double> millis;
+    millis.reserve(frames.size());
+
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (!seen[i])
+            continue;
+
+        const StageTimes &frame = frames[i];
+        double seconds = 0.0;
+        if (stage < FRAME_STAGE_COUNT)
+            seconds = frame[stage];
+        else
+            for (double t : frame)
+                seconds += t;
+        millis.push_back(1000.0 * seconds);
+    }
+
+    std::sort(millis.begin(), millis.end());
+    return millis;
+}
+
+
+bool FrameTimings::write(const std::string &fileName) const
+{
+    FILE *file = fopen(fileName.c_str(), "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "fopen('%s', 'w') failed: %d\n", fileName.c_str(), errno);
+        return false;
+    }
+
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ok = endsWith(fileName, ".json") ? writeJSON(file) : writeCSV(file);
+    }
+
+    if (fclose(file) != 0 || !ok)
+    {
+        fprintf(stderr, "Writing timings to '%s' failed\n", fileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool FrameTimings::writeCSV(FILE *file) const
+{
+    fprintf(file, "frame");
+    for (int stage = 0; stage < FRAME_STAGE_COUNT; ++stage)
+        fprintf(file, ",%s_ms", stageNames[stage]);
+    fprintf(file, ",total_ms\n");
+
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (!seen[i])
+            continue;
+
+        double total = 0.0;
+        fprintf(file, "%zu", i);
+        for (double seconds : frames[i])
+        {
+            fprintf(file, ",%.4f", 1000.0 * seconds);
+            total += seconds;
+        }
+        fprintf(file, ",%.4f\n", 1000.0 * total);
+    }
+
+    return !ferror(file);
+}
+
+
+bool FrameTimings::writeJSON(FILE *file) const
+{
+    fprintf(file, "{\n  \"units\": \"ms\",\n  \"frames\": [");
+    bool firstFrame = true;
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (!seen[i])
+            continue;
+
+        double total = 0.0;
+        fprintf(file, "%s\n    {\"frame\": %zu", firstFrame ? "" : ",", i);
+        firstFrame = false;
+        for (int stage = 0; stage < FRAME_STAGE_COUNT; ++stage)
+        {
+            fprintf(file, ", \"%s\": %.4f", stageNames[stage], 1000.0 * frames[i][stage]);
+            total += frames[i][stage];
+        }
+        fprintf(file, ", \"total\": %.4f}", 1000.0 * total);
+    }
+    fprintf(file, "\n  ],\n  \"summary\": {");
+
+    for (int stage = 0; stage <= FRAME_STAGE_COUNT; ++stage)
+    {
+        Summary s = summarize(sortedMillis(stage));
+        fprintf(file, "%s\n    \"%s\": {\"min\": %.4f, \"median\": %.4f, "
+                "\"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+                stage ? "," : "", frameStageName((FrameStage)stage),
+                s.min, s.median, s.p95, s.p99, s.max);
+    }
+    fprintf(file, "\n  }\n}\n");
+
+    return !ferror(file);
+}
+
+
+void FrameTimings::printSummary(FILE *out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    fprintf(out, "\n%zu frames, times in ms\n",
+            (size_t)std::count(seen.begin(), seen.end(), 1));
+    fprintf(out, "%-14s %9s %9s %9s %9s %9s\n",
+            "stage", "min", "median", "p95", "p99", "max");
+
+    for (int stage = 0; stage <= FRAME_STAGE_COUNT; ++stage)
+    {
+        Summary s = summarize(sortedMillis(stage));
+        fprintf(out, "%-14s %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+                frameStageName((FrameStage)stage),
+                s.min, s.median, s.p95, s.p99, s.max);
+    }
+}
@@ -0,0 +1,80 @@
+//
+// Per-frame timing of the stages of movie generation.
+//
+
+#ifndef OSPRAY_DEMOS_FRAME_TIMINGS_H
+#define OSPRAY_DEMOS_FRAME_TIMINGS_H
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+//
+// The stages a movie frame goes through, in order.
+//
+enum FrameStage
+{
+    STAGE_PREPARE,        // updating the scene for the frame's view
+    STAGE_CAMERA_COMMIT,  // setting and committing the camera pose
+    STAGE_RENDER,         // from starting the render to it finishing
+    STAGE_MAP,            // mapping the framebuffer and reading it out
+    STAGE_CONVERT,        // turning the pixels into the output encoding
+    STAGE_WRITE,          // getting the encoded bytes out
+    STAGE_RESET,          // resetting accumulation for the next frame
+    FRAME_STAGE_COUNT
+};
+
+const char *frameStageName(FrameStage stage);
+
+//
+// Wall time of every stage of every frame. Stages may be recorded
+// from several threads, e.g. convert and write from a background
+// frame writer, and in any order. Frames that nothing was recorded
+// for, e.g. those outside a rendered frame range, are left out.
+//
+class FrameTimings
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    static double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    //
+    // Add seconds to a stage of frame frameIdx.
+    //
+    void record(int frameIdx, FrameStage stage, double seconds);
+
+    //
+    // Write the per-frame times and a summary to fileName, as JSON if
+    // the name ends in .json and as CSV otherwise. Times are in
+    // milliseconds.
+    //
+    bool write(const std::string &fileName) const;
+
+    //
+    // Print min, median, p95, p99 and max of every stage.
+    //
+    void printSummary(FILE *out = stdout) const;
+
+  private:
+    // A stage column (or the per-frame total for FRAME_STAGE_COUNT),
+    // sorted, in milliseconds.
+    std::vector<double> sortedMillis(int stage) const;
+
+    bool writeCSV(FILE *file) const;
+    bool writeJSON(FILE *file) const;
+
+    typedef std::array<double, FRAME_STAGE_COUNT> StageTimes;
+
+    mutable std::mutex      mutex;
+    std::vector<StageTimes> frames;
+    std::vector<char>       seen;
+};
+
+#endif
@@ -0,0 +1,89 @@
+//
+// A background frame writer for the movie demos.
+//
+
+#include "frameWriter.h"
+
+FrameWriter::FrameWriter(size_t bufferBytes,
+                         size_t numBuffers,
+                         WriteFunc writeFunc)
+    : writeFunc(writeFunc),
+      staging(numBuffers < 1 ? 1 : numBuffers),
+      inFlight(0),
+      done(false)
+{
+    for (size_t i = 0; i < staging.size(); ++i)
+    {
+        staging[i].resize(bufferBytes);
+        freeBuffers.push_back(staging[i].data());
+    }
+
+    writer = std::thread(&FrameWriter::writerLoop, this);
+}
+
+
+FrameWriter::~FrameWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    jobQueued.notify_one();
+    writer.join();
+}
+
+
+void *FrameWriter::acquireBuffer()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    bufferFreed.wait(lock, [this] { return !freeBuffers.empty(); });
+
+    void *buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+
+void FrameWriter::submit(int frameIdx, void *buffer)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({frameIdx, buffer});
+        ++inFlight;
+    }
+    jobQueued.notify_one();
+}
+
+
+void FrameWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    bufferFreed.wait(lock, [this] { return inFlight == 0; });
+}
+
+
+void FrameWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        jobQueued.wait(lock, [this] { return done || !pending.empty(); });
+
+        if (pending.empty())
+            break;
+
+        Job job = pending.front();
+        pending.pop_front();
+
+        // Write without holding the lock so the render thread can keep
+        // acquiring and submitting buffers.
+        lock.unlock();
+        writeFunc(job.frameIdx, job.buffer);
+        lock.lock();
+
+        freeBuffers.push_back(job.buffer);
+        --inFlight;
+        bufferFreed.notify_all();
+    }
+}
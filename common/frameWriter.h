@@ -0,0 +1,77 @@
+//
+// A background frame writer for the movie demos.
+//
+// Rendered pixels are copied into one of a small pool of reusable
+// staging buffers and handed to a dedicated writer thread through a
+// bounded queue. The render loop only blocks when every staging buffer
+// is still waiting to be written, so disk and encode time overlaps with
+// rendering of the next frame.
+//
+
+#ifndef OSPRAY_DEMOS_FRAME_WRITER_H
+#define OSPRAY_DEMOS_FRAME_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class FrameWriter
+{
+  public:
+    //
+    // Called on the writer thread, in submission order.
+    //
+    typedef std::function<void(int frameIdx, const void *pixels)> WriteFunc;
+
+    FrameWriter(size_t bufferBytes,
+                size_t numBuffers,
+                WriteFunc writeFunc);
+
+    // Drains the queue and joins the writer thread.
+    ~FrameWriter();
+
+    //
+    // Get a free staging buffer of bufferBytes bytes. Blocks while
+    // every buffer is queued or being written.
+    //
+    void *acquireBuffer();
+
+    //
+    // Queue a buffer obtained from acquireBuffer() for writing. The
+    // buffer returns to the pool once the write completes.
+    //
+    void submit(int frameIdx, void *buffer);
+
+    //
+    // Block until every submitted frame has been written.
+    //
+    void flush();
+
+  private:
+    struct Job
+    {
+        int   frameIdx;
+        void *buffer;
+    };
+
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    void writerLoop();
+
+    WriteFunc                         writeFunc;
+    std::vector<std::vector<char> >   staging;
+    std::vector<void *>               freeBuffers;
+    std::deque<Job>                   pending;
+    size_t                            inFlight;
+    bool                              done;
+    std::mutex                        mutex;
+    std::condition_variable           bufferFreed;
+    std::condition_variable           jobQueued;
+    std::thread                       writer;
+};
+
+#endif
@@ -0,0 +1,197 @@
+//
+// A coarse min/max grid over a structured volume.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+
+#include "macrocellGrid.h"
+#include "parallelFor.h"
+
+namespace {
+
+//
+// Macrocells along an axis of n voxels: n - 1 cells in runs of size.
+//
+size_t macrocellCount(size_t n, size_t size)
+{
+    size_t cells = n > 1 ? n - 1 : 1;
+    return (cells + size - 1) / size;
+}
+
+//
+// Voxels [first, last] under macrocell i along an axis of n voxels.
+//
+void macrocellVoxels(size_t i, size_t n, size_t size, size_t &first, size_t &last)
+{
+    first = i * size;
+    last  = std::min(first + size, n - 1);
+}
+
+//
+// Ranges skip NaN, so a macrocell of only NaN is left at +inf:-inf,
+// an empty range.
+//
+template <typename T>
+void macrocellRanges(const T *voxels,
+                     const VolumeDims &dims,
+                     size_t size,
+                     const VolumeDims &cells,
+                     float *minValues,
+                     float *maxValues,
+                     size_t begin,
+                     size_t end)
+{
+    for (size_t c = begin; c < end; ++c)
+    {
+        size_t x0, x1, y0, y1, z0, z1;
+        macrocellVoxels(c % cells.x, dims.x, size, x0, x1);
+        macrocellVoxels(c / cells.x % cells.y, dims.y, size, y0, y1);
+        macrocellVoxels(c / cells.x / cells.y, dims.z, size, z0, z1);
+
+        float lo = INFINITY;
+        float hi = -INFINITY;
+        for (size_t z = z0; z <= z1; ++z)
+            for (size_t y = y0; y <= y1; ++y)
+            {
+                const T *row = voxels + (z * dims.y + y) * dims.x;
+                for (size_t x = x0; x <= x1; ++x)
+                {
+                    if (row[x] != row[x])
+                        continue;
+                    lo = std::min(lo, (float)row[x]);
+                    hi = std::max(hi, (float)row[x]);
+                }
+            }
+
+        minValues[c] = lo;
+        maxValues[c] = hi;
+    }
+}
+
+}
+
+
+float OpacityTransfer::maxOpacity(float lo, float hi) const
+{
+    // Nothing, or only NaN, is in the range.
+    if (opacities.empty() || !(lo <= hi))
+        return 0.0f;
+
+    const float span = valueRange[1] - valueRange[0];
+    if (opacities.size() == 1 || span <= 0.0f)
+        return *std::max_element(opacities.begin(), opacities.end());
+
+    // Positions in control points, where the interpolated opacity is
+    // evaluated; in between, only the control points can be higher.
+    const float last = (float)(opacities.size() - 1);
+    auto position = [&](float value)
+    {
+        return std::min(std::max((value - valueRange[0]) / span, 0.0f), 1.0f) * last;
+    };
+    auto opacityAt = [&](float t)
+    {
+        size_t i = std::min((size_t)t, opacities.size() - 2);
+        float f = t - i;
+        return opacities[i] * (1.0f - f) + opacities[i + 1] * f;
+    };
+
+    float tLo = position(lo);
+    float tHi = position(hi);
+    float result = std::max(opacityAt(tLo), opacityAt(tHi));
+    for (size_t i = (size_t)ceilf(tLo); i <= (size_t)tHi; ++i)
+        result = std::max(result, opacities[i]);
+    return result;
+}
+
+
+MacrocellGrid::MacrocellGrid(const VoxelArray &source, size_t cellSize, int numThreads)
+    : size(std::max<size_t>(1, cellSize)),
+      cells{0, 0, 0},
+      seconds(0.0)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const VolumeDims &dims = source.dims;
+    if (dims.count() == 0)
+        return;
+
+    cells = {macrocellCount(dims.x, size),
+             macrocellCount(dims.y, size),
+             macrocellCount(dims.z, size)};
+    minValues.resize(cells.count());
+    maxValues.resize(cells.count());
+
+    // Each macrocell reads about size^3 voxels, so a few per thread is
+    // already worth it.
+    parallelChunks(cells.count(),
+        [&](int, size_t begin, size_t end)
+        {
+            switch (source.type)
+            {
+            case VOXEL_UINT8:
+                macrocellRanges((const uint8_t *)source.voxels, dims, size, cells,
+                                minValues.data(), maxValues.data(), begin, end);
+                break;
+            case VOXEL_UINT16:
+                macrocellRanges((const uint16_t *)source.voxels, dims, size, cells,
+                                minValues.data(), maxValues.data(), begin, end);
+                break;
+            case VOXEL_FLOAT:
+                macrocellRanges((const float *)source.voxels, dims, size, cells,
+                                minValues.data(), maxValues.data(), begin, end);
+                break;
+            case VOXEL_DOUBLE:
+                macrocellRanges((const double *)source.voxels, dims, size, cells,
+                                minValues.data(), maxValues.data(), begin, end);
+                break;
+            }
+        },
+        numThreads, 4);
+
+    seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+
+void MacrocellGrid::brickRange(const VolumeBrick &brick, float &lo, float &hi) const
+{
+    // Macrocells under the brick's cells, first to last.
+    auto span = [this](size_t begin, size_t voxels, size_t count,
+                       size_t &first, size_t &last)
+    {
+        size_t cellsInBrick = voxels > 1 ? voxels - 1 : 1;
+        first = std::min(begin / size, count - 1);
+        last  = std::min((begin + cellsInBrick - 1) / size, count - 1);
+    };
+
+    size_t x0, x1, y0, y1, z0, z1;
+    span(brick.begin.x, brick.dims.x, cells.x, x0, x1);
+    span(brick.begin.y, brick.dims.y, cells.y, y0, y1);
+    span(brick.begin.z, brick.dims.z, cells.z, z0, z1);
+
+    lo = INFINITY;
+    hi = -INFINITY;
+    for (size_t z = z0; z <= z1; ++z)
+        for (size_t y = y0; y <= y1; ++y)
+            for (size_t x = x0; x <= x1; ++x)
+            {
+                size_t c = (z * cells.y + y) * cells.x + x;
+                lo = std::min(lo, minValues[c]);
+                hi = std::max(hi, maxValues[c]);
+            }
+}
+
+
+bool MacrocellGrid::brickVisible(const VolumeBrick &brick,
+                                 const OpacityTransfer &transfer) const
+{
+    if (minValues.empty())
+        return true;
+
+    float lo, hi;
+    brickRange(brick, lo, hi);
+    return transfer.maxOpacity(lo, hi) > 0.0f;
+}
@@ -0,0 +1,71 @@
+//
+// A coarse grid of the smallest and largest voxel in each block of a
+// structured volume, for finding the parts of it a transfer function
+// makes fully transparent without looking at their voxels again.
+//
+
+#ifndef OSPRAY_DEMOS_MACROCELL_GRID_H
+#define OSPRAY_DEMOS_MACROCELL_GRID_H
+
+#include <vector>
+#include <stddef.h>
+
+#include "volumeBricks.h"
+#include "voxelArray.h"
+
+//
+// The opacity half of a piecewise linear transfer function: opacities
+// spaced evenly over valueRange, clamped to the end values outside it,
+// as OSPRay's piecewiseLinear transfer function does.
+//
+struct OpacityTransfer
+{
+    std::vector<float> opacities;
+    float              valueRange[2];
+
+    //
+    // The largest opacity any value in [lo, hi] maps to, 0 when lo > hi
+    // or either is NaN.
+    //
+    float maxOpacity(float lo, float hi) const;
+};
+
+class MacrocellGrid
+{
+  public:
+    //
+    // Find the value range of every macrocell of cellSize^3 cells in
+    // source, on numThreads threads (one per core for 0). A macrocell
+    // includes the voxels on its high faces, which the renderer
+    // interpolates from, so neighbouring ranges overlap by one layer.
+    // NaN voxels are left out; a macrocell of only NaN has an empty
+    // range, +inf:-inf, and shows nothing. Reads every voxel once.
+    //
+    MacrocellGrid(const VoxelArray &source, size_t cellSize, int numThreads = 0);
+
+    //
+    // The value range of the macrocells covering a brick's cells,
+    // empty as above if they hold only NaN.
+    //
+    void brickRange(const VolumeBrick &brick, float &lo, float &hi) const;
+
+    //
+    // Whether a brick may show anything under transfer: false when
+    // every value it holds has zero opacity.
+    //
+    bool brickVisible(const VolumeBrick &brick, const OpacityTransfer &transfer) const;
+
+    size_t cellSize() const { return size; }
+
+    // Seconds the constructor took.
+    double buildSeconds() const { return seconds; }
+
+  private:
+    size_t             size;
+    VolumeDims         cells;
+    std::vector<float> minValues;
+    std::vector<float> maxValues;
+    double             seconds;
+};
+
+#endif
@@ -0,0 +1,1643 @@
+//
+// Unstructured grid files, read without VTK.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "meshFile.h"
+#include "parallelFor.h"
+
+MeshFileOptions parseMeshFileOptions(int argc, const char **argv)
+{
+    MeshFileOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+            options.fileName = argv[++i];
+        else if (strcmp(argv[i], "--mesh-field") == 0 && i + 1 < argc)
+            options.fieldName = argv[++i];
+    }
+
+    return options;
+}
+
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Values per thread below which a conversion runs on one thread.
+const size_t minValuesPerThread = 1 << 16;
+
+bool endsWith(const std::string &str, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+bool hostIsLittleEndian()
+{
+    const uint16_t one = 1;
+    return *(const unsigned char *)&one == 1;
+}
+
+//
+// A whole file mapped read only. Check data after constructing;
+// failures are printed.
+//
+class MappedFile
+{
+  public:
+    explicit MappedFile(const std::string &fileName)
+        : data(nullptr),
+          size(0),
+          modified(0)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            fprintf(stderr, "open('%s') failed: %d\n", fileName.c_str(), errno);
+            return;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            fprintf(stderr, "'%s' is empty or can't be read: %d\n", fileName.c_str(), errno);
+            close(fd);
+            return;
+        }
+
+        void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            fprintf(stderr, "mmap('%s') failed: %d\n", fileName.c_str(), errno);
+            return;
+        }
+
+        // The markup is read front to back, the arrays mostly so too.
+        madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+
+        data     = (const char *)mapped;
+        size     = info.st_size;
+        modified = (long long)info.st_mtime;
+    }
+
+    ~MappedFile()
+    {
+        if (data)
+            munmap((void *)data, size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data;
+    size_t      size;
+    long long   modified;
+};
+
+
+//
+// The scalar types arrays are stored as.
+//
+enum ScalarType
+{
+    SCALAR_INT8,
+    SCALAR_UINT8,
+    SCALAR_INT16,
+    SCALAR_UINT16,
+    SCALAR_INT32,
+    SCALAR_UINT32,
+    SCALAR_INT64,
+    SCALAR_UINT64,
+    SCALAR_FLOAT32,
+    SCALAR_FLOAT64
+};
+
+size_t scalarSize(ScalarType type)
+{
+    switch (type)
+    {
+    case SCALAR_INT8:
+    case SCALAR_UINT8:   return 1;
+    case SCALAR_INT16:
+    case SCALAR_UINT16:  return 2;
+    case SCALAR_INT32:
+    case SCALAR_UINT32:
+    case SCALAR_FLOAT32: return 4;
+    default:             return 8;
+    }
+}
+
+//
+// Type names as the XML format gives them.
+//
+bool parseXmlType(const std::string &name, ScalarType &type)
+{
+    static const struct { const char *name; ScalarType type; } names[] = {
+        {"Int8",    SCALAR_INT8},    {"UInt8",   SCALAR_UINT8},
+        {"Int16",   SCALAR_INT16},   {"UInt16",  SCALAR_UINT16},
+        {"Int32",   SCALAR_INT32},   {"UInt32",  SCALAR_UINT32},
+        {"Int64",   SCALAR_INT64},   {"UInt64",  SCALAR_UINT64},
+        {"Float32", SCALAR_FLOAT32}, {"Float64", SCALAR_FLOAT64},
+    };
+    for (const auto &entry : names)
+    {
+        if (name == entry.name)
+        {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Type names as the legacy format gives them. long and vtkIdType are
+// taken as 64 bits, as VTK writes them on 64 bit systems.
+//
+bool parseLegacyType(const char *name, ScalarType &type)
+{
+    static const struct { const char *name; ScalarType type; } names[] = {
+        {"char",           SCALAR_INT8},    {"unsigned_char",  SCALAR_UINT8},
+        {"short",          SCALAR_INT16},   {"unsigned_short", SCALAR_UINT16},
+        {"int",            SCALAR_INT32},   {"unsigned_int",   SCALAR_UINT32},
+        {"long",           SCALAR_INT64},   {"unsigned_long",  SCALAR_UINT64},
+        {"vtktypeint64",   SCALAR_INT64},   {"vtktypeuint64",  SCALAR_UINT64},
+        {"vtkIdType",      SCALAR_INT64},   {"float",          SCALAR_FLOAT32},
+        {"double",         SCALAR_FLOAT64},
+    };
+    for (const auto &entry : names)
+    {
+        if (strcmp(name, entry.name) == 0)
+        {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+T loadScalar(const unsigned char *bytes, bool swap)
+{
+    T value;
+    if (swap)
+    {
+        unsigned char swapped[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i)
+            swapped[i] = bytes[sizeof(T) - 1 - i];
+        memcpy(&value, swapped, sizeof(T));
+    }
+    else
+    {
+        memcpy(&value, bytes, sizeof(T));
+    }
+    return value;
+}
+
+//
+// Whether every value of type In is a value of Out with the same bits:
+// identical types, or same sized unsigned integers going into integers.
+//
+template <typename In, typename Out>
+bool sameBits()
+{
+    return std::is_same<In, Out>::value ||
+        (std::is_integral<In>::value && std::is_unsigned<In>::value &&
+         std::is_integral<Out>::value && sizeof(In) == sizeof(Out));
+}
+
+template <typename Out>
+bool sameBits(ScalarType type)
+{
+    switch (type)
+    {
+    case SCALAR_INT8:    return sameBits<int8_t, Out>();
+    case SCALAR_UINT8:   return sameBits<uint8_t, Out>();
+    case SCALAR_INT16:   return sameBits<int16_t, Out>();
+    case SCALAR_UINT16:  return sameBits<uint16_t, Out>();
+    case SCALAR_INT32:   return sameBits<int32_t, Out>();
+    case SCALAR_UINT32:  return sameBits<uint32_t, Out>();
+    case SCALAR_INT64:   return sameBits<int64_t, Out>();
+    case SCALAR_UINT64:  return sameBits<uint64_t, Out>();
+    case SCALAR_FLOAT32: return sameBits<float, Out>();
+    case SCALAR_FLOAT64: return sameBits<double, Out>();
+    }
+    return false;
+}
+
+//
+// Whether value is one of Out's: anything goes into floats, but
+// integers (indices, offsets, cell types) take no negatives, NaN or
+// values past their largest.
+//
+template <typename Out, typename In>
+bool fitsIn(In value)
+{
+    const double v = (double)value;
+    return std::is_floating_point<Out>::value ||
+           (v >= 0.0 && v <= (double)std::numeric_limits<Out>::max());
+}
+
+//
+// Convert count scalars stored as In into out. Values of the same bits
+// are copied as they are. Returns false if any value doesn't fit in
+// Out; those are stored as 0.
+//
+template <typename In, typename Out>
+bool convertAs(const unsigned char *src, bool swap, size_t count, Out *out)
+{
+    if (sameBits<In, Out>() && !swap)
+    {
+        memcpy(out, src, count * sizeof(Out));
+        return true;
+    }
+
+    bool fits = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        In value = loadScalar<In>(src + i * sizeof(In), swap);
+        bool ok = fitsIn<Out>(value);
+        out[i] = ok ? (Out)value : Out(0);
+        fits &= ok;
+    }
+    return fits;
+}
+
+template <typename Out>
+bool convertScalars(const unsigned char *src, ScalarType type, bool swap, size_t count,
+                    Out *out)
+{
+    switch (type)
+    {
+    case SCALAR_INT8:    return convertAs<int8_t>(src, swap, count, out);
+    case SCALAR_UINT8:   return convertAs<uint8_t>(src, swap, count, out);
+    case SCALAR_INT16:   return convertAs<int16_t>(src, swap, count, out);
+    case SCALAR_UINT16:  return convertAs<uint16_t>(src, swap, count, out);
+    case SCALAR_INT32:   return convertAs<int32_t>(src, swap, count, out);
+    case SCALAR_UINT32:  return convertAs<uint32_t>(src, swap, count, out);
+    case SCALAR_INT64:   return convertAs<int64_t>(src, swap, count, out);
+    case SCALAR_UINT64:  return convertAs<uint64_t>(src, swap, count, out);
+    case SCALAR_FLOAT32: return convertAs<float>(src, swap, count, out);
+    case SCALAR_FLOAT64: return convertAs<double>(src, swap, count, out);
+    }
+    return false;
+}
+
+template <typename Out>
+bool convertParallel(const unsigned char *src, ScalarType type, bool swap, size_t count,
+                     Out *out, int numThreads)
+{
+    const size_t size = scalarSize(type);
+    std::atomic<bool> fits(true);
+    parallelChunks(count,
+        [&](int, size_t begin, size_t end)
+        {
+            if (!convertScalars(src + begin * size, type, swap, end - begin, out + begin))
+                fits = false;
+        },
+        numThreads, minValuesPerThread);
+    return fits;
+}
+
+
+//
+// Base64, decoded four characters at a time on every core.
+//
+const unsigned char base64Invalid = 0xff;
+
+const unsigned char *base64Table()
+{
+    static unsigned char table[256];
+    static bool built = false;
+    if (!built)
+    {
+        const char *alphabet =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        memset(table, base64Invalid, sizeof(table));
+        for (int i = 0; i < 64; ++i)
+            table[(unsigned char)alphabet[i]] = (unsigned char)i;
+        table['='] = 0;
+        built = true;
+    }
+    return table;
+}
+
+//
+// Decode length characters of base64, a multiple of four with no
+// whitespace, into out, which holds length / 4 * 3 bytes. Returns the
+// bytes decoded, without padding, or -1 for a character outside the
+// alphabet.
+//
+long long decodeBase64(const char *text, size_t length, unsigned char *out, int numThreads)
+{
+    const unsigned char *table = base64Table();
+    const size_t quads = length / 4;
+
+    std::atomic<bool> bad(false);
+    parallelChunks(quads,
+        [&](int, size_t begin, size_t end)
+        {
+            unsigned char invalid = 0;
+            for (size_t q = begin; q < end; ++q)
+            {
+                const unsigned char *in = (const unsigned char *)text + 4 * q;
+                unsigned char a = table[in[0]], b = table[in[1]];
+                unsigned char c = table[in[2]], d = table[in[3]];
+                invalid |= (a | b | c | d) & 0x80;
+
+                unsigned char *o = out + 3 * q;
+                o[0] = (unsigned char)(a << 2 | b >> 4);
+                o[1] = (unsigned char)(b << 4 | c >> 2);
+                o[2] = (unsigned char)(c << 6 | d);
+            }
+            if (invalid)
+                bad = true;
+        },
+        numThreads, minValuesPerThread);
+
+    if (bad || length % 4 != 0)
+        return -1;
+
+    size_t bytes = quads * 3;
+    if (length > 0 && text[length - 1] == '=')
+        --bytes;
+    if (length > 1 && text[length - 2] == '=')
+        --bytes;
+    return (long long)bytes;
+}
+
+size_t base64Length(size_t bytes)
+{
+    return (bytes + 2) / 3 * 4;
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+
+//
+// One tag of the XML markup.
+//
+struct XmlTag
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    bool closing;
+    bool selfClosing;
+
+    // Where the tag starts, at its '<', and ends, just after its '>'.
+    const char *start;
+    const char *end;
+
+    std::string attribute(const char *key, const char *fallback = "") const
+    {
+        for (const auto &entry : attributes)
+            if (entry.first == key)
+                return entry.second;
+        return fallback;
+    }
+};
+
+//
+// Read the next tag at or after p, skipping text, comments and
+// processing instructions, and leave p after it. Returns false when
+// there are no more.
+//
+bool nextTag(const char *&p, const char *end, XmlTag &tag)
+{
+    for (;;)
+    {
+        p = (const char *)memchr(p, '<', end - p);
+        if (p == nullptr)
+            return false;
+
+        if (end - p >= 4 && strncmp(p, "<!--", 4) == 0)
+        {
+            // The mapping isn't NUL terminated, so no strstr.
+            const char *close = (const char *)memmem(p + 4, end - p - 4, "-->", 3);
+            if (close == nullptr)
+                return false;
+            p = close + 3;
+            continue;
+        }
+        if (end - p >= 2 && (p[1] == '?' || p[1] == '!'))
+        {
+            p = (const char *)memchr(p, '>', end - p);
+            if (p == nullptr)
+                return false;
+            ++p;
+            continue;
+        }
+        break;
+    }
+
+    tag.start = p++;
+    tag.closing = p < end && *p == '/';
+    if (tag.closing)
+        ++p;
+
+    const char *name = p;
+    while (p < end && !isSpace(*p) && *p != '>' && *p != '/')
+        ++p;
+    tag.name.assign(name, p);
+    tag.attributes.clear();
+    tag.selfClosing = false;
+
+    while (p < end)
+    {
+        while (p < end && isSpace(*p))
+            ++p;
+        if (p >= end)
+            return false;
+        if (*p == '>')
+            break;
+        if (*p == '/')
+        {
+            tag.selfClosing = true;
+            ++p;
+            continue;
+        }
+
+        const char *key = p;
+        while (p < end && *p != '=' && *p != '>' && !isSpace(*p))
+            ++p;
+        std::string keyText(key, p);
+        while (p < end && (isSpace(*p) || *p == '='))
+            ++p;
+        if (p >= end || (*p != '"' && *p != '\''))
+            return false;
+
+        const char quote = *p++;
+        const char *value = p;
+        p = (const char *)memchr(p, quote, end - p);
+        if (p == nullptr)
+            return false;
+        tag.attributes.emplace_back(keyText, std::string(value, p));
+        ++p;
+    }
+    if (p >= end)
+        return false;
+
+    tag.end = ++p;
+    return true;
+}
+
+
+//
+// An array of a .vtu file, as its DataArray tag describes it.
+//
+struct XmlArray
+{
+    std::string name;
+    ScalarType  type;
+    size_t      components;
+    std::string format;
+    size_t      offset;
+
+    // The tag's content, for binary arrays.
+    const char *text;
+    const char *textEnd;
+};
+
+//
+// What a .vtu file's markup says about its arrays.
+//
+struct VtuFile
+{
+    bool   swap;
+    size_t headerSize;
+    bool   compressed;
+    size_t numPoints;
+    size_t numCells;
+    int    pieces;
+
+    XmlArray points;
+    XmlArray connectivity;
+    XmlArray offsets;
+    XmlArray types;
+    bool     havePoints;
+    bool     haveConnectivity;
+    bool     haveOffsets;
+    bool     haveTypes;
+
+    std::vector<XmlArray> pointData;
+    std::vector<XmlArray> cellData;
+    std::string           pointScalars;
+    std::string           cellScalars;
+
+    // Appended data, from just after its '_' to the end of the file.
+    const char *appended;
+    const char *fileEnd;
+    bool        appendedBase64;
+
+    VtuFile()
+        : swap(false),
+          headerSize(4),
+          compressed(false),
+          numPoints(0),
+          numCells(0),
+          pieces(0),
+          havePoints(false),
+          haveConnectivity(false),
+          haveOffsets(false),
+          haveTypes(false),
+          appended(nullptr),
+          fileEnd(nullptr),
+          appendedBase64(false)
+    {}
+};
+
+bool scanVtu(const MappedFile &file, const std::string &fileName, VtuFile &vtu)
+{
+    const char *p   = file.data;
+    const char *end = file.data + file.size;
+    vtu.fileEnd = end;
+
+    std::string section;
+    bool        inDataArray = false;
+    XmlArray    array;
+    XmlTag      tag;
+    while (nextTag(p, end, tag))
+    {
+        if (tag.closing)
+        {
+            if (tag.name == "DataArray" && inDataArray)
+            {
+                array.textEnd = tag.start;
+                inDataArray = false;
+            }
+            else if (tag.name == section)
+            {
+                section.clear();
+                continue;
+            }
+            else
+            {
+                continue;
+            }
+        }
+        else if (tag.name == "VTKFile")
+        {
+            if (tag.attribute("type") != "UnstructuredGrid")
+            {
+                fprintf(stderr, "'%s' holds a %s, not an UnstructuredGrid\n",
+                        fileName.c_str(), tag.attribute("type").c_str());
+                return false;
+            }
+
+            bool bigEndian = tag.attribute("byte_order") == "BigEndian";
+            vtu.swap = bigEndian == hostIsLittleEndian();
+            vtu.headerSize = tag.attribute("header_type", "UInt32") == "UInt64" ? 8 : 4;
+
+            std::string compressor = tag.attribute("compressor");
+            vtu.compressed = !compressor.empty();
+            if (vtu.compressed && compressor != "vtkZLibDataCompressor")
+            {
+                fprintf(stderr, "'%s' uses %s; only zlib compression is supported\n",
+                        fileName.c_str(), compressor.c_str());
+                return false;
+            }
+            continue;
+        }
+        else if (tag.name == "Piece")
+        {
+            ++vtu.pieces;
+            vtu.numPoints = strtoull(tag.attribute("NumberOfPoints", "0").c_str(), nullptr, 10);
+            vtu.numCells  = strtoull(tag.attribute("NumberOfCells", "0").c_str(), nullptr, 10);
+            continue;
+        }
+        else if (tag.name == "PointData" || tag.name == "CellData" ||
+                 tag.name == "Points" || tag.name == "Cells")
+        {
+            if (tag.name == "PointData")
+                vtu.pointScalars = tag.attribute("Scalars");
+            else if (tag.name == "CellData")
+                vtu.cellScalars = tag.attribute("Scalars");
+            if (!tag.selfClosing)
+                section = tag.name;
+            continue;
+        }
+        else if (tag.name == "DataArray")
+        {
+            array.name       = tag.attribute("Name");
+            array.components = std::max(1, atoi(tag.attribute("NumberOfComponents", "1").c_str()));
+            array.format     = tag.attribute("format", "ascii");
+            array.offset     = strtoull(tag.attribute("offset", "0").c_str(), nullptr, 10);
+            array.text       = tag.end;
+            array.textEnd    = tag.end;
+            if (!parseXmlType(tag.attribute("type"), array.type))
+            {
+                fprintf(stderr, "'%s': array '%s' has unknown type '%s'\n",
+                        fileName.c_str(), array.name.c_str(),
+                        tag.attribute("type").c_str());
+                return false;
+            }
+
+            // Wait for the closing tag to find where the content ends.
+            inDataArray = !tag.selfClosing;
+            if (inDataArray)
+                continue;
+        }
+        else if (tag.name == "AppendedData")
+        {
+            vtu.appendedBase64 = tag.attribute("encoding") == "base64";
+            const char *underscore = (const char *)memchr(tag.end, '_', end - tag.end);
+            if (underscore == nullptr)
+            {
+                fprintf(stderr, "'%s': AppendedData has no '_'\n", fileName.c_str());
+                return false;
+            }
+
+            // Raw data may hold anything, so the markup ends here.
+            vtu.appended = underscore + 1;
+            break;
+        }
+        else
+        {
+            continue;
+        }
+
+        // A DataArray is complete.
+        if (section == "Points")
+        {
+            vtu.points = array;
+            vtu.havePoints = true;
+        }
+        else if (section == "Cells")
+        {
+            if (array.name == "connectivity")
+            {
+                vtu.connectivity = array;
+                vtu.haveConnectivity = true;
+            }
+            else if (array.name == "offsets")
+            {
+                vtu.offsets = array;
+                vtu.haveOffsets = true;
+            }
+            else if (array.name == "types")
+            {
+                vtu.types = array;
+                vtu.haveTypes = true;
+            }
+        }
+        else if (section == "PointData")
+            vtu.pointData.push_back(array);
+        else if (section == "CellData")
+            vtu.cellData.push_back(array);
+    }
+
+    if (vtu.pieces != 1)
+    {
+        fprintf(stderr, "'%s' has %d pieces; only files of one are supported\n",
+                fileName.c_str(), vtu.pieces);
+        return false;
+    }
+    if (!vtu.havePoints || !vtu.haveConnectivity || !vtu.haveOffsets || !vtu.haveTypes)
+    {
+        fprintf(stderr, "'%s' lacks points, connectivity, offsets or types\n",
+                fileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t loadHeaderWord(const unsigned char *bytes, const VtuFile &vtu)
+{
+    return vtu.headerSize == 8 ? loadScalar<uint64_t>(bytes, vtu.swap)
+                               : loadScalar<uint32_t>(bytes, vtu.swap);
+}
+
+bool outOfRange(const XmlArray &array)
+{
+    fprintf(stderr, "Array '%s' has values out of range for it, such as negative "
+            "or past 32 bit indices\n", array.name.c_str());
+    return false;
+}
+
+//
+// Decode an array of a .vtu file, which must hold count scalars, into
+// out. Fails on values out doesn't hold (see fitsIn).
+//
+template <typename Out>
+bool decodeXmlArray(const VtuFile &vtu, const XmlArray &array, size_t count, Out *out,
+                    int numThreads)
+{
+    const size_t size = scalarSize(array.type);
+    const size_t hs   = vtu.headerSize;
+    const size_t bytes = count * size;
+
+    bool appended = array.format == "appended";
+    if (!appended && array.format != "binary")
+    {
+        fprintf(stderr, "Array '%s' is %s; only binary and appended arrays are supported\n",
+                array.name.c_str(), array.format.c_str());
+        return false;
+    }
+    if (appended && vtu.appended == nullptr)
+    {
+        fprintf(stderr, "Array '%s' is appended, but there is no AppendedData\n",
+                array.name.c_str());
+        return false;
+    }
+
+    // Where the array's header and data start, and how far they may go.
+    const char *text, *textEnd;
+    if (appended)
+    {
+        text    = vtu.appended + array.offset;
+        textEnd = vtu.fileEnd;
+    }
+    else
+    {
+        text    = array.text;
+        textEnd = array.textEnd;
+        while (text < textEnd && isSpace(*text))
+            ++text;
+        while (textEnd > text && isSpace(textEnd[-1]))
+            --textEnd;
+    }
+    if (text >= textEnd)
+    {
+        fprintf(stderr, "Array '%s' is empty or past the end of the file\n",
+                array.name.c_str());
+        return false;
+    }
+
+    const bool base64 = !appended || vtu.appendedBase64;
+    const size_t available = textEnd - text;
+
+    //
+    // Compressed arrays start with a header of their own, base64
+    // encoded on its own: the number of blocks, the size of each before
+    // compression and of the last, then each block's compressed size.
+    // Uncompressed ones start with their size in bytes, encoded along
+    // with the data.
+    //
+    std::vector<unsigned char> decoded;
+    const unsigned char *data;
+    if (!vtu.compressed)
+    {
+        size_t needed = hs + bytes;
+        if (base64)
+        {
+            size_t chars = std::min(available, base64Length(needed) + 3) / 4 * 4;
+            decoded.resize(chars / 4 * 3);
+            long long got = decodeBase64(text, chars, decoded.data(), numThreads);
+            if (got < (long long)needed)
+            {
+                fprintf(stderr, "Array '%s' isn't valid base64 of %zu bytes\n",
+                        array.name.c_str(), needed);
+                return false;
+            }
+            data = decoded.data();
+        }
+        else
+        {
+            if (available < needed)
+            {
+                fprintf(stderr, "Array '%s' runs past the end of the file\n",
+                        array.name.c_str());
+                return false;
+            }
+            data = (const unsigned char *)text;
+        }
+
+        uint64_t stored = loadHeaderWord(data, vtu);
+        if (stored != bytes)
+        {
+            fprintf(stderr, "Array '%s' holds %llu bytes, expected %zu\n",
+                    array.name.c_str(), (unsigned long long)stored, bytes);
+            return false;
+        }
+
+        if (!convertParallel(data + hs, array.type, vtu.swap, count, out, numThreads))
+            return outOfRange(array);
+        return true;
+    }
+
+    // The fixed part of the header, then the block sizes.
+    unsigned char fixed[3 * 8 + 8];
+    const unsigned char *header = (const unsigned char *)text;
+    if (base64)
+    {
+        size_t chars = base64Length(3 * hs);
+        if (available < chars || decodeBase64(text, chars, fixed, 1) < (long long)(3 * hs))
+        {
+            fprintf(stderr, "Array '%s' has a bad compression header\n", array.name.c_str());
+            return false;
+        }
+        header = fixed;
+    }
+    else if (available < 3 * hs)
+    {
+        fprintf(stderr, "Array '%s' runs past the end of the file\n", array.name.c_str());
+        return false;
+    }
+
+    const size_t numBlocks = loadHeaderWord(header, vtu);
+    const size_t blockSize = loadHeaderWord(header + hs, vtu);
+    size_t lastSize        = loadHeaderWord(header + 2 * hs, vtu);
+    if (lastSize == 0)
+        lastSize = blockSize;
+
+    size_t total = numBlocks ? (numBlocks - 1) * blockSize + lastSize : 0;
+    if (total != bytes || (numBlocks > 1 && blockSize % size != 0))
+    {
+        fprintf(stderr, "Array '%s' holds %zu bytes in %zu blocks, expected %zu\n",
+                array.name.c_str(), total, numBlocks, bytes);
+        return false;
+    }
+
+    const size_t headerBytes = (3 + numBlocks) * hs;
+    std::vector<unsigned char> headerCopy;
+    if (base64)
+    {
+        size_t chars = base64Length(headerBytes);
+        headerCopy.resize(chars / 4 * 3);
+        if (available < chars ||
+            decodeBase64(text, chars, headerCopy.data(), 1) < (long long)headerBytes)
+        {
+            fprintf(stderr, "Array '%s' has a bad compression header\n", array.name.c_str());
+            return false;
+        }
+        header = headerCopy.data();
+    }
+    else if (available < headerBytes)
+    {
+        fprintf(stderr, "Array '%s' runs past the end of the file\n", array.name.c_str());
+        return false;
+    }
+
+    std::vector<size_t> blockStarts(numBlocks + 1, 0);
+    for (size_t b = 0; b < numBlocks; ++b)
+        blockStarts[b + 1] = blockStarts[b] + loadHeaderWord(header + (3 + b) * hs, vtu);
+    const size_t compressedBytes = blockStarts[numBlocks];
+
+    // The compressed blocks, one after the other.
+    const unsigned char *blocks;
+    if (base64)
+    {
+        const char *blockText = text + base64Length(headerBytes);
+        size_t chars = base64Length(compressedBytes);
+        decoded.resize(chars / 4 * 3);
+        if ((size_t)(textEnd - blockText) < chars ||
+            decodeBase64(blockText, chars, decoded.data(), numThreads) <
+                (long long)compressedBytes)
+        {
+            fprintf(stderr, "Array '%s' isn't valid base64 of %zu compressed bytes\n",
+                    array.name.c_str(), compressedBytes);
+            return false;
+        }
+        blocks = decoded.data();
+    }
+    else
+    {
+        if (available < headerBytes + compressedBytes)
+        {
+            fprintf(stderr, "Array '%s' runs past the end of the file\n",
+                    array.name.c_str());
+            return false;
+        }
+        blocks = (const unsigned char *)text + headerBytes;
+    }
+
+    //
+    // Inflate the blocks on every core, straight into out when the file
+    // holds what out does, or through a block sized buffer otherwise.
+    //
+    const bool direct = !vtu.swap && sameBits<Out>(array.type);
+
+    std::atomic<bool> failed(false), doesntFit(false);
+    parallelChunks(numBlocks,
+        [&](int, size_t begin, size_t end)
+        {
+            std::vector<unsigned char> buffer(direct ? 0 : blockSize);
+            for (size_t b = begin; b < end && !failed; ++b)
+            {
+                size_t expected = b + 1 == numBlocks ? lastSize : blockSize;
+                unsigned char *target = direct
+                    ? (unsigned char *)out + b * blockSize : buffer.data();
+
+                uLongf length = expected;
+                int status = uncompress(target, &length, blocks + blockStarts[b],
+                                        blockStarts[b + 1] - blockStarts[b]);
+                if (status != Z_OK || length != expected)
+                {
+                    failed = true;
+                    break;
+                }
+
+                if (!direct &&
+                    !convertScalars(buffer.data(), array.type, vtu.swap, expected / size,
+                                    out + b * (blockSize / size)))
+                    doesntFit = true;
+            }
+        },
+        numThreads, 1);
+
+    if (failed)
+    {
+        fprintf(stderr, "Array '%s' has a block zlib can't inflate\n", array.name.c_str());
+        return false;
+    }
+    if (doesntFit)
+        return outOfRange(array);
+    return true;
+}
+
+//
+// The field to render: the one named, or else the one the markup calls
+// the scalars, or else the first with one component, points first.
+//
+const XmlArray *chooseField(const VtuFile &vtu, const std::string &name, bool &cellValues)
+{
+    for (int cells = 0; cells < 2; ++cells)
+    {
+        const std::vector<XmlArray> &arrays = cells ? vtu.cellData : vtu.pointData;
+        const std::string &scalars = cells ? vtu.cellScalars : vtu.pointScalars;
+        for (const XmlArray &array : arrays)
+        {
+            if (name.empty() ? array.name == scalars && array.components == 1
+                             : array.name == name)
+            {
+                cellValues = cells;
+                return &array;
+            }
+        }
+    }
+    if (!name.empty())
+        return nullptr;
+
+    for (int cells = 0; cells < 2; ++cells)
+    {
+        for (const XmlArray &array : cells ? vtu.cellData : vtu.pointData)
+        {
+            if (array.components == 1)
+            {
+                cellValues = cells;
+                return &array;
+            }
+        }
+    }
+    return nullptr;
+}
+
+//
+// Narrow cell offsets, read as 64 bits, into starts. Fails if any is
+// past what the 32 bit cell.index OSPRay takes can hold.
+//
+bool narrowOffsets(const std::vector<uint64_t> &offsets, uint32_t *starts, int numThreads)
+{
+    std::atomic<bool> tooLarge(false);
+    parallelChunks(offsets.size(),
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (offsets[i] > UINT32_MAX)
+                    tooLarge = true;
+                starts[i] = (uint32_t)offsets[i];
+            }
+        },
+        numThreads, minValuesPerThread);
+    return !tooLarge;
+}
+
+bool readVtu(const MappedFile &file, const MeshFileOptions &options,
+             UnstructuredMesh &mesh, int numThreads)
+{
+    const std::string &fileName = options.fileName;
+    VtuFile vtu;
+    if (!scanVtu(file, fileName, vtu))
+        return false;
+
+    Clock::time_point start = Clock::now();
+
+    if (vtu.points.components != 3)
+    {
+        fprintf(stderr, "'%s': points have %zu components, not 3\n",
+                fileName.c_str(), vtu.points.components);
+        return false;
+    }
+
+    bool cellValues = false;
+    const XmlArray *field = chooseField(vtu, options.fieldName, cellValues);
+    if (field == nullptr || field->components != 1)
+    {
+        fprintf(stderr, "'%s' has no point or cell array %s%s%swith one component\n",
+                fileName.c_str(), options.fieldName.empty() ? "" : "'",
+                options.fieldName.c_str(), options.fieldName.empty() ? "" : "' ");
+        return false;
+    }
+
+    // The offsets are where each cell ends, so they go one place on.
+    const size_t numCells = vtu.numCells;
+    mesh.positions.resize(3 * vtu.numPoints);
+    mesh.cellTypes.resize(numCells);
+    mesh.cellStarts.resize(numCells + 1);
+    std::vector<uint64_t> offsets(numCells);
+    if (!decodeXmlArray(vtu, vtu.points, 3 * vtu.numPoints, mesh.positions.data(),
+                        numThreads) ||
+        !decodeXmlArray(vtu, vtu.types, numCells, mesh.cellTypes.data(), numThreads) ||
+        !decodeXmlArray(vtu, vtu.offsets, numCells, offsets.data(), numThreads))
+        return false;
+    if (!narrowOffsets(offsets, mesh.cellStarts.data() + 1, numThreads))
+    {
+        fprintf(stderr, "'%s' has cell offsets past 2^32, more than OSPRay's cell.index "
+                "holds\n", fileName.c_str());
+        return false;
+    }
+    mesh.cellStarts[0] = 0;
+
+    mesh.indices.resize(mesh.cellStarts[numCells]);
+    mesh.cellStarts.pop_back();
+    if (!decodeXmlArray(vtu, vtu.connectivity, mesh.indices.size(), mesh.indices.data(),
+                        numThreads))
+        return false;
+
+    mesh.values.resize(cellValues ? numCells : vtu.numPoints);
+    if (!decodeXmlArray(vtu, *field, mesh.values.size(), mesh.values.data(), numThreads))
+        return false;
+
+    mesh.cellValues    = cellValues;
+    mesh.fieldName     = field->name;
+    mesh.decodeSeconds = secondsSince(start);
+    return true;
+}
+
+
+//
+// Binary legacy .vtk files: text keyword lines, each followed by its
+// values in big endian binary.
+//
+class LegacyReader
+{
+  public:
+    LegacyReader(const MappedFile &file)
+        : p(file.data),
+          end(file.data + file.size)
+    {}
+
+    //
+    // The next line, without its line break. Blank lines count unless
+    // skipBlank.
+    //
+    bool line(std::string &text, bool skipBlank = true)
+    {
+        if (skipBlank)
+            while (p < end && isSpace(*p))
+                ++p;
+        if (p >= end)
+            return false;
+
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        const char *stop = eol ? eol : end;
+        text.assign(p, stop);
+        while (!text.empty() && isSpace(text.back()))
+            text.pop_back();
+        p = eol ? eol + 1 : end;
+        return true;
+    }
+
+    //
+    // Step over count values of type, returning where they start, or
+    // nullptr if the file ends first.
+    //
+    const unsigned char *binary(size_t count, ScalarType type)
+    {
+        size_t bytes = count * scalarSize(type);
+        if ((size_t)(end - p) < bytes)
+            return nullptr;
+        const unsigned char *values = (const unsigned char *)p;
+        p += bytes;
+        return values;
+    }
+
+    bool startsWith(const char *prefix) const
+    {
+        size_t len = strlen(prefix);
+        return (size_t)(end - p) >= len && strncmp(p, prefix, len) == 0;
+    }
+
+  private:
+    const char *p;
+    const char *end;
+};
+
+//
+// An array of a legacy file, still in the mapped file.
+//
+struct LegacyArray
+{
+    std::string          name;
+    ScalarType           type;
+    size_t               count;
+    const unsigned char *values;
+};
+
+bool readLegacy(const MappedFile &file, const MeshFileOptions &options,
+                UnstructuredMesh &mesh, int numThreads)
+{
+    const std::string &fileName = options.fileName;
+    LegacyReader reader(file);
+    std::string text;
+
+    // Version, title and format lines; the title may be blank.
+    std::string version, title;
+    if (!reader.line(version) || version.compare(0, 14, "# vtk DataFile") != 0 ||
+        !reader.line(title, false) || !reader.line(text))
+    {
+        fprintf(stderr, "'%s' isn't a legacy VTK file\n", fileName.c_str());
+        return false;
+    }
+    if (text != "BINARY")
+    {
+        fprintf(stderr, "'%s' is %s; only BINARY legacy files are supported\n",
+                fileName.c_str(), text.c_str());
+        return false;
+    }
+
+    LegacyArray points = {"", SCALAR_FLOAT32, 0, nullptr};
+    LegacyArray cells = {"", SCALAR_INT32, 0, nullptr};
+    LegacyArray offsets = {"", SCALAR_INT64, 0, nullptr};
+    LegacyArray types = {"", SCALAR_INT32, 0, nullptr};
+    std::vector<LegacyArray> pointData, cellData;
+    size_t cellsSize = 0;
+
+    // Where attribute arrays go, and how many tuples they have.
+    std::vector<LegacyArray> *attributes = nullptr;
+    size_t tuples = 0;
+    bool havePointData = false, haveCellData = false;
+    size_t pointTuples = 0, cellTuples = 0;
+
+    auto bad = [&](const char *what)
+    {
+        fprintf(stderr, "'%s': bad or truncated %s\n", fileName.c_str(), what);
+        return false;
+    };
+
+    char keyword[64], name[256], typeName[64];
+    while (reader.line(text))
+    {
+        unsigned long long a = 0, b = 0;
+        keyword[0] = '\0';
+        sscanf(text.c_str(), "%63s", keyword);
+
+        ScalarType type;
+        if (strcmp(keyword, "DATASET") == 0)
+        {
+            typeName[0] = '\0';
+            sscanf(text.c_str(), "DATASET %63s", typeName);
+            if (strcmp(typeName, "UNSTRUCTURED_GRID") != 0)
+            {
+                fprintf(stderr, "'%s' holds a %s, not an unstructured grid\n",
+                        fileName.c_str(), typeName[0] ? typeName : "data set of no type");
+                return false;
+            }
+        }
+        else if (strcmp(keyword, "POINTS") == 0)
+        {
+            if (sscanf(text.c_str(), "POINTS %llu %63s", &a, typeName) != 2 ||
+                !parseLegacyType(typeName, points.type) ||
+                !(points.values = reader.binary(3 * a, points.type)))
+                return bad("POINTS");
+            points.count = 3 * a;
+        }
+        else if (strcmp(keyword, "CELLS") == 0)
+        {
+            if (sscanf(text.c_str(), "CELLS %llu %llu", &a, &b) != 2)
+                return bad("CELLS");
+
+            // Version 5.1 and later: offsets, then connectivity.
+            if (reader.startsWith("OFFSETS"))
+            {
+                if (!reader.line(text) ||
+                    sscanf(text.c_str(), "OFFSETS %63s", typeName) != 1 ||
+                    !parseLegacyType(typeName, offsets.type) ||
+                    !(offsets.values = reader.binary(a, offsets.type)) ||
+                    !reader.line(text) ||
+                    sscanf(text.c_str(), "CONNECTIVITY %63s", typeName) != 1 ||
+                    !parseLegacyType(typeName, cells.type) ||
+                    !(cells.values = reader.binary(b, cells.type)) || a == 0)
+                    return bad("CELLS");
+                offsets.count = a;
+                cells.count = b;
+            }
+            else
+            {
+                // Each cell's vertex count, then its vertices.
+                if (!(cells.values = reader.binary(b, SCALAR_INT32)))
+                    return bad("CELLS");
+                cells.type = SCALAR_INT32;
+                cells.count = b;
+                cellsSize = a;
+            }
+        }
+        else if (strcmp(keyword, "CELL_TYPES") == 0)
+        {
+            if (sscanf(text.c_str(), "CELL_TYPES %llu", &a) != 1 ||
+                !(types.values = reader.binary(a, SCALAR_INT32)))
+                return bad("CELL_TYPES");
+            types.count = a;
+        }
+        else if (strcmp(keyword, "POINT_DATA") == 0 || strcmp(keyword, "CELL_DATA") == 0)
+        {
+            if (sscanf(text.c_str(), "%*s %llu", &a) != 1)
+                return bad(keyword);
+            attributes = keyword[0] == 'P' ? &pointData : &cellData;
+            tuples = a;
+            (keyword[0] == 'P' ? havePointData : haveCellData) = true;
+            (keyword[0] == 'P' ? pointTuples : cellTuples) = a;
+        }
+        else if (strcmp(keyword, "SCALARS") == 0)
+        {
+            int components = 1;
+            if (sscanf(text.c_str(), "SCALARS %255s %63s %d", name, typeName, &components) < 2 ||
+                !parseLegacyType(typeName, type) || !attributes || components < 1)
+                return bad("SCALARS");
+
+            // Followed by the lookup table's name.
+            if (reader.startsWith("LOOKUP_TABLE") && !reader.line(text))
+                return bad("SCALARS");
+
+            const unsigned char *values = reader.binary(tuples * components, type);
+            if (!values)
+                return bad("SCALARS");
+            if (components == 1)
+                attributes->push_back({name, type, tuples, values});
+        }
+        else if (strcmp(keyword, "LOOKUP_TABLE") == 0)
+        {
+            // A color table of its own: RGBA bytes.
+            if (sscanf(text.c_str(), "LOOKUP_TABLE %255s %llu", name, &a) != 2 ||
+                !reader.binary(4 * a, SCALAR_UINT8))
+                return bad("LOOKUP_TABLE");
+        }
+        else if (strcmp(keyword, "COLOR_SCALARS") == 0)
+        {
+            if (sscanf(text.c_str(), "COLOR_SCALARS %255s %llu", name, &a) != 2 ||
+                !reader.binary(tuples * a, SCALAR_UINT8))
+                return bad("COLOR_SCALARS");
+        }
+        else if (strcmp(keyword, "VECTORS") == 0 || strcmp(keyword, "NORMALS") == 0 ||
+                 strcmp(keyword, "TENSORS") == 0 || strcmp(keyword, "TENSORS6") == 0)
+        {
+            size_t components = keyword[0] == 'T' ? (keyword[7] == '6' ? 6 : 9) : 3;
+            if (sscanf(text.c_str(), "%*s %255s %63s", name, typeName) != 2 ||
+                !parseLegacyType(typeName, type) ||
+                !reader.binary(tuples * components, type))
+                return bad(keyword);
+        }
+        else if (strcmp(keyword, "TEXTURE_COORDINATES") == 0)
+        {
+            if (sscanf(text.c_str(), "TEXTURE_COORDINATES %255s %llu %63s", name, &a,
+                       typeName) != 3 ||
+                !parseLegacyType(typeName, type) || !reader.binary(tuples * a, type))
+                return bad(keyword);
+        }
+        else if (strcmp(keyword, "FIELD") == 0)
+        {
+            // Arrays of any length; one component ones of the attribute
+            // data's length can be rendered.
+            unsigned long long count = 0;
+            if (sscanf(text.c_str(), "FIELD %255s %llu", name, &count) != 2)
+                return bad("FIELD");
+            for (unsigned long long i = 0; i < count; ++i)
+            {
+                if (!reader.line(text))
+                    return bad("FIELD");
+                if (strncmp(text.c_str(), "NULL_ARRAY", 10) == 0)
+                    continue;
+                if (sscanf(text.c_str(), "%255s %llu %llu %63s", name, &a, &b, typeName) != 4 ||
+                    !parseLegacyType(typeName, type))
+                    return bad("FIELD");
+
+                const unsigned char *values = reader.binary(a * b, type);
+                if (!values)
+                    return bad("FIELD");
+                if (attributes && a == 1 && b == tuples)
+                    attributes->push_back({name, type, tuples, values});
+                if (reader.startsWith("\nMETADATA") || reader.startsWith("METADATA"))
+                {
+                    reader.line(text);
+                    while (reader.line(text, false) && !text.empty())
+                        ;
+                }
+            }
+        }
+        else if (strcmp(keyword, "METADATA") == 0)
+        {
+            // Information keys, up to a blank line.
+            while (reader.line(text, false) && !text.empty())
+                ;
+        }
+        else
+        {
+            fprintf(stderr, "'%s': unknown keyword '%s'\n", fileName.c_str(), keyword);
+            return false;
+        }
+    }
+
+    if (!points.values || !cells.values || !types.values)
+    {
+        fprintf(stderr, "'%s' lacks POINTS, CELLS or CELL_TYPES\n", fileName.c_str());
+        return false;
+    }
+
+    // Attribute arrays one per point or cell, or OSPRay reads past them.
+    if (havePointData && pointTuples != points.count / 3)
+        return bad("POINT_DATA (not one tuple per point)");
+    if (haveCellData && cellTuples != types.count)
+        return bad("CELL_DATA (not one tuple per cell)");
+
+    // The field: the one named, or the first, points first.
+    bool cellValues = false;
+    const LegacyArray *field = nullptr;
+    for (int c = 0; c < 2 && !field; ++c)
+    {
+        for (const LegacyArray &array : c ? cellData : pointData)
+        {
+            if (options.fieldName.empty() || array.name == options.fieldName)
+            {
+                field = &array;
+                cellValues = c;
+                break;
+            }
+        }
+    }
+    if (field == nullptr)
+    {
+        fprintf(stderr, "'%s' has no point or cell array %s%s%swith one component\n",
+                fileName.c_str(), options.fieldName.empty() ? "" : "'",
+                options.fieldName.c_str(), options.fieldName.empty() ? "" : "' ");
+        return false;
+    }
+
+    Clock::time_point start = Clock::now();
+    const size_t numCells = types.count;
+
+    mesh.positions.resize(points.count);
+    convertParallel(points.values, points.type, true, points.count, mesh.positions.data(),
+                    numThreads);
+    mesh.cellTypes.resize(numCells);
+    if (!convertParallel(types.values, types.type, true, numCells, mesh.cellTypes.data(),
+                         numThreads))
+        return bad("CELL_TYPES");
+
+    if (offsets.values)
+    {
+        if (offsets.count != numCells + 1)
+            return bad("OFFSETS");
+        std::vector<uint64_t> ends(numCells + 1);
+        if (!convertParallel(offsets.values, offsets.type, true, numCells + 1, ends.data(),
+                             numThreads) ||
+            ends[0] != 0 || ends[numCells] != cells.count)
+            return bad("OFFSETS");
+
+        mesh.cellStarts.resize(numCells + 1);
+        if (!narrowOffsets(ends, mesh.cellStarts.data(), numThreads))
+            return bad("OFFSETS");
+        mesh.cellStarts.pop_back();
+
+        mesh.indices.resize(cells.count);
+        if (!convertParallel(cells.values, cells.type, true, cells.count,
+                             mesh.indices.data(), numThreads))
+            return bad("CONNECTIVITY");
+    }
+    else
+    {
+        if (cellsSize != numCells || cells.count - numCells > UINT32_MAX)
+            return bad("CELLS");
+
+        // Find where each cell starts, then copy the cells in parallel.
+        mesh.cellStarts.resize(numCells);
+        size_t at = 0;
+        for (size_t i = 0; i < numCells; ++i)
+        {
+            if (at >= cells.count)
+                return bad("CELLS");
+            int32_t count = loadScalar<int32_t>(cells.values + 4 * at, true);
+            if (count < 1)
+                return bad("CELLS");
+            mesh.cellStarts[i] = (uint32_t)(at - i);
+            at += 1 + count;
+        }
+        if (at != cells.count)
+            return bad("CELLS");
+
+        mesh.indices.resize(cells.count - numCells);
+        std::atomic<bool> negative(false);
+        parallelChunks(numCells,
+            [&](int, size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    size_t first = mesh.cellStarts[i];
+                    size_t last = i + 1 < numCells ? mesh.cellStarts[i + 1]
+                                                   : mesh.indices.size();
+                    if (!convertScalars(cells.values + 4 * (first + i + 1), SCALAR_INT32,
+                                        true, last - first, mesh.indices.data() + first))
+                        negative = true;
+                }
+            },
+            numThreads, minValuesPerThread);
+        if (negative)
+            return bad("CELLS");
+    }
+
+    mesh.values.resize(field->count);
+    convertParallel(field->values, field->type, true, field->count, mesh.values.data(),
+                    numThreads);
+
+    mesh.cellValues    = cellValues;
+    mesh.fieldName     = field->name;
+    mesh.decodeSeconds = secondsSince(start);
+    return true;
+}
+
+
+//
+// Turn voxels into hexahedra, whose last two vertices of each face are
+// the other way round, and check every cell is of a type OSPRay takes,
+// has that type's number of vertices, as OSPRay reads a fixed number
+// per type, and refers to vertices that exist.
+//
+bool finishCells(UnstructuredMesh &mesh, const std::string &fileName, int numThreads)
+{
+    const size_t numCells = mesh.cells();
+    const size_t numVertices = mesh.vertices();
+
+    std::atomic<int> badType(-1);
+    std::atomic<long long> badCount(-1);
+    std::atomic<bool> badIndex(false);
+    parallelChunks(numCells,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t expected;
+                switch (mesh.cellTypes[i])
+                {
+                case MESH_TETRAHEDRON: expected = 4; break;
+                case MESH_PYRAMID:     expected = 5; break;
+                case MESH_WEDGE:       expected = 6; break;
+                case MESH_VOXEL:
+                case MESH_HEXAHEDRON:  expected = 8; break;
+                default:
+                    badType = mesh.cellTypes[i];
+                    continue;
+                }
+
+                size_t first = mesh.cellStarts[i];
+                size_t last = i + 1 < numCells ? mesh.cellStarts[i + 1] : mesh.indices.size();
+                if (first > last || last > mesh.indices.size() || last - first != expected)
+                {
+                    badCount = (long long)i;
+                    continue;
+                }
+
+                for (size_t j = first; j < last; ++j)
+                    if (mesh.indices[j] >= numVertices)
+                        badIndex = true;
+
+                if (mesh.cellTypes[i] == MESH_VOXEL)
+                {
+                    uint32_t *v = mesh.indices.data() + first;
+                    std::swap(v[2], v[3]);
+                    std::swap(v[6], v[7]);
+                    mesh.cellTypes[i] = MESH_HEXAHEDRON;
+                }
+            }
+        },
+        numThreads, minValuesPerThread);
+
+    if (badType >= 0)
+    {
+        fprintf(stderr, "'%s' has cells of VTK type %d; only tetrahedra, hexahedra, "
+                "voxels, wedges and pyramids are supported\n", fileName.c_str(),
+                (int)badType);
+        return false;
+    }
+    if (badCount >= 0)
+    {
+        fprintf(stderr, "'%s': cell %lld has the wrong number of vertices for its type\n",
+                fileName.c_str(), (long long)badCount);
+        return false;
+    }
+    if (badIndex)
+    {
+        fprintf(stderr, "'%s' has cells referring to vertices past its %zu\n",
+                fileName.c_str(), numVertices);
+        return false;
+    }
+    return true;
+}
+
+}
+
+
+bool readMeshFile(const MeshFileOptions &options, UnstructuredMesh &mesh, int numThreads)
+{
+    Clock::time_point start = Clock::now();
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    MappedFile file(options.fileName);
+    if (file.data == nullptr)
+        return false;
+
+    mesh = UnstructuredMesh();
+    bool ok;
+    if (endsWith(options.fileName, ".vtu"))
+        ok = readVtu(file, options, mesh, numThreads);
+    else if (endsWith(options.fileName, ".vtk"))
+        ok = readLegacy(file, options, mesh, numThreads);
+    else
+    {
+        fprintf(stderr, "'%s' is neither .vtu nor .vtk\n", options.fileName.c_str());
+        return false;
+    }
+    if (!ok || !finishCells(mesh, options.fileName, numThreads))
+    {
+        mesh = UnstructuredMesh();
+        return false;
+    }
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), " (%zu vertices, %zu cells, %s '%s', mtime %lld)",
+             mesh.vertices(), mesh.cells(), mesh.cellValues ? "cell" : "point",
+             mesh.fieldName.c_str(), file.modified);
+    mesh.description = options.fileName + summary;
+    mesh.readSeconds = secondsSince(start);
+    return true;
+}
+
+
+void meshBounds(const UnstructuredMesh &mesh, float lower[3], float upper[3], int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    const size_t n = mesh.vertices();
+    std::vector<float> partial(6 * numThreads);
+    int numChunks = parallelChunks(n,
+        [&](int chunk, size_t begin, size_t end)
+        {
+            float *bounds = partial.data() + 6 * chunk;
+            if (begin == end)
+                return;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                bounds[axis]     = mesh.positions[3 * begin + axis];
+                bounds[3 + axis] = mesh.positions[3 * begin + axis];
+            }
+            for (size_t i = begin; i < end; ++i)
+            {
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    float x = mesh.positions[3 * i + axis];
+                    bounds[axis]     = std::min(bounds[axis], x);
+                    bounds[3 + axis] = std::max(bounds[3 + axis], x);
+                }
+            }
+        },
+        numThreads, minValuesPerThread);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        lower[axis] = n ? partial[axis] : 0.0f;
+        upper[axis] = n ? partial[3 + axis] : 0.0f;
+        for (int chunk = 1; chunk < numChunks; ++chunk)
+        {
+            lower[axis] = std::min(lower[axis], partial[6 * chunk + axis]);
+            upper[axis] = std::max(upper[axis], partial[6 * chunk + 3 + axis]);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+//
+// Unstructured grid files, read without VTK: VTK XML .vtu files with
+// binary (base64) or appended (raw or base64) arrays, optionally zlib
+// compressed, and binary legacy .vtk files.
+//
+// The file is mapped and its markup scanned once, front to back,
+// without building a document; the arrays are then decoded on every
+// core, base64 and zlib blocks alike, straight into the layout
+// OSPRay's unstructured volume takes. Only the output arrays and, for
+// base64, one array's decoded bytes are ever held in memory, rather
+// than the VTK data set and a copy of it.
+//
+// Tetrahedra, hexahedra, wedges and pyramids are read, and voxels are
+// turned into hexahedra; other cell types are an error. A file holds
+// one piece.
+//
+
+#ifndef OSPRAY_DEMOS_MESH_FILE_H
+#define OSPRAY_DEMOS_MESH_FILE_H
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Cell types, numbered as both VTK and OSPRay number them.
+//
+enum MeshCellType
+{
+    MESH_TETRAHEDRON = 10,
+    MESH_VOXEL       = 11,
+    MESH_HEXAHEDRON  = 12,
+    MESH_WEDGE       = 13,
+    MESH_PYRAMID     = 14
+};
+
+//
+// Mesh file options as given on the command line.
+//
+//   --mesh FILE            a .vtu or binary legacy .vtk unstructured grid
+//   --mesh-field NAME      the point or cell array to render (default the
+//                          first with one component)
+//
+struct MeshFileOptions
+{
+    std::string fileName;
+    std::string fieldName;
+
+    bool enabled() const { return !fileName.empty(); }
+};
+
+MeshFileOptions parseMeshFileOptions(int argc, const char **argv);
+
+//
+// An unstructured grid as OSPRay's "unstructured" volume takes it.
+//
+struct UnstructuredMesh
+{
+    // x, y and z of every vertex.
+    std::vector<float> positions;
+
+    // The vertices of every cell, one cell after the other.
+    std::vector<uint32_t> indices;
+
+    // Where each cell's vertices start in indices.
+    std::vector<uint32_t> cellStarts;
+
+    // A MeshCellType for each cell.
+    std::vector<uint8_t> cellTypes;
+
+    // The field, one value per vertex or, if cellValues, per cell.
+    std::vector<float> values;
+    bool               cellValues;
+    std::string        fieldName;
+
+    // The file, its size and when it was modified, for cache keys.
+    std::string description;
+
+    // Seconds reading took, and the part of that spent decoding.
+    double readSeconds;
+    double decodeSeconds;
+
+    UnstructuredMesh()
+        : cellValues(false),
+          readSeconds(0.0),
+          decodeSeconds(0.0)
+    {}
+
+    size_t vertices() const { return positions.size() / 3; }
+    size_t cells() const { return cellTypes.size(); }
+};
+
+//
+// Read the file options names into mesh on numThreads threads (one
+// per core for 0), choosing the format by its extension. Returns false
+// on failure, which is printed.
+//
+bool readMeshFile(const MeshFileOptions &options, UnstructuredMesh &mesh,
+                  int numThreads = 0);
+
+//
+// The bounds of the mesh's vertices.
+//
+void meshBounds(const UnstructuredMesh &mesh, float lower[3], float upper[3],
+                int numThreads = 0);
+
+#endif
@@ -0,0 +1,321 @@
+//
+// Space filling curve order for unstructured meshes.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+
+#include "meshReorder.h"
+#include "parallelFor.h"
+
+namespace {
+
+const char *orderNames[] = {"file", "morton", "hilbert"};
+const int numOrders = sizeof(orderNames) / sizeof(orderNames[0]);
+
+// Items per thread below which a loop runs on one thread.
+const size_t minItemsPerThread = 1 << 14;
+
+// Bits of each coordinate in a key; three of them fill 63 bits.
+const int keyBits = 21;
+
+//
+// Spread the low 21 bits of v out to every third bit.
+//
+uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8)  & 0x100f00f00f00f00full;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2)  & 0x1249249249249249ull;
+    return v;
+}
+
+uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z)
+{
+    return spreadBits(x) << 2 | spreadBits(y) << 1 | spreadBits(z);
+}
+
+//
+// Skilling's transform ("Programming the Hilbert curve", 2004): turn
+// coordinates into the transposed Hilbert index in place, whose bits
+// interleaved like a Morton key give the distance along the curve.
+//
+uint64_t hilbertKey(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t X[3] = {x, y, z};
+    const uint32_t M = 1u << (keyBits - 1);
+
+    for (uint32_t Q = M; Q > 1; Q >>= 1)
+    {
+        uint32_t P = Q - 1;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (X[i] & Q)
+                X[0] ^= P;
+            else
+            {
+                uint32_t t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+
+    for (int i = 1; i < 3; ++i)
+        X[i] ^= X[i - 1];
+    uint32_t t = 0;
+    for (uint32_t Q = M; Q > 1; Q >>= 1)
+        if (X[2] & Q)
+            t ^= Q - 1;
+    for (int i = 0; i < 3; ++i)
+        X[i] ^= t;
+
+    return mortonKey(X[0], X[1], X[2]);
+}
+
+//
+// Maps points in the mesh's bounds onto the curve.
+//
+class CurveKeys
+{
+  public:
+    CurveKeys(const UnstructuredMesh &mesh, MeshOrder order, int numThreads)
+        : order(order)
+    {
+        float upper[3];
+        meshBounds(mesh, lower, upper, numThreads);
+        const float cells = (float)((1u << keyBits) - 1);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float extent = upper[axis] - lower[axis];
+            scale[axis] = extent > 0.0f ? cells / extent : 0.0f;
+        }
+    }
+
+    uint64_t operator()(const float p[3]) const
+    {
+        uint32_t q[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float x = (p[axis] - lower[axis]) * scale[axis];
+            q[axis] = (uint32_t)std::min(std::max(x, 0.0f),
+                                         (float)((1u << keyBits) - 1));
+        }
+        return order == MESH_ORDER_HILBERT ? hilbertKey(q[0], q[1], q[2])
+                                           : mortonKey(q[0], q[1], q[2]);
+    }
+
+  private:
+    MeshOrder order;
+    float     lower[3];
+    float     scale[3];
+};
+
+typedef std::pair<uint64_t, uint32_t> KeyedItem;
+
+//
+// Sort by key, ties by item, so the order is the same on any number of
+// threads: each thread sorts its chunk, then pairs of sorted runs are
+// merged in parallel until one is left.
+//
+void parallelSort(std::vector<KeyedItem> &items, int numThreads)
+{
+    std::vector<size_t> runs(1, 0);
+    int numChunks = parallelChunks(items.size(),
+        [&](int, size_t begin, size_t end)
+        {
+            std::sort(items.begin() + begin, items.begin() + end);
+        },
+        numThreads, minItemsPerThread);
+    for (int i = 1; i <= numChunks; ++i)
+        runs.push_back(items.size() * i / numChunks);
+
+    while (runs.size() > 2)
+    {
+        const size_t pairs = (runs.size() - 1) / 2;
+        parallelChunks(pairs,
+            [&](int, size_t begin, size_t end)
+            {
+                for (size_t p = begin; p < end; ++p)
+                    std::inplace_merge(items.begin() + runs[2 * p],
+                                       items.begin() + runs[2 * p + 1],
+                                       items.begin() + runs[2 * p + 2]);
+            },
+            numThreads, 1);
+
+        std::vector<size_t> merged;
+        for (size_t r = 0; r < runs.size(); r += 2)
+            merged.push_back(runs[r]);
+        if (merged.back() != runs.back())
+            merged.push_back(runs.back());
+        runs.swap(merged);
+    }
+}
+
+//
+// out[i] = in[order[i]] for every item of components values.
+//
+template <typename T>
+void gather(std::vector<T> &values, const std::vector<KeyedItem> &order, size_t components,
+            int numThreads)
+{
+    std::vector<T> out(values.size());
+    parallelChunks(order.size(),
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                for (size_t c = 0; c < components; ++c)
+                    out[components * i + c] = values[components * order[i].second + c];
+        },
+        numThreads, minItemsPerThread);
+    values.swap(out);
+}
+
+}
+
+
+const char *meshOrderName(MeshOrder order)
+{
+    return order < numOrders ? orderNames[order] : "unknown";
+}
+
+
+MeshOrderOptions parseMeshOrderOptions(int argc, const char **argv)
+{
+    MeshOrderOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--mesh-order") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int o = 0;
+            while (o < numOrders && strcmp(name, orderNames[o]) != 0)
+                ++o;
+            if (o < numOrders)
+                options.order = (MeshOrder)o;
+            else
+                fprintf(stderr, "Unknown --mesh-order '%s' (expected file, morton "
+                        "or hilbert)\n", name);
+        }
+    }
+
+    return options;
+}
+
+
+double reorderMesh(UnstructuredMesh &mesh, MeshOrder order, int numThreads)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    if (order == MESH_ORDER_FILE)
+        return 0.0;
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    const CurveKeys curveKeys(mesh, order, numThreads);
+    const size_t numCells = mesh.cells();
+    const size_t numVertices = mesh.vertices();
+    auto cellEnd = [&](size_t cell)
+    {
+        return cell + 1 < numCells ? mesh.cellStarts[cell + 1] : mesh.indices.size();
+    };
+
+    // Cells by the key of their centroid.
+    std::vector<KeyedItem> cells(numCells);
+    parallelChunks(numCells,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                float centroid[3] = {0.0f, 0.0f, 0.0f};
+                size_t first = mesh.cellStarts[i], last = cellEnd(i);
+                for (size_t j = first; j < last; ++j)
+                    for (int axis = 0; axis < 3; ++axis)
+                        centroid[axis] += mesh.positions[3 * mesh.indices[j] + axis];
+                for (int axis = 0; axis < 3; ++axis)
+                    centroid[axis] /= std::max<size_t>(1, last - first);
+                cells[i] = KeyedItem(curveKeys(centroid), (uint32_t)i);
+            }
+        },
+        numThreads, minItemsPerThread);
+
+    // Vertices by the key of their position.
+    std::vector<KeyedItem> vertices(numVertices);
+    parallelChunks(numVertices,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                vertices[i] = KeyedItem(curveKeys(&mesh.positions[3 * i]), (uint32_t)i);
+        },
+        numThreads, minItemsPerThread);
+
+    parallelSort(cells, numThreads);
+    parallelSort(vertices, numThreads);
+
+    // Where each vertex went.
+    std::vector<uint32_t> newVertex(numVertices);
+    parallelChunks(numVertices,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                newVertex[vertices[i].second] = (uint32_t)i;
+        },
+        numThreads, minItemsPerThread);
+
+    //
+    // Where each cell starts in the new order: a prefix sum of the cell
+    // sizes, each thread summing its chunk, then offsetting it by the
+    // chunks before.
+    //
+    std::vector<uint32_t> cellStarts(numCells);
+    std::vector<size_t> chunkSums(numThreads + 1, 0);
+    int numChunks = parallelChunks(numCells,
+        [&](int chunk, size_t begin, size_t end)
+        {
+            size_t sum = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t old = cells[i].second;
+                cellStarts[i] = (uint32_t)sum;
+                sum += cellEnd(old) - mesh.cellStarts[old];
+            }
+            chunkSums[chunk + 1] = sum;
+        },
+        numThreads, minItemsPerThread);
+    for (int chunk = 1; chunk <= numChunks; ++chunk)
+        chunkSums[chunk] += chunkSums[chunk - 1];
+
+    // Same chunks again: offset the starts and copy the remapped cells.
+    std::vector<uint32_t> indices(mesh.indices.size());
+    parallelChunks(numCells,
+        [&](int chunk, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t old = cells[i].second;
+                cellStarts[i] += (uint32_t)chunkSums[chunk];
+
+                uint32_t *out = &indices[cellStarts[i]];
+                for (size_t j = mesh.cellStarts[old]; j < cellEnd(old); ++j)
+                    *out++ = newVertex[mesh.indices[j]];
+            }
+        },
+        numThreads, minItemsPerThread);
+
+    mesh.indices.swap(indices);
+    mesh.cellStarts.swap(cellStarts);
+    gather(mesh.cellTypes, cells, 1, numThreads);
+    gather(mesh.positions, vertices, 3, numThreads);
+    gather(mesh.values, mesh.cellValues ? cells : vertices, 1, numThreads);
+
+    mesh.description += std::string(", ") + meshOrderName(order) + " order";
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,56 @@
+//
+// Space filling curve order for unstructured meshes.
+//
+// Simulation codes write cells and vertices in whatever order their
+// partitioning left them, so cells next to each other in space are far
+// apart in memory, and so are the vertices of a single cell. Sorting
+// cells along a Morton or Hilbert curve through their centroids, and
+// vertices along the same curve through their positions, keeps what is
+// close in space close in memory, which helps both the BVH build and
+// every ray that walks through neighboring cells.
+//
+// Keys, sorting, the index remap and the permutation of every array
+// all run on every core.
+//
+
+#ifndef OSPRAY_DEMOS_MESH_REORDER_H
+#define OSPRAY_DEMOS_MESH_REORDER_H
+
+#include "meshFile.h"
+
+enum MeshOrder
+{
+    MESH_ORDER_FILE,       // as the file has it
+    MESH_ORDER_MORTON,     // along a Morton (Z order) curve
+    MESH_ORDER_HILBERT     // along a Hilbert curve
+};
+
+const char *meshOrderName(MeshOrder order);
+
+//
+// Mesh order as given on the command line.
+//
+//   --mesh-order ORDER     file (default), morton or hilbert
+//
+struct MeshOrderOptions
+{
+    MeshOrder order;
+
+    MeshOrderOptions()
+        : order(MESH_ORDER_FILE)
+    {}
+
+    bool enabled() const { return order != MESH_ORDER_FILE; }
+};
+
+MeshOrderOptions parseMeshOrderOptions(int argc, const char **argv);
+
+//
+// Put the mesh's cells and vertices in order, remapping indices and
+// permuting positions, cell types and values to match, on numThreads
+// threads (one per core for 0). The order goes into the mesh's
+// description. Returns the seconds it took.
+//
+double reorderMesh(UnstructuredMesh &mesh, MeshOrder order, int numThreads = 0);
+
+#endif
@@ -0,0 +1,54 @@
+//
+// A minimal static parallel loop for the demo helpers.
+//
+
+#ifndef OSPRAY_DEMOS_PARALLEL_FOR_H
+#define OSPRAY_DEMOS_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+
+//
+// The number of threads parallelChunks uses when not told otherwise.
+//
+inline int defaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//
+// Split [0, n) into one contiguous chunk per thread, in order, and
+// call body(chunk, begin, end) for each chunk on its own thread. The
+// calling thread takes chunk 0. Chunks hold at least minChunk items,
+// so small loops run on fewer threads, or just the caller.
+//
+// Chunk i always covers the same range for the same n and thread
+// count, which makes per-chunk results (partial sums, min/max) easy to
+// combine deterministically, and means memory written by a chunk is
+// first touched by the thread that keeps using it.
+//
+// Returns the number of chunks, 1 to numThreads.
+//
+template <typename Body>
+int parallelChunks(size_t n, Body body, int numThreads = 0, size_t minChunk = 1)
+{
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    size_t maxChunks = std::max<size_t>(1, n / std::max<size_t>(1, minChunk));
+    int numChunks = (int)std::min<size_t>(numThreads, maxChunks);
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < numChunks; ++i)
+        workers.push_back(std::thread(body, i, n * i / numChunks,
+                                      n * (i + 1) / numChunks));
+    body(0, (size_t)0, n / numChunks);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    return numChunks;
+}
+
+#endif
@@ -0,0 +1,54 @@
+//
+// Writing of rendered frames as PFM (portable float map) files.
+//
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+
+#include "pfmFile.h"
+#include "fileUtil.h"
+
+bool writePFM(const char *fileName,
+              int width,
+              int height,
+              const float *pixel,
+              FileWriteTimes *times)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    static thread_local std::vector<float> buffer;
+
+    // A negative scale marks the data as little endian.
+    char header[64];
+    int headerBytes = snprintf(header, sizeof(header), "PF\n%i %i\n-1.0\n",
+                               width, height);
+
+    size_t numPixels = (size_t)width * height;
+    if (buffer.size() < 3 * numPixels)
+        buffer.resize(3 * numPixels);
+
+    float *out = buffer.data();
+    for (size_t i = 0; i < numPixels; ++i)
+    {
+        out[3*i + 0] = pixel[4*i + 0];
+        out[3*i + 1] = pixel[4*i + 1];
+        out[3*i + 2] = pixel[4*i + 2];
+    }
+
+    Clock::time_point converted = Clock::now();
+
+    struct iovec pieces[] = {
+        {header, (size_t)headerBytes},
+        {buffer.data(), 3 * numPixels * sizeof(float)},
+    };
+    bool ok = writeFileV(fileName, pieces, 2);
+
+    if (times)
+    {
+        times->convert = std::chrono::duration<double>(converted - start).count();
+        times->write   = std::chrono::duration<double>(Clock::now() - converted).count();
+    }
+    return ok;
+}
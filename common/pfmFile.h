@@ -0,0 +1,21 @@
+//
+// Writing of rendered frames as PFM (portable float map) files.
+//
+
+#ifndef OSPRAY_DEMOS_PFM_FILE_H
+#define OSPRAY_DEMOS_PFM_FILE_H
+
+#include "fileUtil.h"
+
+//
+// Write an RGBA32F framebuffer as a color PFM. PFM stores the bottom
+// row first, just like OSPRay, so only the alpha channel is dropped.
+// When times is given, it receives the time spent converting and writing.
+//
+bool writePFM(const char *fileName,
+              int width,
+              int height,
+              const float *pixel,
+              FileWriteTimes *times = nullptr);
+
+#endif
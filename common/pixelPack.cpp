@@ -0,0 +1,195 @@
+//
+// Conversion of OSPRay's RGBA8 framebuffers into packed RGB8 images.
+//
+
+#include "pixelPack.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PIXEL_PACK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void packRowScalar(const unsigned char *in,
+                   unsigned char *out,
+                   int begin,
+                   int width)
+{
+    for (int x = begin; x < width; x++)
+    {
+        out[3*x + 0] = in[4*x + 0];
+        out[3*x + 1] = in[4*x + 1];
+        out[3*x + 2] = in[4*x + 2];
+    }
+}
+
+#ifdef PIXEL_PACK_X86
+
+//
+// Packs 16 pixels into three full 16 byte stores, then finishes the
+// row 4 pixels at a time and the last few pixels one at a time.
+//
+__attribute__((target("ssse3")))
+void packRowSSSE3(const unsigned char *in,
+                  unsigned char *out,
+                  int width)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                                          10, 12, 13, 14, -1, -1, -1, -1);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i *src = (const __m128i *)(in + 4*x);
+        __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128(src + 0), shuffle);
+        __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128(src + 1), shuffle);
+        __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128(src + 2), shuffle);
+        __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128(src + 3), shuffle);
+
+        __m128i *dst = (__m128i *)(out + 3*x);
+        _mm_storeu_si128(dst + 0, _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+        _mm_storeu_si128(dst + 1, _mm_or_si128(_mm_srli_si128(p1, 4),
+                                               _mm_slli_si128(p2, 8)));
+        _mm_storeu_si128(dst + 2, _mm_or_si128(_mm_srli_si128(p2, 8),
+                                               _mm_slli_si128(p3, 4)));
+    }
+
+    // Each store writes 4 bytes past the 4 pixels it packs, so stop
+    // while that stays inside the row.
+    for (; x + 6 <= width; x += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *)(in + 4*x));
+        _mm_storeu_si128((__m128i *)(out + 3*x), _mm_shuffle_epi8(p, shuffle));
+    }
+
+    packRowScalar(in, out, x, width);
+}
+
+//
+// Packs 8 pixels per iteration. The shuffle works within each 128 bit
+// lane, so the two 12 byte halves are joined with a cross lane permute
+// and written with a 32 byte store that overlaps the next iteration.
+//
+__attribute__((target("avx2")))
+void packRowAVX2(const unsigned char *in,
+                 unsigned char *out,
+                 int width)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                                             10, 12, 13, 14, -1, -1, -1, -1,
+                                             0, 1, 2, 4, 5, 6, 8, 9,
+                                             10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    int x = 0;
+
+    for (; x + 11 <= width; x += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(in + 4*x));
+        p = _mm256_shuffle_epi8(p, shuffle);
+        p = _mm256_permutevar8x32_epi32(p, compact);
+        _mm256_storeu_si256((__m256i *)(out + 3*x), p);
+    }
+
+    packRowScalar(in, out, x, width);
+}
+
+#endif
+
+typedef void (*PackRowFunc)(const unsigned char *, unsigned char *, int);
+
+void packRowScalarFull(const unsigned char *in,
+                       unsigned char *out,
+                       int width)
+{
+    packRowScalar(in, out, 0, width);
+}
+
+PixelPackPath bestPath()
+{
+#ifdef PIXEL_PACK_X86
+    if (__builtin_cpu_supports("avx2"))
+        return PIXEL_PACK_AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return PIXEL_PACK_SSSE3;
+#endif
+    return PIXEL_PACK_SCALAR;
+}
+
+PackRowFunc rowFunc(PixelPackPath path)
+{
+    if (path == PIXEL_PACK_BEST)
+    {
+        static const PixelPackPath best = bestPath();
+        path = best;
+    }
+
+    switch (path)
+    {
+#ifdef PIXEL_PACK_X86
+        case PIXEL_PACK_AVX2:
+            return packRowAVX2;
+        case PIXEL_PACK_SSSE3:
+            return packRowSSSE3;
+#endif
+        default:
+            return packRowScalarFull;
+    }
+}
+
+}
+
+
+bool pixelPackSupported(PixelPackPath path)
+{
+    switch (path)
+    {
+#ifdef PIXEL_PACK_X86
+        case PIXEL_PACK_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case PIXEL_PACK_SSSE3:
+            return __builtin_cpu_supports("ssse3");
+#else
+        case PIXEL_PACK_AVX2:
+        case PIXEL_PACK_SSSE3:
+            return false;
+#endif
+        default:
+            return true;
+    }
+}
+
+
+const char *pixelPackName(PixelPackPath path)
+{
+    switch (path)
+    {
+        case PIXEL_PACK_SCALAR:
+            return "scalar";
+        case PIXEL_PACK_SSSE3:
+            return "ssse3";
+        case PIXEL_PACK_AVX2:
+            return "avx2";
+        default:
+            return pixelPackName(bestPath());
+    }
+}
+
+
+void packRGBFlipped(const uint32_t *pixel,
+                    int width,
+                    int height,
+                    unsigned char *out,
+                    PixelPackPath path,
+                    size_t outStride)
+{
+    PackRowFunc packRow = rowFunc(path);
+    const size_t rowBytes = outStride ? outStride : 3 * (size_t)width;
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *in =
+            (const unsigned char *)&pixel[(size_t)(height-1-y)*width];
+        packRow(in, out + y*rowBytes, width);
+    }
+}
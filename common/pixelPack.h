@@ -0,0 +1,44 @@
+//
+// Conversion of OSPRay's RGBA8 framebuffers into packed RGB8 images.
+//
+// OSPRay framebuffers store the bottom row first, while image files
+// want the top row first, so every row is flipped vertically while the
+// alpha channel is dropped. SSSE3 and AVX2 byte shuffles are used when
+// the CPU supports them, with a scalar fallback everywhere else.
+//
+
+#ifndef OSPRAY_DEMOS_PIXEL_PACK_H
+#define OSPRAY_DEMOS_PIXEL_PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum PixelPackPath
+{
+    PIXEL_PACK_SCALAR,
+    PIXEL_PACK_SSSE3,
+    PIXEL_PACK_AVX2,
+    PIXEL_PACK_BEST
+};
+
+//
+// Whether the given path can run on this CPU. PIXEL_PACK_BEST and
+// PIXEL_PACK_SCALAR are always supported.
+//
+bool pixelPackSupported(PixelPackPath path);
+
+const char *pixelPackName(PixelPackPath path);
+
+//
+// Pack a width x height RGBA8 image into RGB8 rows at out, flipping it
+// vertically on the way. Output rows are outStride bytes apart, which
+// defaults to the packed 3 * width.
+//
+void packRGBFlipped(const uint32_t *pixel,
+                    int width,
+                    int height,
+                    unsigned char *out,
+                    PixelPackPath path = PIXEL_PACK_BEST,
+                    size_t outStride = 0);
+
+#endif
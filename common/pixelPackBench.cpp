@@ -0,0 +1,125 @@
+//
+// Micro-benchmark for the RGBA -> RGB pack and flip used when writing
+// PPM frames. Reports throughput in GB/s of RGBA input for each pack
+// path the CPU supports, for whole writePPM calls, and for the RGBA ->
+// YUV 4:2:0 conversion used by the y4m sink.
+//
+// Usage: pixel_pack_bench [outputFile]
+//
+// outputFile defaults to /dev/null, which measures the syscall cost
+// without the disk.
+//
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pixelPack.h"
+#include "ppmFile.h"
+#include "yuvConvert.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+//
+// Run func repeatedly for at least minSeconds and return the average
+// seconds per call.
+//
+template <typename FUNC>
+double timeIt(FUNC func, double minSeconds = 0.5)
+{
+    func();
+
+    int calls = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    do
+    {
+        func();
+        ++calls;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+
+    return elapsed / calls;
+}
+
+}
+
+
+int main(int argc, const char **argv)
+{
+    const char *outFile = argc > 1 ? argv[1] : "/dev/null";
+
+    struct Size { int width, height; const char *name; };
+    const Size sizes[] = {
+        {1024,  768, "1024x768"},
+        {1920, 1080, "1920x1080"},
+        {3840, 2160, "3840x2160 (4K)"},
+        {7680, 4320, "7680x4320 (8K)"},
+    };
+
+    const PixelPackPath paths[] = {
+        PIXEL_PACK_SCALAR,
+        PIXEL_PACK_SSSE3,
+        PIXEL_PACK_AVX2,
+    };
+
+    printf("%-16s %-10s %10s %10s\n", "size", "path", "ms/frame", "GB/s");
+
+    for (const Size &size : sizes)
+    {
+        size_t numPixels = (size_t)size.width * size.height;
+        double inputGB   = numPixels * sizeof(uint32_t) / 1e9;
+
+        std::vector<uint32_t> pixels(numPixels);
+        for (size_t i = 0; i < numPixels; ++i)
+            pixels[i] = (uint32_t)(i * 2654435761u);
+
+        std::vector<unsigned char> out(3 * numPixels);
+
+        for (PixelPackPath path : paths)
+        {
+            if (!pixelPackSupported(path))
+                continue;
+
+            double seconds = timeIt([&]()
+            {
+                packRGBFlipped(pixels.data(), size.width, size.height,
+                               out.data(), path);
+            });
+
+            printf("%-16s %-10s %10.3f %10.2f\n", size.name,
+                   pixelPackName(path), seconds * 1e3, inputGB / seconds);
+        }
+
+        double seconds = timeIt([&]()
+        {
+            writePPM(outFile, size.width, size.height, pixels.data());
+        });
+
+        printf("%-16s %-10s %10.3f %10.2f\n", size.name, "writePPM",
+               seconds * 1e3, inputGB / seconds);
+
+        std::vector<unsigned char> yuv(numPixels + 2 * (size_t)chromaWidth(size.width)
+                                                     * chromaHeight(size.height));
+        for (bool simd : {false, true})
+        {
+            unsigned char *y = yuv.data();
+            unsigned char *u = y + numPixels;
+            unsigned char *v = u + (size_t)chromaWidth(size.width) * chromaHeight(size.height);
+
+            seconds = timeIt([&]()
+            {
+                convertYUV420Flipped(pixels.data(), size.width, size.height,
+                                     y, u, v, simd);
+            });
+
+            printf("%-16s %-10s %10.3f %10.2f\n", size.name,
+                   simd ? "yuv420" : "yuv420-c", seconds * 1e3, inputGB / seconds);
+        }
+    }
+
+    return 0;
+}
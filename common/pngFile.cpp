@@ -0,0 +1,203 @@
+//
+// Writing of rendered frames as PNG files.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "pngFile.h"
+#include "fileUtil.h"
+#include "pixelPack.h"
+
+namespace {
+
+void putBigEndian(unsigned char *out, uint32_t value)
+{
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)(value);
+}
+
+//
+// One horizontal band of the image, compressed as raw deflate data
+// that ends on a byte boundary so the bands can be concatenated.
+//
+struct Strip
+{
+    int                        firstRow;
+    int                        numRows;
+    std::vector<unsigned char> raw;
+    std::vector<unsigned char> deflated;
+    uLong                      adler;
+    uLong                      crc;
+    bool                       ok;
+};
+
+void compressStrip(Strip &strip,
+                   const uint32_t *pixel,
+                   int width,
+                   int height,
+                   int level,
+                   bool last)
+{
+    const size_t rowBytes = 3 * (size_t)width + 1;
+
+    // Every scanline starts with its filter type, 0 (none).
+    strip.raw.resize(rowBytes * strip.numRows);
+    for (int y = 0; y < strip.numRows; ++y)
+        strip.raw[y * rowBytes] = 0;
+
+    // Image row firstRow is framebuffer row height-1-firstRow, so this
+    // band is the framebuffer rows just below that, flipped.
+    const uint32_t *bottom =
+        pixel + (size_t)(height - strip.firstRow - strip.numRows) * width;
+    packRGBFlipped(bottom, width, strip.numRows, strip.raw.data() + 1,
+                   PIXEL_PACK_BEST, rowBytes);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    strip.ok = deflateInit2(&stream, level, Z_DEFLATED, -15, 8,
+                            Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!strip.ok)
+        return;
+
+    // Room for the worst case plus the empty block of a sync flush.
+    strip.deflated.resize(deflateBound(&stream, strip.raw.size()) + 16);
+
+    stream.next_in   = strip.raw.data();
+    stream.avail_in  = strip.raw.size();
+    stream.next_out  = strip.deflated.data();
+    stream.avail_out = strip.deflated.size();
+
+    int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    strip.ok = last ? result == Z_STREAM_END : result == Z_OK;
+    strip.deflated.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    strip.adler = adler32(adler32(0, nullptr, 0), strip.raw.data(), strip.raw.size());
+    strip.crc   = crc32(crc32(0, nullptr, 0), strip.deflated.data(),
+                        strip.deflated.size());
+}
+
+}
+
+
+bool writePNG(const char *fileName,
+              int width,
+              int height,
+              const uint32_t *pixel,
+              int level,
+              int numThreads,
+              FileWriteTimes *times)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Don't bother splitting into strips of only a few rows.
+    const int minRows = 32;
+    int numStrips = std::max(1, std::min(numThreads, height / minRows));
+
+    std::vector<Strip> strips(numStrips);
+    for (int i = 0; i < numStrips; ++i)
+    {
+        strips[i].firstRow = (int)((long long)height * i / numStrips);
+        strips[i].numRows  = (int)((long long)height * (i + 1) / numStrips)
+                             - strips[i].firstRow;
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < numStrips; ++i)
+        workers.push_back(std::thread(compressStrip, std::ref(strips[i]),
+                                      pixel, width, height, level,
+                                      i == numStrips - 1));
+    compressStrip(strips[0], pixel, width, height, level, numStrips == 1);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    for (const Strip &strip : strips)
+    {
+        if (!strip.ok)
+        {
+            fprintf(stderr, "writePNG('%s'): deflate failed\n", fileName);
+            return false;
+        }
+    }
+
+    // Signature and IHDR chunk.
+    unsigned char head[8 + 25] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    unsigned char *ihdr = head + 8;
+    putBigEndian(ihdr, 13);
+    memcpy(ihdr + 4, "IHDR", 4);
+    putBigEndian(ihdr + 8, width);
+    putBigEndian(ihdr + 12, height);
+    ihdr[16] = 8; // bit depth
+    ihdr[17] = 2; // RGB
+    ihdr[18] = 0; // deflate
+    ihdr[19] = 0; // adaptive filtering
+    ihdr[20] = 0; // no interlace
+    putBigEndian(ihdr + 21, crc32(0, ihdr + 4, 17));
+
+    // The IDAT chunk holds the zlib header, every strip and the adler
+    // checksum of the uncompressed data. Checksums of the strips are
+    // combined rather than recomputed over the joined stream.
+    unsigned char zlibHeader[2] = {0x78, 0x01};
+    int levelFlag = level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+    zlibHeader[1] = (unsigned char)(levelFlag << 6);
+    zlibHeader[1] += (31 - (zlibHeader[0] * 256 + zlibHeader[1]) % 31) % 31;
+
+    uLong adler = adler32(0, nullptr, 0);
+    size_t idatBytes = sizeof(zlibHeader) + 4;
+    for (const Strip &strip : strips)
+    {
+        adler = adler32_combine(adler, strip.adler, strip.raw.size());
+        idatBytes += strip.deflated.size();
+    }
+
+    unsigned char adlerBytes[4];
+    putBigEndian(adlerBytes, adler);
+
+    unsigned char idatHead[8];
+    putBigEndian(idatHead, (uint32_t)idatBytes);
+    memcpy(idatHead + 4, "IDAT", 4);
+
+    uLong crc = crc32(0, idatHead + 4, 4);
+    crc = crc32(crc, zlibHeader, sizeof(zlibHeader));
+    for (const Strip &strip : strips)
+        crc = crc32_combine(crc, strip.crc, strip.deflated.size());
+    crc = crc32(crc, adlerBytes, sizeof(adlerBytes));
+
+    unsigned char tail[4 + 12];
+    putBigEndian(tail, crc);
+    unsigned char *iend = tail + 4;
+    putBigEndian(iend, 0);
+    memcpy(iend + 4, "IEND", 4);
+    putBigEndian(iend + 8, crc32(0, iend + 4, 4));
+
+    std::vector<struct iovec> pieces;
+    pieces.push_back({head, sizeof(head)});
+    pieces.push_back({idatHead, sizeof(idatHead)});
+    pieces.push_back({zlibHeader, sizeof(zlibHeader)});
+    for (Strip &strip : strips)
+        pieces.push_back({strip.deflated.data(), strip.deflated.size()});
+    pieces.push_back({adlerBytes, sizeof(adlerBytes)});
+    pieces.push_back({tail, sizeof(tail)});
+
+    Clock::time_point encoded = Clock::now();
+    bool ok = writeFileV(fileName, pieces.data(), (int)pieces.size());
+
+    if (times)
+    {
+        times->convert = std::chrono::duration<double>(encoded - start).count();
+        times->write   = std::chrono::duration<double>(Clock::now() - encoded).count();
+    }
+    return ok;
+}
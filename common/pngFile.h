@@ -0,0 +1,28 @@
+//
+// Writing of rendered frames as PNG files.
+//
+
+#ifndef OSPRAY_DEMOS_PNG_FILE_H
+#define OSPRAY_DEMOS_PNG_FILE_H
+
+#include <stdint.h>
+
+#include "fileUtil.h"
+
+//
+// Write an RGBA8 framebuffer (bottom row first) as an 8 bit RGB PNG.
+// The image is split into horizontal strips that are deflated on up to
+// numThreads threads and joined into a single zlib stream, so the
+// output is an ordinary PNG. level is the zlib compression level, 0-9.
+// When times is given, it receives the time spent packing and
+// deflating, and the time spent writing.
+//
+bool writePNG(const char *fileName,
+              int width,
+              int height,
+              const uint32_t *pixel,
+              int level = 1,
+              int numThreads = 0,
+              FileWriteTimes *times = nullptr);
+
+#endif
@@ -0,0 +1,50 @@
+//
+// Writing of rendered frames as binary (P6) PPM files.
+//
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+
+#include "ppmFile.h"
+#include "fileUtil.h"
+#include "pixelPack.h"
+
+void writePPM(const char *fileName,
+              int width,
+              int height,
+              const uint32_t *pixel,
+              FileWriteTimes *times)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    // Reuse the output buffer between frames so large images don't
+    // fault in fresh pages every time.
+    static thread_local std::vector<unsigned char> buffer;
+
+    char header[64];
+    int headerBytes = snprintf(header, sizeof(header), "P6\n%i %i\n255\n",
+                               width, height);
+    size_t imageBytes = 3 * (size_t)width * height;
+
+    if (buffer.size() < imageBytes)
+        buffer.resize(imageBytes);
+
+    packRGBFlipped(pixel, width, height, buffer.data());
+    Clock::time_point packed = Clock::now();
+
+    char newline = '\n';
+    struct iovec pieces[] = {
+        {header, (size_t)headerBytes},
+        {buffer.data(), imageBytes},
+        {&newline, 1},
+    };
+    writeFileV(fileName, pieces, 3);
+
+    if (times)
+    {
+        times->convert = std::chrono::duration<double>(packed - start).count();
+        times->write   = std::chrono::duration<double>(Clock::now() - packed).count();
+    }
+}
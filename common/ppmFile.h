@@ -0,0 +1,23 @@
+//
+// Writing of rendered frames as binary (P6) PPM files.
+//
+
+#ifndef OSPRAY_DEMOS_PPM_FILE_H
+#define OSPRAY_DEMOS_PPM_FILE_H
+
+#include <stdint.h>
+
+#include "fileUtil.h"
+
+//
+// Helper function to write the rendered image as PPM file. The whole
+// file is packed into one buffer and written with a single writev call.
+// When times is given, it receives the time spent packing and writing.
+//
+void writePPM(const char *fileName,
+              int width,
+              int height,
+              const uint32_t *pixel,
+              FileWriteTimes *times = nullptr);
+
+#endif
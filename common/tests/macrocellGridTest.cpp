@@ -0,0 +1,145 @@
+//
+// Macrocell ranges of a volume with NaN voxels, and a corner of only
+// NaN, against the ranges found by reading every voxel of each brick.
+//
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+#include "macrocellGrid.h"
+#include "testUtil.h"
+
+namespace {
+
+const VolumeDims dims {17, 17, 17};
+
+size_t voxelIndex(size_t x, size_t y, size_t z)
+{
+    return (z * dims.y + y) * dims.x + x;
+}
+
+//
+// x + y + z, with NaN every eleventh voxel and throughout the brick
+// of cells [0, 8) on every axis.
+//
+std::vector<float> volumeWithNaN()
+{
+    std::vector<float> voxels(dims.count());
+    for (size_t z = 0; z < dims.z; ++z)
+        for (size_t y = 0; y < dims.y; ++y)
+            for (size_t x = 0; x < dims.x; ++x)
+            {
+                size_t i = voxelIndex(x, y, z);
+                bool corner = x <= 8 && y <= 8 && z <= 8;
+                voxels[i] = corner || i % 11 == 5 ? NAN : (float)(x + y + z);
+            }
+    return voxels;
+}
+
+//
+// The brick's range from its voxels, leaving out NaN.
+//
+void voxelRange(const std::vector<float> &voxels, const VolumeBrick &brick,
+                float &lo, float &hi)
+{
+    lo = INFINITY;
+    hi = -INFINITY;
+    for (size_t z = 0; z < brick.dims.z; ++z)
+        for (size_t y = 0; y < brick.dims.y; ++y)
+            for (size_t x = 0; x < brick.dims.x; ++x)
+            {
+                float value = voxels[voxelIndex(brick.begin.x + x,
+                                                brick.begin.y + y,
+                                                brick.begin.z + z)];
+                if (!isnan(value))
+                {
+                    lo = std::min(lo, value);
+                    hi = std::max(hi, value);
+                }
+            }
+}
+
+void testRanges()
+{
+    const std::vector<float> voxels = volumeWithNaN();
+    const VoxelArray source {voxels.data(), VOXEL_FLOAT, dims};
+    MacrocellGrid grid(source, 4, 1);
+    MacrocellGrid threaded(source, 4, 4);
+
+    // Bricks on macrocell boundaries get exactly their voxels' range.
+    int emptyBricks = 0;
+    for (const VolumeBrick &brick : brickLayout(dims, 8))
+    {
+        float lo, hi, voxelLo, voxelHi, threadedLo, threadedHi;
+        grid.brickRange(brick, lo, hi);
+        threaded.brickRange(brick, threadedLo, threadedHi);
+        voxelRange(voxels, brick, voxelLo, voxelHi);
+
+        CHECK(lo == voxelLo && hi == voxelHi);
+        CHECK(threadedLo == lo && threadedHi == hi);
+        emptyBricks += !(lo <= hi);
+    }
+    CHECK(emptyBricks == 1);
+
+    // Others get a range that holds their voxels'.
+    for (const VolumeBrick &brick : brickLayout(dims, 6))
+    {
+        float lo, hi, voxelLo, voxelHi;
+        grid.brickRange(brick, lo, hi);
+        voxelRange(voxels, brick, voxelLo, voxelHi);
+        CHECK(!(voxelLo <= voxelHi) || (lo <= voxelLo && hi >= voxelHi));
+    }
+}
+
+void testVisibility()
+{
+    const std::vector<float> voxels = volumeWithNaN();
+    MacrocellGrid grid({voxels.data(), VOXEL_FLOAT, dims}, 4, 1);
+    const std::vector<VolumeBrick> bricks = brickLayout(dims, 8);
+
+    // Fully opaque: only the brick of only NaN shows nothing.
+    OpacityTransfer opaque {{1.0f, 1.0f}, {0.0f, 48.0f}};
+    int hidden = 0;
+    for (const VolumeBrick &brick : bricks)
+        hidden += !grid.brickVisible(brick, opaque);
+    CHECK(hidden == 1);
+    CHECK(!grid.brickVisible(bricks[0], opaque));
+
+    // Transparent up to 40: of the bricks, which reach 24, 32, 40 or
+    // 48, only the far corner one shows.
+    OpacityTransfer high {{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 48.0f}};
+    int visible = 0;
+    for (const VolumeBrick &brick : bricks)
+        visible += grid.brickVisible(brick, high);
+    CHECK(visible == 1);
+    CHECK(grid.brickVisible(bricks.back(), high));
+}
+
+void testMaxOpacity()
+{
+    OpacityTransfer ramp {{0.0f, 1.0f}, {0.0f, 16.0f}};
+    CHECK(ramp.maxOpacity(0.0f, 0.0f) == 0.0f);
+    CHECK(ramp.maxOpacity(0.0f, 8.0f) == 0.5f);
+    CHECK(ramp.maxOpacity(-5.0f, 100.0f) == 1.0f);
+    CHECK(ramp.maxOpacity(-5.0f, -1.0f) == 0.0f);
+    CHECK(ramp.maxOpacity(8.0f, 4.0f) == 0.0f);
+    CHECK(ramp.maxOpacity(NAN, 8.0f) == 0.0f);
+    CHECK(ramp.maxOpacity(0.0f, NAN) == 0.0f);
+    CHECK(ramp.maxOpacity(INFINITY, -INFINITY) == 0.0f);
+
+    OpacityTransfer none {{}, {0.0f, 16.0f}};
+    CHECK(none.maxOpacity(0.0f, 16.0f) == 0.0f);
+}
+
+}
+
+
+int main()
+{
+    testRanges();
+    testVisibility();
+    testMaxOpacity();
+
+    return testResult("macrocellGridTest");
+}
@@ -0,0 +1,290 @@
+//
+// Reads small legacy .vtk and .vtu files written here: a good one of
+// each, then truncated and inconsistent ones, which must fail without
+// reading past the file (build with -fsanitize=address to be sure).
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "meshFile.h"
+#include "testUtil.h"
+
+namespace {
+
+//
+// The cells of the unstructured_volume demo: a voxel, which the reader
+// turns into a hexahedron, a pyramid and a tetrahedron, with a value
+// per point and per cell.
+//
+const float points[13][3] = {
+    {-1.0f, -0.5f,  0.5f}, { 0.0f, -0.5f,  0.5f}, { 0.0f, -0.5f, -0.5f},
+    {-1.0f, -0.5f, -0.5f}, {-1.0f,  0.5f,  0.5f}, { 0.0f,  0.5f,  0.5f},
+    { 0.0f,  0.5f, -0.5f}, {-1.0f,  0.5f, -0.5f}, { 1.0f,  0.0f,  0.0f},
+    {-0.5f, -0.5f, -1.0f}, { 0.5f, -0.5f, -1.0f}, { 0.0f, -0.5f, -2.0f},
+    { 0.0f,  0.5f, -1.5f},
+};
+const int32_t connectivity[17] = {
+    0, 1, 3, 2, 4, 5, 7, 6,
+    1, 2, 6, 5, 8,
+    9, 10, 11, 12,
+};
+const int32_t cellSizes[3] = {8, 5, 4};
+const int32_t cellTypes[3] = {MESH_VOXEL, MESH_PYRAMID, MESH_TETRAHEDRON};
+const float cellValues[3] = {1.5f, 2.5f, 3.5f};
+
+//
+// What can be wrong with a legacy file.
+//
+struct LegacyFlaws
+{
+    int     pointTuples = 13;
+    int     cellTuples  = 3;
+    int32_t firstType   = MESH_VOXEL;
+    int32_t lastIndex   = 12;
+};
+
+void appendBigEndian(std::string &out, const void *value, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)value;
+    for (size_t i = size; i > 0; --i)
+        out += (char)bytes[i - 1];
+}
+
+template <typename T>
+void appendBigEndian(std::string &out, T value)
+{
+    appendBigEndian(out, &value, sizeof(value));
+}
+
+template <typename T>
+void appendLittleEndian(std::string &out, T value)
+{
+    out.append((const char *)&value, sizeof(value));
+}
+
+std::string legacyFile(const LegacyFlaws &flaws = LegacyFlaws())
+{
+    std::string out = "# vtk DataFile Version 3.0\nmeshFileTest\nBINARY\n"
+                      "DATASET UNSTRUCTURED_GRID\nPOINTS 13 float\n";
+    for (const float *point : points)
+        for (int axis = 0; axis < 3; ++axis)
+            appendBigEndian(out, point[axis]);
+
+    out += "\nCELLS 3 20\n";
+    for (int cell = 0, at = 0; cell < 3; ++cell)
+    {
+        appendBigEndian(out, cellSizes[cell]);
+        for (int i = 0; i < cellSizes[cell]; ++i, ++at)
+            appendBigEndian(out, at == 16 ? flaws.lastIndex : connectivity[at]);
+    }
+
+    out += "\nCELL_TYPES 3\n";
+    for (int cell = 0; cell < 3; ++cell)
+        appendBigEndian(out, cell == 0 ? flaws.firstType : cellTypes[cell]);
+
+    out += "\nCELL_DATA " + std::to_string(flaws.cellTuples) +
+           "\nSCALARS pressure float 1\nLOOKUP_TABLE default\n";
+    for (int cell = 0; cell < flaws.cellTuples; ++cell)
+        appendBigEndian(out, cellValues[cell % 3]);
+
+    out += "\nPOINT_DATA " + std::to_string(flaws.pointTuples) +
+           "\nSCALARS temperature float 1\nLOOKUP_TABLE default\n";
+    for (int point = 0; point < flaws.pointTuples; ++point)
+        appendBigEndian(out, (float)point);
+    out += "\n";
+
+    return out;
+}
+
+//
+// The same cells as a .vtu with raw appended arrays, each after a
+// 32 bit byte count.
+//
+std::string vtuFile(int64_t lastIndex = 12)
+{
+    std::vector<std::string> arrays(5);
+    for (const float *point : points)
+        for (int axis = 0; axis < 3; ++axis)
+            appendLittleEndian(arrays[0], point[axis]);
+    for (int i = 0; i < 17; ++i)
+        appendLittleEndian(arrays[1], (int64_t)(i == 16 ? lastIndex : connectivity[i]));
+    for (int64_t cell = 0, end = 0; cell < 3; ++cell)
+        appendLittleEndian(arrays[2], end += cellSizes[cell]);
+    for (int cell = 0; cell < 3; ++cell)
+        appendLittleEndian(arrays[3], (uint8_t)cellTypes[cell]);
+    for (int point = 0; point < 13; ++point)
+        appendLittleEndian(arrays[4], (float)point);
+
+    static const char *const tags[5] = {
+        "type=\"Float32\" Name=\"Points\" NumberOfComponents=\"3\"",
+        "type=\"Int64\" Name=\"connectivity\"",
+        "type=\"Int64\" Name=\"offsets\"",
+        "type=\"UInt8\" Name=\"types\"",
+        "type=\"Float32\" Name=\"temperature\"",
+    };
+    std::string appended;
+    std::string dataArray[5];
+    for (int i = 0; i < 5; ++i)
+    {
+        dataArray[i] = std::string("<DataArray ") + tags[i] +
+                       " format=\"appended\" offset=\"" +
+                       std::to_string(appended.size()) + "\"/>\n";
+        appendLittleEndian(appended, (uint32_t)arrays[i].size());
+        appended += arrays[i];
+    }
+
+    return "<?xml version=\"1.0\"?>\n"
+           "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" "
+           "byte_order=\"LittleEndian\" header_type=\"UInt32\">\n"
+           "<UnstructuredGrid>\n"
+           "<Piece NumberOfPoints=\"13\" NumberOfCells=\"3\">\n"
+           "<PointData>\n" + dataArray[4] + "</PointData>\n"
+           "<Points>\n" + dataArray[0] + "</Points>\n"
+           "<Cells>\n" + dataArray[1] + dataArray[2] + dataArray[3] + "</Cells>\n"
+           "</Piece>\n</UnstructuredGrid>\n"
+           "<AppendedData encoding=\"raw\">\n_" + appended +
+           "\n</AppendedData>\n</VTKFile>\n";
+}
+
+bool readText(const std::string &text,
+              const char *fileName,
+              UnstructuredMesh &mesh,
+              const char *fieldName = "")
+{
+    FILE *file = fopen(fileName, "wb");
+    if (!CHECK(file != nullptr))
+        return false;
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+
+    MeshFileOptions options;
+    options.fileName  = fileName;
+    options.fieldName = fieldName;
+    bool ok = readMeshFile(options, mesh, 2);
+    remove(fileName);
+    return ok;
+}
+
+//
+// The cells as the demo gives them to OSPRay, voxel made hexahedron.
+//
+void checkCells(const UnstructuredMesh &mesh)
+{
+    static const uint32_t indices[17] = {
+        0, 1, 2, 3, 4, 5, 6, 7,
+        1, 2, 6, 5, 8,
+        9, 10, 11, 12,
+    };
+    static const uint32_t starts[3] = {0, 8, 13};
+
+    CHECK(mesh.vertices() == 13);
+    CHECK(mesh.cells() == 3);
+    CHECK(mesh.positions.size() == 39 &&
+          memcmp(mesh.positions.data(), points, sizeof(points)) == 0);
+    CHECK(mesh.indices == std::vector<uint32_t>(indices, indices + 17));
+    CHECK(mesh.cellStarts == std::vector<uint32_t>(starts, starts + 3));
+    CHECK(mesh.cellTypes[0] == MESH_HEXAHEDRON);
+    CHECK(mesh.cellTypes[1] == MESH_PYRAMID);
+    CHECK(mesh.cellTypes[2] == MESH_TETRAHEDRON);
+}
+
+void testLegacy()
+{
+    UnstructuredMesh mesh;
+    CHECK(readText(legacyFile(), "meshFileTest.vtk", mesh));
+    checkCells(mesh);
+    CHECK(!mesh.cellValues && mesh.fieldName == "temperature");
+    CHECK(mesh.values.size() == 13 && mesh.values[12] == 12.0f);
+
+    UnstructuredMesh cellMesh;
+    CHECK(readText(legacyFile(), "meshFileTest.vtk", cellMesh, "pressure"));
+    CHECK(cellMesh.cellValues);
+    CHECK(cellMesh.values == std::vector<float>(cellValues, cellValues + 3));
+
+    UnstructuredMesh missing;
+    CHECK(!readText(legacyFile(), "meshFileTest.vtk", missing, "velocity"));
+}
+
+void testLegacyTruncated()
+{
+    // The point field comes last, so every cut before its final
+    // newline loses some of the data asked for.
+    std::string text = legacyFile();
+    for (size_t length = 0; length + 1 < text.size(); ++length)
+    {
+        UnstructuredMesh mesh;
+        if (!CHECK(!readText(text.substr(0, length), "meshFileTest.vtk", mesh,
+                             "temperature")))
+            fprintf(stderr, "  read a file cut to %zu of %zu bytes\n", length, text.size());
+    }
+}
+
+void testLegacyMismatched()
+{
+    UnstructuredMesh mesh;
+
+    LegacyFlaws shortPointData;
+    shortPointData.pointTuples = 12;
+    CHECK(!readText(legacyFile(shortPointData), "meshFileTest.vtk", mesh));
+
+    LegacyFlaws longPointData;
+    longPointData.pointTuples = 14;
+    CHECK(!readText(legacyFile(longPointData), "meshFileTest.vtk", mesh));
+
+    LegacyFlaws shortCellData;
+    shortCellData.cellTuples = 2;
+    CHECK(!readText(legacyFile(shortCellData), "meshFileTest.vtk", mesh, "pressure"));
+
+    LegacyFlaws triangle;
+    triangle.firstType = 5;
+    CHECK(!readText(legacyFile(triangle), "meshFileTest.vtk", mesh));
+
+    LegacyFlaws missingVertex;
+    missingVertex.lastIndex = 13;
+    CHECK(!readText(legacyFile(missingVertex), "meshFileTest.vtk", mesh));
+
+    LegacyFlaws negativeIndex;
+    negativeIndex.lastIndex = -1;
+    CHECK(!readText(legacyFile(negativeIndex), "meshFileTest.vtk", mesh));
+}
+
+void testVtu()
+{
+    UnstructuredMesh mesh;
+    CHECK(readText(vtuFile(), "meshFileTest.vtu", mesh));
+    checkCells(mesh);
+    CHECK(!mesh.cellValues && mesh.fieldName == "temperature");
+    CHECK(mesh.values.size() == 13 && mesh.values[12] == 12.0f);
+
+    UnstructuredMesh bad;
+    CHECK(!readText(vtuFile(13), "meshFileTest.vtu", bad));
+    CHECK(!readText(vtuFile(-1), "meshFileTest.vtu", bad));
+    CHECK(!readText(vtuFile(INT64_C(1) << 32), "meshFileTest.vtu", bad));
+
+    // Cut anywhere up to the end of the appended arrays. The closing
+    // tags after them aren't needed.
+    std::string text = vtuFile();
+    for (size_t length = 0; length < text.rfind("\n</AppendedData>"); ++length)
+    {
+        UnstructuredMesh cut;
+        if (!CHECK(!readText(text.substr(0, length), "meshFileTest.vtu", cut)))
+            fprintf(stderr, "  read a file cut to %zu of %zu bytes\n", length, text.size());
+    }
+}
+
+}
+
+
+int main()
+{
+    testLegacy();
+    testLegacyTruncated();
+    testLegacyMismatched();
+    testVtu();
+
+    return testResult("meshFileTest");
+}
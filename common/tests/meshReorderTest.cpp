@@ -0,0 +1,177 @@
+//
+// Reorders a shuffled grid of tetrahedra along the Morton and Hilbert
+// curves and checks the result is the same mesh, cell for cell and
+// value for value, with neighbours closer together in memory.
+//
+
+#include <algorithm>
+#include <array>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "meshReorder.h"
+#include "testUtil.h"
+
+namespace {
+
+//
+// An n^3 grid of cubes, five tetrahedra each, with cells and vertices
+// shuffled and a value per vertex that is unique to its position.
+//
+UnstructuredMesh shuffledGrid(int n)
+{
+    const int p = n + 1;
+    const size_t numVertices = (size_t)p * p * p;
+    std::mt19937 random(7);
+
+    std::vector<uint32_t> newVertex(numVertices);
+    for (size_t i = 0; i < numVertices; ++i)
+        newVertex[i] = (uint32_t)i;
+    std::shuffle(newVertex.begin(), newVertex.end(), random);
+
+    UnstructuredMesh mesh;
+    mesh.positions.resize(3 * numVertices);
+    mesh.values.resize(numVertices);
+    for (int z = 0; z < p; ++z)
+        for (int y = 0; y < p; ++y)
+            for (int x = 0; x < p; ++x)
+            {
+                size_t i = newVertex[((size_t)z * p + y) * p + x];
+                mesh.positions[3 * i]     = (float)x;
+                mesh.positions[3 * i + 1] = (float)y;
+                mesh.positions[3 * i + 2] = (float)z;
+                mesh.values[i] = (float)(x + 100 * y + 10000 * z);
+            }
+
+    static const int tets[5][4] = {
+        {0, 1, 2, 4}, {3, 2, 1, 7}, {5, 4, 7, 1}, {6, 7, 4, 2}, {1, 2, 4, 7}
+    };
+    std::vector<std::array<uint32_t, 4>> cells;
+    for (int z = 0; z < n; ++z)
+        for (int y = 0; y < n; ++y)
+            for (int x = 0; x < n; ++x)
+                for (const int *tet : tets)
+                {
+                    std::array<uint32_t, 4> cell;
+                    for (int corner = 0; corner < 4; ++corner)
+                    {
+                        int c = tet[corner];
+                        cell[corner] = newVertex[((size_t)(z + (c >> 2 & 1)) * p +
+                                                  y + (c >> 1 & 1)) * p + x + (c & 1)];
+                    }
+                    cells.push_back(cell);
+                }
+    std::shuffle(cells.begin(), cells.end(), random);
+
+    for (const std::array<uint32_t, 4> &cell : cells)
+    {
+        mesh.cellStarts.push_back((uint32_t)mesh.indices.size());
+        mesh.cellTypes.push_back(MESH_TETRAHEDRON);
+        mesh.indices.insert(mesh.indices.end(), cell.begin(), cell.end());
+    }
+    mesh.description = "shuffled grid";
+    return mesh;
+}
+
+typedef std::array<float, 12> CellCorners;
+
+//
+// Every cell as its corners' positions, in their order, sorted so
+// meshes can be compared whatever order their cells are in.
+//
+std::vector<CellCorners> sortedCells(const UnstructuredMesh &mesh)
+{
+    std::vector<CellCorners> cells(mesh.cells());
+    for (size_t cell = 0; cell < mesh.cells(); ++cell)
+        for (int corner = 0; corner < 4; ++corner)
+            for (int axis = 0; axis < 3; ++axis)
+                cells[cell][3 * corner + axis] =
+                    mesh.positions[3 * mesh.indices[mesh.cellStarts[cell] + corner] + axis];
+    std::sort(cells.begin(), cells.end());
+    return cells;
+}
+
+float distance(const float *a, const float *b)
+{
+    return sqrtf((a[0] - b[0]) * (a[0] - b[0]) +
+                 (a[1] - b[1]) * (a[1] - b[1]) +
+                 (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+//
+// The mean distance between the first corners of consecutive cells
+// and between consecutive vertices.
+//
+void meanSteps(const UnstructuredMesh &mesh, double &cellStep, double &vertexStep)
+{
+    cellStep = 0.0;
+    for (size_t cell = 1; cell < mesh.cells(); ++cell)
+        cellStep += distance(&mesh.positions[3 * mesh.indices[mesh.cellStarts[cell - 1]]],
+                             &mesh.positions[3 * mesh.indices[mesh.cellStarts[cell]]]);
+    cellStep /= mesh.cells() - 1;
+
+    vertexStep = 0.0;
+    for (size_t vertex = 1; vertex < mesh.vertices(); ++vertex)
+        vertexStep += distance(&mesh.positions[3 * (vertex - 1)], &mesh.positions[3 * vertex]);
+    vertexStep /= mesh.vertices() - 1;
+}
+
+void testOrder(const UnstructuredMesh &shuffled, MeshOrder order)
+{
+    UnstructuredMesh mesh = shuffled;
+    reorderMesh(mesh, order, 4);
+
+    CHECK(mesh.vertices() == shuffled.vertices());
+    CHECK(mesh.cells() == shuffled.cells());
+    CHECK(mesh.indices.size() == shuffled.indices.size());
+    CHECK(mesh.cellStarts.size() == shuffled.cellStarts.size());
+    CHECK(std::all_of(mesh.cellTypes.begin(), mesh.cellTypes.end(),
+                      [](uint8_t type) { return type == MESH_TETRAHEDRON; }));
+    CHECK(std::all_of(mesh.indices.begin(), mesh.indices.end(),
+                      [&](uint32_t index) { return index < mesh.vertices(); }));
+    CHECK(mesh.description.find(meshOrderName(order)) != std::string::npos);
+
+    // The same cells, and every value still with its vertex.
+    CHECK(sortedCells(mesh) == sortedCells(shuffled));
+    bool valuesFollow = true;
+    for (size_t i = 0; i < mesh.vertices(); ++i)
+    {
+        const float *position = &mesh.positions[3 * i];
+        valuesFollow &= mesh.values[i] == position[0] + 100 * position[1] + 10000 * position[2];
+    }
+    CHECK(valuesFollow);
+
+    // Neighbours in memory are neighbours in space, far more than
+    // when shuffled.
+    double cellStep, vertexStep, shuffledCellStep, shuffledVertexStep;
+    meanSteps(mesh, cellStep, vertexStep);
+    meanSteps(shuffled, shuffledCellStep, shuffledVertexStep);
+    CHECK(cellStep < 0.25 * shuffledCellStep);
+    CHECK(vertexStep < 0.25 * shuffledVertexStep);
+
+    // The same order on any number of threads.
+    UnstructuredMesh single = shuffled;
+    reorderMesh(single, order, 1);
+    CHECK(single.indices == mesh.indices);
+    CHECK(single.positions == mesh.positions);
+}
+
+}
+
+
+int main()
+{
+    const UnstructuredMesh shuffled = shuffledGrid(12);
+
+    testOrder(shuffled, MESH_ORDER_MORTON);
+    testOrder(shuffled, MESH_ORDER_HILBERT);
+
+    // File order leaves the mesh alone.
+    UnstructuredMesh mesh = shuffled;
+    reorderMesh(mesh, MESH_ORDER_FILE);
+    CHECK(mesh.indices == shuffled.indices);
+    CHECK(mesh.positions == shuffled.positions);
+
+    return testResult("meshReorderTest");
+}
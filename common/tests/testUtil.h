@@ -0,0 +1,39 @@
+//
+// Checks for the unit tests of the shared code. A failed check is
+// printed and the test carries on, so one run shows every failure;
+// main returns testResult(), which is non-zero if any check failed.
+//
+
+#ifndef OSPRAY_DEMOS_TEST_UTIL_H
+#define OSPRAY_DEMOS_TEST_UTIL_H
+
+#include <stdio.h>
+
+#define CHECK(condition) checkResult((condition), #condition, __FILE__, __LINE__)
+
+inline int &testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline bool checkResult(bool ok, const char *condition, const char *file, int line)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        ++testFailures();
+    }
+    return ok;
+}
+
+inline int testResult(const char *name)
+{
+    if (testFailures() == 0)
+        printf("%s: passed\n", name);
+    else
+        printf("%s: %d checks failed\n", name, testFailures());
+    return testFailures() == 0 ? 0 : 1;
+}
+
+#endif
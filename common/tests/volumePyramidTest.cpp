@@ -0,0 +1,130 @@
+//
+// Pyramids of volumes with odd and even axes: every level must span
+// the full resolution extent, keep a constant volume constant and, on
+// odd axes, keep a linear ramp on its grid points.
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "testUtil.h"
+#include "volumePyramid.h"
+
+namespace {
+
+size_t voxelIndex(const VolumeDims &dims, size_t x, size_t y, size_t z)
+{
+    return (z * dims.y + y) * dims.x + x;
+}
+
+//
+// x + 2 y + 4 z in units of level 0's grid spacing.
+//
+std::vector<float> rampVolume(const VolumeDims &dims)
+{
+    std::vector<float> voxels(dims.count());
+    for (size_t z = 0; z < dims.z; ++z)
+        for (size_t y = 0; y < dims.y; ++y)
+            for (size_t x = 0; x < dims.x; ++x)
+                voxels[voxelIndex(dims, x, y, z)] = (float)(x + 2 * y + 4 * z);
+    return voxels;
+}
+
+void testLevels(const VolumeDims &base, const std::vector<VolumeDims> &expected)
+{
+    std::vector<float> voxels = rampVolume(base);
+    VolumePyramid pyramid({voxels.data(), VOXEL_FLOAT, base}, 0, 1);
+
+    if (!CHECK(pyramid.levels() == expected.size()))
+        return;
+
+    for (size_t i = 0; i < pyramid.levels(); ++i)
+    {
+        const VoxelArray &level = pyramid.level(i);
+        CHECK(level.dims.x == expected[i].x);
+        CHECK(level.dims.y == expected[i].y);
+        CHECK(level.dims.z == expected[i].z);
+        CHECK(level.type == VOXEL_FLOAT);
+
+        // The same extent as level 0.
+        float scale[3];
+        pyramid.spacingScale(i, scale);
+        CHECK(fabsf(scale[0] * (level.dims.x - 1) - (base.x - 1)) < 1e-4f);
+        CHECK(fabsf(scale[1] * (level.dims.y - 1) - (base.y - 1)) < 1e-4f);
+        CHECK(fabsf(scale[2] * (level.dims.z - 1) - (base.z - 1)) < 1e-4f);
+
+        // Within a level 0 voxel or so of the ramp where each grid
+        // point lies, away from the clamped edges.
+        const float *values = (const float *)level.voxels;
+        bool nearRamp = true;
+        for (size_t z = 1; z + 1 < level.dims.z; ++z)
+            for (size_t y = 1; y + 1 < level.dims.y; ++y)
+                for (size_t x = 1; x + 1 < level.dims.x; ++x)
+                {
+                    float ramp = x * scale[0] + 2 * y * scale[1] + 4 * z * scale[2];
+                    nearRamp &= fabsf(values[voxelIndex(level.dims, x, y, z)] - ramp) <= 7.0f;
+                }
+        CHECK(nearRamp);
+    }
+
+    VolumePyramid threaded({voxels.data(), VOXEL_FLOAT, base}, 0, 4);
+    const VoxelArray &last = pyramid.level(pyramid.levels() - 1);
+    const VoxelArray &threadedLast = threaded.level(threaded.levels() - 1);
+    CHECK(memcmp(last.voxels, threadedLast.voxels, last.bytes()) == 0);
+}
+
+void testOddRamp()
+{
+    // On odd axes each coarse point is a fine one, and the tent
+    // filter keeps a linear ramp exactly away from the edges.
+    const VolumeDims base {17, 9, 5};
+    std::vector<float> voxels = rampVolume(base);
+    VolumePyramid pyramid({voxels.data(), VOXEL_FLOAT, base}, 2, 1);
+    CHECK(pyramid.levels() == 2);
+
+    const VoxelArray &level = pyramid.level(1);
+    const float *values = (const float *)level.voxels;
+    bool exact = true;
+    for (size_t z = 1; z + 1 < level.dims.z; ++z)
+        for (size_t y = 1; y + 1 < level.dims.y; ++y)
+            for (size_t x = 1; x + 1 < level.dims.x; ++x)
+                exact &= values[voxelIndex(level.dims, x, y, z)] ==
+                         (float)(2 * x + 4 * y + 8 * z);
+    CHECK(exact);
+}
+
+void testConstant()
+{
+    // A constant uint8 volume stays constant, in the same units.
+    const VolumeDims base {12, 7, 6};
+    std::vector<uint8_t> voxels(base.count(), 200);
+    VolumePyramid pyramid({voxels.data(), VOXEL_UINT8, base}, 0, 1);
+    CHECK(pyramid.levels() > 1);
+
+    for (size_t i = 1; i < pyramid.levels(); ++i)
+    {
+        const VoxelArray &level = pyramid.level(i);
+        const float *values = (const float *)level.voxels;
+        bool constant = true;
+        for (size_t v = 0; v < level.dims.count(); ++v)
+            constant &= values[v] == 200.0f;
+        CHECK(constant);
+    }
+}
+
+}
+
+
+int main()
+{
+    // Odd axes halve their cells; even ones stretch the coarse grid.
+    testLevels({9, 9, 9}, {{9, 9, 9}, {5, 5, 5}, {3, 3, 3}, {2, 2, 2}});
+    testLevels({10, 10, 10}, {{10, 10, 10}, {5, 5, 5}, {3, 3, 3}, {2, 2, 2}});
+    testLevels({16, 9, 6}, {{16, 9, 6}, {8, 5, 3}, {4, 3, 2}});
+    testOddRamp();
+    testConstant();
+
+    return testResult("volumePyramidTest");
+}
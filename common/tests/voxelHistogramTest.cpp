@@ -0,0 +1,127 @@
+//
+// Histograms of voxels with NaN among them: NaN must be in no bin and
+// out of the range, the total and the percentiles, and float (SSE),
+// double and integer voxels must bin alike.
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+#include "testUtil.h"
+#include "voxelHistogram.h"
+
+namespace {
+
+VoxelArray flatArray(const void *voxels, VoxelType type, size_t count)
+{
+    return {voxels, type, {count, 1, 1}};
+}
+
+uint64_t binTotal(const VoxelHistogram &histogram)
+{
+    uint64_t total = 0;
+    for (uint64_t count : histogram.bins())
+        total += count;
+    return total;
+}
+
+void testNaN()
+{
+    // 0 to 99 ten times over, every seventh voxel NaN instead.
+    const size_t count = 1000;
+    std::vector<float> voxels(count);
+    size_t numNaN = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        voxels[i] = i % 7 == 3 ? NAN : (float)(i % 100);
+        numNaN += i % 7 == 3;
+    }
+
+    VoxelHistogram histogram(flatArray(voxels.data(), VOXEL_FLOAT, count), 100, 1);
+    CHECK(histogram.minValue() == 0.0f);
+    CHECK(histogram.maxValue() == 99.0f);
+    CHECK(histogram.total() == count - numNaN);
+    CHECK(binTotal(histogram) == histogram.total());
+    CHECK(histogram.count(0.0f, 99.0f) == histogram.total());
+
+    float median = histogram.percentile(50.0f);
+    CHECK(!isnan(median) && median > 45.0f && median < 55.0f);
+    CHECK(histogram.percentile(0.0f) == 0.0f);
+    CHECK(histogram.percentile(100.0f) <= 99.0f);
+
+    VoxelHistogram threaded(flatArray(voxels.data(), VOXEL_FLOAT, count), 100, 4);
+    CHECK(threaded.bins() == histogram.bins());
+
+    std::vector<double> doubles(voxels.begin(), voxels.end());
+    VoxelHistogram fromDouble(flatArray(doubles.data(), VOXEL_DOUBLE, count), 100, 1);
+    CHECK(fromDouble.bins() == histogram.bins());
+    CHECK(fromDouble.minValue() == histogram.minValue());
+    CHECK(fromDouble.maxValue() == histogram.maxValue());
+
+    // NaN first, where a range seeded from the first voxel would go wrong.
+    voxels[0] = NAN;
+    VoxelHistogram nanFirst(flatArray(voxels.data(), VOXEL_FLOAT, count), 100, 1);
+    CHECK(nanFirst.minValue() == 0.0f && nanFirst.maxValue() == 99.0f);
+    CHECK(nanFirst.total() == count - numNaN - 1);
+}
+
+void testAllNaN()
+{
+    std::vector<float> voxels(64, NAN);
+    VoxelHistogram histogram(flatArray(voxels.data(), VOXEL_FLOAT, voxels.size()), 16, 1);
+    CHECK(histogram.total() == 0);
+    CHECK(binTotal(histogram) == 0);
+    CHECK(!isnan(histogram.percentile(50.0f)));
+}
+
+void testIntegers()
+{
+    // The same values as uint8 and float land in the same bins.
+    const size_t count = 777;
+    std::vector<uint8_t> bytes(count);
+    std::vector<float> floats(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        bytes[i] = (uint8_t)(i * 31 % 256);
+        floats[i] = bytes[i];
+    }
+
+    VoxelHistogram fromBytes(flatArray(bytes.data(), VOXEL_UINT8, count), 256, 1);
+    VoxelHistogram fromFloats(flatArray(floats.data(), VOXEL_FLOAT, count), 256, 1);
+    CHECK(fromBytes.total() == count);
+    CHECK(fromBytes.minValue() == fromFloats.minValue());
+    CHECK(fromBytes.maxValue() == fromFloats.maxValue());
+    CHECK(fromBytes.count(10.0f, 20.0f) == fromFloats.count(10.0f, 20.0f));
+}
+
+void testEmptyBins()
+{
+    // Two clusters, at 0 to 1 and 9 to 10, and nothing between.
+    std::vector<float> voxels;
+    for (int i = 0; i <= 100; ++i)
+    {
+        voxels.push_back(i / 100.0f);
+        voxels.push_back(9.0f + i / 100.0f);
+        voxels.push_back(NAN);
+    }
+
+    VoxelHistogram histogram(flatArray(voxels.data(), VOXEL_FLOAT, voxels.size()), 100, 1);
+    std::vector<float> opacities = histogram.emptyBinOpacities({1.0f, 1.0f}, 0.0f, 10.0f, 11);
+    CHECK(opacities.size() == 11);
+    CHECK(opacities.front() > 0.0f && opacities.back() > 0.0f);
+    CHECK(opacities[5] == 0.0f);
+}
+
+}
+
+
+int main()
+{
+    testNaN();
+    testAllNaN();
+    testIntegers();
+    testEmptyBins();
+
+    return testResult("voxelHistogramTest");
+}
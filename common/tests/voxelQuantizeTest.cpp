@@ -0,0 +1,135 @@
+//
+// Quantizes random voxels, some NaN or outside the range, and checks
+// the SSE path matches the scalar one, which quantizes arrays too
+// short for SSE, on any number of threads and for double input.
+//
+
+#include <math.h>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+#include "testUtil.h"
+#include "voxelQuantize.h"
+
+namespace {
+
+const float minValue = -2.0f;
+const float maxValue = 6.0f;
+
+std::vector<float> randomVoxels(size_t count, bool withOutliers)
+{
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> inRange(minValue, maxValue);
+    std::uniform_real_distribution<float> wide(minValue - 4.0f, maxValue + 4.0f);
+
+    std::vector<float> voxels(count);
+    for (size_t i = 0; i < count; ++i)
+        voxels[i] = withOutliers ? wide(random) : inRange(random);
+
+    if (withOutliers)
+    {
+        for (size_t i = 0; i < count; i += 7)
+            voxels[i] = NAN;
+        voxels[1] = minValue;
+        voxels[2] = maxValue;
+        voxels[3] = INFINITY;
+        voxels[4] = -INFINITY;
+    }
+    return voxels;
+}
+
+VoxelArray flatArray(const void *voxels, VoxelType type, size_t count)
+{
+    return {voxels, type, {count, 1, 1}};
+}
+
+template <typename Out>
+void testType(VoxelType type)
+{
+    const Out top = (Out)quantizedMax(type);
+
+    // An odd count leaves a tail after the last SSE block.
+    const size_t count = 1003;
+    std::vector<float> voxels = randomVoxels(count, true);
+
+    std::vector<Out> quantized(count);
+    CHECK(quantizeVoxels(flatArray(voxels.data(), VOXEL_FLOAT, count),
+                         minValue, maxValue, type, quantized.data(), nullptr, 1));
+
+    // One voxel at a time takes the scalar path.
+    bool scalarMatches = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Out one = 0;
+        quantizeVoxels(flatArray(&voxels[i], VOXEL_FLOAT, 1),
+                       minValue, maxValue, type, &one, nullptr, 1);
+        scalarMatches &= one == quantized[i];
+    }
+    CHECK(scalarMatches);
+
+    std::vector<Out> threaded(count);
+    quantizeVoxels(flatArray(voxels.data(), VOXEL_FLOAT, count),
+                   minValue, maxValue, type, threaded.data(), nullptr, 4);
+    CHECK(threaded == quantized);
+
+    std::vector<double> doubles(voxels.begin(), voxels.end());
+    std::vector<Out> fromDouble(count);
+    quantizeVoxels(flatArray(doubles.data(), VOXEL_DOUBLE, count),
+                   minValue, maxValue, type, fromDouble.data(), nullptr, 1);
+    CHECK(fromDouble == quantized);
+
+    // NaN is 0 and outliers clamp to the ends.
+    bool nanIsZero = true;
+    for (size_t i = 0; i < count; i += 7)
+        nanIsZero &= quantized[i] == 0;
+    CHECK(nanIsZero);
+    CHECK(quantized[1] == 0);
+    CHECK(quantized[2] == top);
+    CHECK(quantized[3] == top);
+    CHECK(quantized[4] == 0);
+}
+
+template <typename Out>
+void testError(VoxelType type)
+{
+    // Within the range every voxel is within half a step, NaN or not.
+    const size_t count = 4099;
+    std::vector<float> voxels = randomVoxels(count, false);
+    const double halfStep = 0.5 * (maxValue - minValue) / quantizedMax(type);
+
+    std::vector<Out> quantized(count);
+    QuantizeStats stats;
+    quantizeVoxels(flatArray(voxels.data(), VOXEL_FLOAT, count),
+                   minValue, maxValue, type, quantized.data(), &stats, 1);
+    CHECK(stats.maxError > 0.0 && stats.maxError <= halfStep * 1.001);
+
+    for (size_t i = 0; i < count; i += 5)
+        voxels[i] = NAN;
+    QuantizeStats nanStats;
+    quantizeVoxels(flatArray(voxels.data(), VOXEL_FLOAT, count),
+                   minValue, maxValue, type, quantized.data(), &nanStats, 1);
+    CHECK(!isnan(nanStats.maxError) && nanStats.maxError <= halfStep * 1.001);
+
+    std::vector<double> doubles(voxels.begin(), voxels.end());
+    QuantizeStats doubleStats;
+    quantizeVoxels(flatArray(doubles.data(), VOXEL_DOUBLE, count),
+                   minValue, maxValue, type, quantized.data(), &doubleStats, 1);
+    CHECK(!isnan(doubleStats.maxError) && doubleStats.maxError <= halfStep * 1.001);
+}
+
+}
+
+
+int main()
+{
+    testType<uint8_t>(VOXEL_UINT8);
+    testType<uint16_t>(VOXEL_UINT16);
+    testError<uint8_t>(VOXEL_UINT8);
+    testError<uint16_t>(VOXEL_UINT16);
+
+    float voxel = 1.0f, out;
+    CHECK(!quantizeVoxels(flatArray(&voxel, VOXEL_FLOAT, 1), 0.0f, 2.0f, VOXEL_FLOAT, &out));
+
+    return testResult("voxelQuantizeTest");
+}
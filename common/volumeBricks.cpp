@@ -0,0 +1,72 @@
+//
+// Splitting a structured volume into bricks.
+//
+
+#include <algorithm>
+#include <string.h>
+
+#include "volumeBricks.h"
+
+namespace {
+
+//
+// Start voxels of the bricks along one axis of n voxels: n - 1 cells
+// in runs of brickSize.
+//
+std::vector<size_t> brickStarts(size_t n, size_t brickSize)
+{
+    std::vector<size_t> starts;
+    size_t cells = n > 1 ? n - 1 : 1;
+    for (size_t b = 0; b < cells; b += brickSize)
+        starts.push_back(b);
+    return starts;
+}
+
+}
+
+
+std::vector<VolumeBrick> brickLayout(const VolumeDims &dims, size_t brickSize)
+{
+    brickSize = std::max<size_t>(1, brickSize);
+
+    std::vector<size_t> xs = brickStarts(dims.x, brickSize);
+    std::vector<size_t> ys = brickStarts(dims.y, brickSize);
+    std::vector<size_t> zs = brickStarts(dims.z, brickSize);
+
+    // Cells [b, b + brickSize), and the ghost voxel after them.
+    auto extent = [brickSize](size_t b, size_t n)
+    {
+        return std::min(b + brickSize + 1, n) - b;
+    };
+
+    std::vector<VolumeBrick> bricks;
+    bricks.reserve(xs.size() * ys.size() * zs.size());
+    for (size_t z : zs)
+        for (size_t y : ys)
+            for (size_t x : xs)
+            {
+                VolumeBrick brick;
+                brick.begin = {x, y, z};
+                brick.dims  = {extent(x, dims.x), extent(y, dims.y), extent(z, dims.z)};
+                bricks.push_back(brick);
+            }
+    return bricks;
+}
+
+
+void copyBrick(const VoxelArray &source, const VolumeBrick &brick, void *out)
+{
+    const size_t voxelBytes = voxelTypeSize(source.type);
+    const size_t rowBytes   = brick.dims.x * voxelBytes;
+    const unsigned char *in = (const unsigned char *)source.voxels;
+    unsigned char *dst      = (unsigned char *)out;
+
+    for (size_t z = 0; z < brick.dims.z; ++z)
+        for (size_t y = 0; y < brick.dims.y; ++y)
+        {
+            size_t first = ((brick.begin.z + z) * source.dims.y + brick.begin.y + y) *
+                           source.dims.x + brick.begin.x;
+            memcpy(dst, in + first * voxelBytes, rowBytes);
+            dst += rowBytes;
+        }
+}
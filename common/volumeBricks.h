@@ -0,0 +1,43 @@
+//
+// Splitting a structured volume into bricks that can be loaded and
+// rendered on their own.
+//
+// Voxels sit on the grid points and the renderer interpolates between
+// them, so a brick covering cells [b, e) along an axis needs voxels
+// b through e. The extra voxel at the high end is a ghost layer shared
+// with the next brick; with it the bricks meet without seams, and
+// without overlapping, so no part of the volume is integrated twice.
+//
+
+#ifndef OSPRAY_DEMOS_VOLUME_BRICKS_H
+#define OSPRAY_DEMOS_VOLUME_BRICKS_H
+
+#include <vector>
+#include <stddef.h>
+
+#include "voxelArray.h"
+
+struct VolumeBrick
+{
+    // The first voxel of the brick, and how many it holds along each
+    // axis including the ghost layer.
+    VolumeDims begin;
+    VolumeDims dims;
+
+    size_t bytes(VoxelType type) const { return dims.count() * voxelTypeSize(type); }
+};
+
+//
+// Bricks of up to brickSize cells along each axis covering a volume of
+// dims voxels, x fastest. Bricks at the high edges may be smaller.
+//
+std::vector<VolumeBrick> brickLayout(const VolumeDims &dims, size_t brickSize);
+
+//
+// Copy a brick's voxels out of source into out, which must hold
+// brick.bytes(source.type). Rows are copied whole, so from a mapped
+// file only the pages under the brick are read.
+//
+void copyBrick(const VoxelArray &source, const VolumeBrick &brick, void *out);
+
+#endif
@@ -0,0 +1,284 @@
+//
+// Memory-mapped raw and BOV volume files.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "volumeFile.h"
+
+namespace {
+
+const char *adviceNames[] = {
+    "none",
+    "sequential",
+    "random",
+    "willneed",
+    "hugepage",
+};
+
+const int numAdvice = sizeof(adviceNames) / sizeof(adviceNames[0]);
+
+bool endsWith(const std::string &str, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+bool parseDims(const char *text, VolumeDims &dims)
+{
+    unsigned long long x = 0, y = 0, z = 0;
+    if (sscanf(text, "%llux%llux%llu", &x, &y, &z) != 3 || !x || !y || !z)
+        return false;
+    dims = {(size_t)x, (size_t)y, (size_t)z};
+    return true;
+}
+
+bool hostIsLittleEndian()
+{
+    const uint16_t one = 1;
+    return *(const unsigned char *)&one == 1;
+}
+
+int madviseFlag(MapAdvice advice)
+{
+    switch (advice)
+    {
+    case MAP_ADVICE_SEQUENTIAL: return MADV_SEQUENTIAL;
+    case MAP_ADVICE_RANDOM:     return MADV_RANDOM;
+    case MAP_ADVICE_WILLNEED:   return MADV_WILLNEED;
+#ifdef MADV_HUGEPAGE
+    case MAP_ADVICE_HUGEPAGE:   return MADV_HUGEPAGE;
+#endif
+    default:                    return -1;
+    }
+}
+
+}
+
+
+VolumeFileOptions parseVolumeFileOptions(int argc, const char **argv)
+{
+    VolumeFileOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--volume") == 0 && i + 1 < argc)
+            options.fileName = argv[++i];
+        else if (strcmp(argv[i], "--raw-dims") == 0 && i + 1 < argc)
+        {
+            if (!parseDims(argv[++i], options.rawDims))
+                fprintf(stderr, "Bad --raw-dims '%s', expected XxYxZ\n", argv[i]);
+        }
+        else if (strcmp(argv[i], "--raw-type") == 0 && i + 1 < argc)
+        {
+            if (!parseVoxelType(argv[++i], options.rawType))
+                fprintf(stderr, "Unknown --raw-type '%s' (expected uint8, uint16, "
+                        "float or double)\n", argv[i]);
+        }
+        else if (strcmp(argv[i], "--raw-offset") == 0 && i + 1 < argc)
+            options.rawOffset = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--madvise") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int a = 0;
+            while (a < numAdvice && strcmp(name, adviceNames[a]) != 0)
+                ++a;
+            if (a < numAdvice)
+                options.advice = (MapAdvice)a;
+            else
+                fprintf(stderr, "Unknown --madvise '%s' (expected none, sequential, "
+                        "random, willneed or hugepage)\n", name);
+        }
+        else if (strcmp(argv[i], "--value-range") == 0 && i + 1 < argc)
+        {
+            const char *range = argv[++i];
+            options.haveValueRange = sscanf(range, "%f:%f", &options.valueRange[0],
+                                            &options.valueRange[1]) == 2;
+            if (!options.haveValueRange)
+                fprintf(stderr, "Bad --value-range '%s', expected LO:HI\n", range);
+        }
+    }
+
+    return options;
+}
+
+
+MappedVolume::MappedVolume(const VolumeFileOptions &options)
+    : mapping(nullptr),
+      mappingBytes(0),
+      array{nullptr, options.rawType, options.rawDims},
+      modified(0)
+{
+    std::string dataName = options.fileName;
+    size_t offset = options.rawOffset;
+
+    if (endsWith(options.fileName, ".bov"))
+    {
+        if (!readHeader(options.fileName, dataName, offset))
+            return;
+    }
+    else if (array.dims.count() == 0)
+    {
+        fprintf(stderr, "Raw volume '%s' needs --raw-dims\n", options.fileName.c_str());
+        return;
+    }
+
+    map(dataName, offset, options.advice);
+}
+
+
+MappedVolume::~MappedVolume()
+{
+    if (mapping)
+        munmap(mapping, mappingBytes);
+}
+
+
+bool MappedVolume::readHeader(const std::string &headerName,
+                              std::string &dataName,
+                              size_t &offset)
+{
+    FILE *file = fopen(headerName.c_str(), "r");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "fopen('%s', 'r') failed: %d\n", headerName.c_str(), errno);
+        return false;
+    }
+
+    dataName.clear();
+    offset = 0;
+    bool haveSize = false;
+    bool haveFormat = false;
+    bool bigEndian = false;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file))
+    {
+        char value[1024];
+        unsigned long long x, y, z;
+
+        if (sscanf(line, " DATA_FILE: %1023s", value) == 1)
+            dataName = value;
+        else if (sscanf(line, " DATA_SIZE: %llu %llu %llu", &x, &y, &z) == 3)
+        {
+            array.dims = {(size_t)x, (size_t)y, (size_t)z};
+            haveSize = true;
+        }
+        else if (sscanf(line, " DATA_FORMAT: %1023s", value) == 1)
+        {
+            haveFormat = true;
+            if (strcmp(value, "BYTE") == 0 || strcmp(value, "UCHAR") == 0)
+                array.type = VOXEL_UINT8;
+            else if (strcmp(value, "SHORT") == 0 || strcmp(value, "USHORT") == 0)
+                array.type = VOXEL_UINT16;
+            else if (strcmp(value, "FLOAT") == 0)
+                array.type = VOXEL_FLOAT;
+            else if (strcmp(value, "DOUBLE") == 0)
+                array.type = VOXEL_DOUBLE;
+            else
+            {
+                fprintf(stderr, "'%s': unsupported DATA_FORMAT %s\n",
+                        headerName.c_str(), value);
+                haveFormat = false;
+                break;
+            }
+        }
+        else if (sscanf(line, " DATA_ENDIAN: %1023s", value) == 1)
+            bigEndian = strcmp(value, "BIG") == 0;
+        else if (sscanf(line, " BYTE_OFFSET: %llu", &x) == 1)
+            offset = x;
+    }
+    fclose(file);
+
+    if (dataName.empty() || !haveSize || !haveFormat)
+    {
+        fprintf(stderr, "'%s' needs DATA_FILE, DATA_SIZE and a supported DATA_FORMAT\n",
+                headerName.c_str());
+        return false;
+    }
+
+    // The voxels go to OSPRay as they are in the file.
+    if (bigEndian == hostIsLittleEndian() && voxelTypeSize(array.type) > 1)
+    {
+        fprintf(stderr, "'%s': %s endian data can't be mapped on this machine\n",
+                headerName.c_str(), bigEndian ? "big" : "little");
+        return false;
+    }
+
+    size_t slash = headerName.rfind('/');
+    if (dataName[0] != '/' && slash != std::string::npos)
+        dataName = headerName.substr(0, slash + 1) + dataName;
+
+    return true;
+}
+
+
+bool MappedVolume::map(const std::string &dataName, size_t offset, MapAdvice advice)
+{
+    dataFile = dataName;
+
+    int fd = open(dataName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "open('%s') failed: %d\n", dataName.c_str(), errno);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        fprintf(stderr, "fstat('%s') failed: %d\n", dataName.c_str(), errno);
+        close(fd);
+        return false;
+    }
+    modified = (long long)info.st_mtime;
+
+    size_t needed = offset + array.bytes();
+    if ((size_t)info.st_size < needed)
+    {
+        fprintf(stderr, "'%s' holds %lld bytes, a %zux%zux%zu %s volume at offset "
+                "%zu needs %zu\n", dataName.c_str(), (long long)info.st_size,
+                array.dims.x, array.dims.y, array.dims.z, voxelTypeName(array.type),
+                offset, needed);
+        close(fd);
+        return false;
+    }
+
+    // Map from the start of the file, as mmap offsets must be page
+    // aligned and BOV offsets needn't be.
+    void *mapped = mmap(nullptr, needed, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        fprintf(stderr, "mmap('%s') failed: %d\n", dataName.c_str(), errno);
+        return false;
+    }
+
+    int flag = madviseFlag(advice);
+    if (flag >= 0 && madvise(mapped, needed, flag) != 0)
+        fprintf(stderr, "madvise('%s', %s) failed: %d\n", dataName.c_str(),
+                adviceNames[advice], errno);
+
+    mapping      = mapped;
+    mappingBytes = needed;
+    array.voxels = (const char *)mapped + offset;
+    return true;
+}
+
+
+std::string MappedVolume::description() const
+{
+    char description[64];
+    snprintf(description, sizeof(description), " (%zux%zux%zu %s, mtime %lld)",
+             array.dims.x, array.dims.y, array.dims.z, voxelTypeName(array.type),
+             modified);
+    return dataFile + description;
+}
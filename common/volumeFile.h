@@ -0,0 +1,113 @@
+//
+// Memory-mapped raw and BOV volume files.
+//
+// The file is mapped read only and its voxels handed to OSPRay as
+// shared data, so nothing is copied or parsed at load time and pages
+// are only read from disk as the renderer touches them.
+//
+// A BOV (brick of values) file is a small text header naming the raw
+// data file and describing it, as written by VisIt and many
+// simulation codes:
+//
+//   DATA_FILE: density.raw
+//   DATA_SIZE: 512 512 256
+//   DATA_FORMAT: SHORT          BYTE, SHORT, FLOAT or DOUBLE
+//   DATA_ENDIAN: LITTLE
+//   BYTE_OFFSET: 0              optional, skips a header in DATA_FILE
+//
+// Other keys are ignored. SHORT and BYTE are taken as unsigned, and a
+// relative DATA_FILE is relative to the header's directory. A raw file
+// has no header; its size and type come from the command line.
+//
+
+#ifndef OSPRAY_DEMOS_VOLUME_FILE_H
+#define OSPRAY_DEMOS_VOLUME_FILE_H
+
+#include <string>
+#include <stddef.h>
+
+#include "voxelArray.h"
+
+//
+// How the mapping will be read, passed on to madvise.
+//
+enum MapAdvice
+{
+    MAP_ADVICE_NONE,        // leave it to the kernel
+    MAP_ADVICE_SEQUENTIAL,  // aggressive read-ahead
+    MAP_ADVICE_RANDOM,      // no read-ahead, for sparse access
+    MAP_ADVICE_WILLNEED,    // start reading the whole file now
+    MAP_ADVICE_HUGEPAGE     // back the mapping with huge pages if possible
+};
+
+//
+// Volume file options as given on the command line.
+//
+//   --volume FILE           a .bov header, or raw voxels
+//   --raw-dims XxYxZ        voxel counts of a raw file
+//   --raw-type TYPE         uint8, uint16, float (default) or double
+//   --raw-offset BYTES      bytes to skip at the start of a raw file
+//   --madvise ADVICE        none (default), sequential, random,
+//                           willneed or hugepage
+//   --value-range LO:HI     transfer function range, which otherwise
+//                           takes a pass over every voxel
+//
+struct VolumeFileOptions
+{
+    std::string fileName;
+    VolumeDims  rawDims;
+    VoxelType   rawType;
+    size_t      rawOffset;
+    MapAdvice   advice;
+
+    bool  haveValueRange;
+    float valueRange[2];
+
+    VolumeFileOptions()
+        : rawDims{0, 0, 0},
+          rawType(VOXEL_FLOAT),
+          rawOffset(0),
+          advice(MAP_ADVICE_NONE),
+          haveValueRange(false),
+          valueRange{0.0f, 0.0f}
+    {}
+};
+
+VolumeFileOptions parseVolumeFileOptions(int argc, const char **argv);
+
+//
+// A volume file mapped into memory for as long as this object lives.
+// Check ok() after constructing; failures are printed.
+//
+class MappedVolume
+{
+  public:
+    explicit MappedVolume(const VolumeFileOptions &options);
+    ~MappedVolume();
+
+    MappedVolume(const MappedVolume &) = delete;
+    MappedVolume &operator=(const MappedVolume &) = delete;
+
+    bool ok() const { return array.voxels != nullptr; }
+
+    const VoxelArray &voxels() const { return array; }
+
+    //
+    // The data file, its size and type, and its modification time, for
+    // scene keys and log lines.
+    //
+    std::string description() const;
+
+  private:
+    bool readHeader(const std::string &headerName, std::string &dataName,
+                    size_t &offset);
+    bool map(const std::string &dataName, size_t offset, MapAdvice advice);
+
+    void       *mapping;
+    size_t      mappingBytes;
+    VoxelArray  array;
+    std::string dataFile;
+    long long   modified;
+};
+
+#endif
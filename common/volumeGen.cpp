@@ -0,0 +1,231 @@
+//
+// Procedural scalar fields for the structured volume demos.
+//
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "volumeGen.h"
+#include "parallelFor.h"
+
+namespace {
+
+const char *fieldNames[] = {
+    "ramp",
+    "noise",
+    "sphere",
+    "marschner-lobb",
+};
+
+const int numFields = sizeof(fieldNames) / sizeof(fieldNames[0]);
+
+// Rows per thread below which splitting the fill isn't worth it.
+const size_t minRowsPerThread = 16;
+
+//
+// Maps voxel index i of n onto [-1, 1], at the voxel's centre.
+//
+inline float centered(size_t i, size_t n)
+{
+    return (2.0f * i + 1.0f) / n - 1.0f;
+}
+
+uint32_t hash3(int32_t x, int32_t y, int32_t z)
+{
+    uint32_t h = (uint32_t)x * 0x8da6b343u ^ (uint32_t)y * 0xd8163841u ^
+                 (uint32_t)z * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+inline float lattice(int32_t x, int32_t y, int32_t z)
+{
+    return hash3(x, y, z) * (1.0f / 4294967296.0f);
+}
+
+inline float smooth(float t)
+{
+    return t * t * (3.0f - 2.0f * t);
+}
+
+inline float lerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+//
+// Trilinearly interpolated value noise on the integer lattice, with
+// smoothstep weights so the field has no creases at cell faces.
+//
+float valueNoise(float x, float y, float z)
+{
+    float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+    int32_t ix = (int32_t)fx, iy = (int32_t)fy, iz = (int32_t)fz;
+    float tx = smooth(x - fx), ty = smooth(y - fy), tz = smooth(z - fz);
+
+    float c00 = lerp(lattice(ix, iy,     iz),     lattice(ix + 1, iy,     iz),     tx);
+    float c10 = lerp(lattice(ix, iy + 1, iz),     lattice(ix + 1, iy + 1, iz),     tx);
+    float c01 = lerp(lattice(ix, iy,     iz + 1), lattice(ix + 1, iy,     iz + 1), tx);
+    float c11 = lerp(lattice(ix, iy + 1, iz + 1), lattice(ix + 1, iy + 1, iz + 1), tx);
+
+    return lerp(lerp(c00, c10, ty), lerp(c01, c11, ty), tz);
+}
+
+//
+// Four octaves, the coarsest with four cells across the volume.
+//
+float fractalNoise(float u, float v, float w)
+{
+    float sum = 0.0f;
+    float amplitude = 0.5f;
+    float frequency = 2.0f;
+    for (int octave = 0; octave < 4; ++octave)
+    {
+        sum += amplitude * valueNoise(u * frequency, v * frequency, w * frequency);
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    return sum / (1.0f - 0.0625f);
+}
+
+//
+// Marschner and Lobb, "An Evaluation of Reconstruction Filters for
+// Volume Rendering", with their alpha = 0.25 and fM = 6.
+//
+float marschnerLobb(float x, float y, float z)
+{
+    const float alpha = 0.25f;
+    const float fM    = 6.0f;
+    const float pi    = 3.14159265358979f;
+
+    float r  = sqrtf(x * x + y * y);
+    float pr = cosf(2.0f * pi * fM * cosf(pi * r / 2.0f));
+    return (1.0f - sinf(pi * z / 2.0f) + alpha * (1.0f + pr)) / (2.0f * (1.0f + alpha));
+}
+
+void fillRow(VolumeField field,
+             const VolumeDims &dims,
+             size_t y,
+             size_t z,
+             float *out)
+{
+    const size_t rowStart = (z * dims.y + y) * dims.x;
+    const float v = centered(y, dims.y);
+    const float w = centered(z, dims.z);
+
+    switch (field)
+    {
+    case FIELD_RAMP:
+        for (size_t x = 0; x < dims.x; ++x)
+            out[x] = (float)((rowStart + x) * 0.987);
+        break;
+
+    case FIELD_NOISE:
+        for (size_t x = 0; x < dims.x; ++x)
+            out[x] = fractalNoise(centered(x, dims.x) + 1.0f, v + 1.0f, w + 1.0f);
+        break;
+
+    case FIELD_SPHERE:
+        for (size_t x = 0; x < dims.x; ++x)
+        {
+            float u = centered(x, dims.x);
+            out[x] = std::max(0.0f, 1.0f - sqrtf(u * u + v * v + w * w));
+        }
+        break;
+
+    case FIELD_MARSCHNER_LOBB:
+        for (size_t x = 0; x < dims.x; ++x)
+            out[x] = marschnerLobb(centered(x, dims.x), v, w);
+        break;
+    }
+}
+
+}
+
+
+const char *volumeFieldName(VolumeField field)
+{
+    return field < numFields ? fieldNames[field] : "unknown";
+}
+
+
+VolumeGenOptions parseVolumeGenOptions(int argc, const char **argv)
+{
+    VolumeGenOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--field") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int f = 0;
+            while (f < numFields && strcmp(name, fieldNames[f]) != 0)
+                ++f;
+            if (f < numFields)
+                options.field = (VolumeField)f;
+            else
+                fprintf(stderr, "Unknown --field '%s' (expected ramp, noise, sphere "
+                        "or marschner-lobb)\n", name);
+        }
+        else if (strcmp(argv[i], "--dims") == 0 && i + 1 < argc)
+        {
+            const char *dims = argv[++i];
+            unsigned long long x = 0, y = 0, z = 0;
+            int n = sscanf(dims, "%llux%llux%llu", &x, &y, &z);
+            if (n == 1)
+                y = z = x;
+            if ((n != 1 && n != 3) || x == 0 || y == 0 || z == 0)
+            {
+                fprintf(stderr, "Bad --dims '%s', expected N or XxYxZ\n", dims);
+                continue;
+            }
+            options.dims = {(size_t)x, (size_t)y, (size_t)z};
+        }
+    }
+
+    return options;
+}
+
+
+std::string volumeGenDescription(const VolumeGenOptions &options)
+{
+    char description[96];
+    snprintf(description, sizeof(description), "%zux%zux%zu %s",
+             options.dims.x, options.dims.y, options.dims.z,
+             volumeFieldName(options.field));
+    return description;
+}
+
+
+std::unique_ptr<float[]> allocateVoxels(size_t count)
+{
+    // new float[] leaves the memory untouched, unlike std::vector.
+    return std::unique_ptr<float[]>(new float[count]);
+}
+
+
+void generateVolume(VolumeField field,
+                    const VolumeDims &dims,
+                    float *voxels,
+                    int numThreads)
+{
+    // Split by rows of x, which keeps the per-voxel work free of
+    // divisions and hands every thread a contiguous slab of memory.
+    parallelChunks(dims.y * dims.z,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; ++row)
+                fillRow(field, dims, row % dims.y, row / dims.y,
+                        voxels + row * dims.x);
+        },
+        numThreads, minRowsPerThread);
+}
+
@@ -0,0 +1,68 @@
+//
+// Procedural scalar fields for the structured volume demos.
+//
+// Fields are generated on every core, each thread filling the slices
+// it will later be the first to read, and all sizes and indices are
+// 64 bit so volumes past 2^31 voxels (1291^3 and up) work.
+//
+
+#ifndef OSPRAY_DEMOS_VOLUME_GEN_H
+#define OSPRAY_DEMOS_VOLUME_GEN_H
+
+#include <memory>
+#include <string>
+#include <stddef.h>
+
+#include "voxelArray.h"
+
+enum VolumeField
+{
+    FIELD_RAMP,            // voxel index times 0.987, the demos' original field
+    FIELD_NOISE,           // a few octaves of smooth value noise in [0, 1]
+    FIELD_SPHERE,          // 1 at the centre falling to 0 at the inscribed sphere
+    FIELD_MARSCHNER_LOBB   // the Marschner-Lobb test signal in [0, 1]
+};
+
+const char *volumeFieldName(VolumeField field);
+
+//
+// Which field to generate, as given on the command line.
+//
+//   --field NAME    ramp (default), noise, sphere or marschner-lobb
+//   --dims N|XxYxZ  voxel counts (default 10x10x10)
+//
+struct VolumeGenOptions
+{
+    VolumeField field;
+    VolumeDims  dims;
+
+    VolumeGenOptions()
+        : field(FIELD_RAMP),
+          dims{10, 10, 10}
+    {}
+};
+
+VolumeGenOptions parseVolumeGenOptions(int argc, const char **argv);
+
+//
+// A short description of the generated volume, e.g. "256x256x256
+// noise", for scene keys and log lines.
+//
+std::string volumeGenDescription(const VolumeGenOptions &options);
+
+//
+// Allocate room for count voxels without touching it, so the pages are
+// placed by whichever thread first writes them.
+//
+std::unique_ptr<float[]> allocateVoxels(size_t count);
+
+//
+// Fill voxels, dims.count() of them, with field. Runs on numThreads
+// threads, or one per core when numThreads is 0.
+//
+void generateVolume(VolumeField field,
+                    const VolumeDims &dims,
+                    float *voxels,
+                    int numThreads = 0);
+
+#endif
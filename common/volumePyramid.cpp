@@ -0,0 +1,212 @@
+//
+// A mip pyramid of a structured volume.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+
+#include "volumePyramid.h"
+#include "parallelFor.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// Output rows per thread below which a pass runs on fewer threads.
+const size_t minRowsPerThread = 64;
+
+//
+// Grid points along an axis of n after keeping every other one.
+//
+size_t halved(size_t n)
+{
+    return (n - 1) / 2 + 1;
+}
+
+//
+// The fine grid point nearest coarse point i of halved(n), with both
+// axes spanning the same extent, and its neighbours clamped to the
+// axis. That is 2 * i on odd axes.
+//
+void tentTaps(size_t i, size_t n, size_t &prev, size_t &center, size_t &next)
+{
+    const size_t last = halved(n) - 1;
+    center = (2 * i * (n - 1) + last) / (2 * last);
+    prev   = center > 0 ? center - 1 : 0;
+    next   = std::min(center + 1, n - 1);
+}
+
+//
+// out[x] = (a[x] + 2 b[x] + c[x]) / 4 for n floats.
+//
+void tentRows(const float *a, const float *b, const float *c, float *out, size_t n)
+{
+    size_t x = 0;
+
+#if defined(__SSE__)
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 half    = _mm_set1_ps(0.5f);
+    for (; x + 4 <= n; x += 4)
+    {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(a + x), _mm_loadu_ps(c + x));
+        __m128 v   = _mm_add_ps(_mm_mul_ps(sum, quarter),
+                                _mm_mul_ps(_mm_loadu_ps(b + x), half));
+        _mm_storeu_ps(out + x, v);
+    }
+#endif
+
+    for (; x < n; ++x)
+        out[x] = 0.25f * (a[x] + c[x]) + 0.5f * b[x];
+}
+
+//
+// Halve along x, converting to float. Each row is independent.
+//
+template <typename T>
+void halveX(const T *in, const VolumeDims &dims, float *out, int numThreads)
+{
+    const size_t outX = halved(dims.x);
+    parallelChunks(dims.y * dims.z,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; ++row)
+            {
+                const T *src = in + row * dims.x;
+                float *dst = out + row * outX;
+                for (size_t i = 0; i < outX; ++i)
+                {
+                    size_t prev, center, next;
+                    tentTaps(i, dims.x, prev, center, next);
+                    dst[i] = 0.25f * ((float)src[prev] + (float)src[next]) +
+                             0.5f * (float)src[center];
+                }
+            }
+        },
+        numThreads, minRowsPerThread);
+}
+
+//
+// Halve along y: whole rows are combined, which vectorizes.
+//
+void halveY(const float *in, const VolumeDims &dims, float *out, int numThreads)
+{
+    const size_t outY = halved(dims.y);
+    parallelChunks(outY * dims.z,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; ++row)
+            {
+                size_t y = row % outY;
+                size_t z = row / outY;
+                size_t prev, center, next;
+                tentTaps(y, dims.y, prev, center, next);
+
+                const float *slice = in + z * dims.y * dims.x;
+                tentRows(slice + prev * dims.x, slice + center * dims.x,
+                         slice + next * dims.x, out + row * dims.x, dims.x);
+            }
+        },
+        numThreads, minRowsPerThread);
+}
+
+//
+// Halve along z, also a row at a time.
+//
+void halveZ(const float *in, const VolumeDims &dims, float *out, int numThreads)
+{
+    const size_t outZ = halved(dims.z);
+    const size_t sliceSize = dims.y * dims.x;
+    parallelChunks(dims.y * outZ,
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; ++row)
+            {
+                size_t y = row % dims.y;
+                size_t z = row / dims.y;
+                size_t prev, center, next;
+                tentTaps(z, dims.z, prev, center, next);
+
+                const float *rowStart = in + y * dims.x;
+                tentRows(rowStart + prev * sliceSize, rowStart + center * sliceSize,
+                         rowStart + next * sliceSize, out + row * dims.x, dims.x);
+            }
+        },
+        numThreads, minRowsPerThread);
+}
+
+template <typename T>
+std::unique_ptr<float[]> halve(const T *in, const VolumeDims &dims,
+                               VolumeDims &outDims, int numThreads)
+{
+    outDims = {halved(dims.x), halved(dims.y), halved(dims.z)};
+
+    // new float[] leaves the pages to be first touched by the threads
+    // that fill them.
+    VolumeDims xDims = {outDims.x, dims.y, dims.z};
+    std::unique_ptr<float[]> alongX(new float[xDims.count()]);
+    halveX(in, dims, alongX.get(), numThreads);
+
+    VolumeDims yDims = {outDims.x, outDims.y, dims.z};
+    std::unique_ptr<float[]> alongY(new float[yDims.count()]);
+    halveY(alongX.get(), xDims, alongY.get(), numThreads);
+    alongX.reset();
+
+    std::unique_ptr<float[]> out(new float[outDims.count()]);
+    halveZ(alongY.get(), yDims, out.get(), numThreads);
+    return out;
+}
+
+}
+
+
+VolumePyramid::VolumePyramid(const VoxelArray &base, int maxLevels, int numThreads)
+    : seconds(0.0)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    arrays.push_back(base);
+    while (maxLevels <= 0 || arrays.size() < (size_t)maxLevels)
+    {
+        const VoxelArray &finer = arrays.back();
+        const VolumeDims &dims = finer.dims;
+        if (dims.x < 3 || dims.y < 3 || dims.z < 3)
+            break;
+
+        VolumeDims outDims;
+        std::unique_ptr<float[]> voxels;
+        switch (finer.type)
+        {
+        case VOXEL_UINT8:
+            voxels = halve((const uint8_t *)finer.voxels, dims, outDims, numThreads);
+            break;
+        case VOXEL_UINT16:
+            voxels = halve((const uint16_t *)finer.voxels, dims, outDims, numThreads);
+            break;
+        case VOXEL_FLOAT:
+            voxels = halve((const float *)finer.voxels, dims, outDims, numThreads);
+            break;
+        case VOXEL_DOUBLE:
+            voxels = halve((const double *)finer.voxels, dims, outDims, numThreads);
+            break;
+        }
+
+        arrays.push_back({voxels.get(), VOXEL_FLOAT, outDims});
+        storage.push_back(std::move(voxels));
+    }
+
+    seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+
+void VolumePyramid::spacingScale(size_t i, float scale[3]) const
+{
+    const VolumeDims &base = arrays[0].dims;
+    const VolumeDims &dims = arrays[i].dims;
+    scale[0] = dims.x > 1 ? (float)(base.x - 1) / (dims.x - 1) : 1.0f;
+    scale[1] = dims.y > 1 ? (float)(base.y - 1) / (dims.y - 1) : 1.0f;
+    scale[2] = dims.z > 1 ? (float)(base.z - 1) / (dims.z - 1) : 1.0f;
+}
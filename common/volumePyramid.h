@@ -0,0 +1,56 @@
+//
+// A mip pyramid of a structured volume: each level halves the voxel
+// count along every axis, so a renderer far from the volume can sample
+// a level whose voxels are about a pixel in size instead of the full
+// resolution.
+//
+// Voxels sit on grid points, so level l + 1 keeps every other grid
+// point of level l, filtered with a 1-2-1 tent along each axis, and
+// every level spans the same extent from the same origin. On an axis
+// with an odd number of voxels that is exactly twice the spacing; on
+// an even one the coarser grid stretches to reach the last voxel, and
+// each coarse point filters around the fine point nearest to it.
+//
+
+#ifndef OSPRAY_DEMOS_VOLUME_PYRAMID_H
+#define OSPRAY_DEMOS_VOLUME_PYRAMID_H
+
+#include <memory>
+#include <vector>
+#include <stddef.h>
+
+#include "voxelArray.h"
+
+class VolumePyramid
+{
+  public:
+    //
+    // Build levels 1 and up from base, which is level 0 and must
+    // outlive the pyramid, until an axis would drop below 2 voxels or
+    // maxLevels levels exist (no limit for 0). Coarser levels are
+    // float whatever the type of base, in the same value units. Each
+    // level is built on numThreads threads (one per core for 0), with
+    // SSE where available.
+    //
+    VolumePyramid(const VoxelArray &base, int maxLevels = 0, int numThreads = 0);
+
+    size_t levels() const { return arrays.size(); }
+
+    const VoxelArray &level(size_t i) const { return arrays[i]; }
+
+    //
+    // How many times level 0's grid spacing level i's is along x, y
+    // and z, so that both span the same extent.
+    //
+    void spacingScale(size_t i, float scale[3]) const;
+
+    // Seconds the constructor took.
+    double buildSeconds() const { return seconds; }
+
+  private:
+    std::vector<VoxelArray>               arrays;
+    std::vector<std::unique_ptr<float[]>> storage;
+    double                                seconds;
+};
+
+#endif
@@ -0,0 +1,360 @@
+//
+// Time-varying structured volumes.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "volumeSeries.h"
+#include "voxelQuantize.h"
+
+VolumeSeriesOptions parseVolumeSeriesOptions(int argc, const char **argv)
+{
+    VolumeSeriesOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--time-series") == 0 && i + 1 < argc)
+            options.pattern = argv[++i];
+        else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+        {
+            // B:E, B: or :E
+            const char *steps = argv[++i];
+            const char *colon = strchr(steps, ':');
+            if (colon == nullptr)
+            {
+                fprintf(stderr, "Bad --steps '%s', expected BEGIN:END\n", steps);
+                continue;
+            }
+            options.firstStep = std::max(0, atoi(steps));
+            options.endStep   = colon[1] ? atoi(colon + 1) : -1;
+        }
+    }
+
+    return options;
+}
+
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Steps the scan for the end of a series without --steps looks at.
+const int maxScanSteps = 1000000;
+
+//
+// Whether pattern holds exactly one int conversion (%d or %i, with
+// flags, width and precision) and no other directive but %%, so it is
+// safe to hand to snprintf and names a different file for each step.
+//
+bool validStepPattern(const std::string &pattern)
+{
+    int conversions = 0;
+    for (const char *p = pattern.c_str(); *p; ++p)
+    {
+        if (*p != '%')
+            continue;
+        if (*++p == '%')
+            continue;
+        while (*p && strchr("-+ #0", *p))
+            ++p;
+        while (*p >= '0' && *p <= '9')
+            ++p;
+        if (*p == '.')
+        {
+            ++p;
+            while (*p >= '0' && *p <= '9')
+                ++p;
+        }
+        if (*p != 'd' && *p != 'i')
+            return false;
+        ++conversions;
+    }
+    return conversions == 1;
+}
+
+std::string stepFileName(const std::string &pattern, int step)
+{
+    char name[4096];
+    snprintf(name, sizeof(name), pattern.c_str(), step);
+    return name;
+}
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}
+
+
+VolumeSeries::VolumeSeries(const VolumeSeriesOptions &options,
+                           const VolumeFileOptions &fileOptions,
+                           VoxelType storageType,
+                           const HistogramOptions &histogramOptions)
+    : options(options),
+      fileOptions(fileOptions),
+      storageType(storageType),
+      histogramOptions(histogramOptions),
+      fileType(VOXEL_FLOAT),
+      dims{0, 0, 0},
+      numSteps(0),
+      firstRange{0.0f, 0.0f},
+      ranges{{0.0f, 0.0f}, {0.0f, 0.0f}},
+      held{-1, -1},
+      current(1),
+      prefetched(0),
+      misses(0),
+      loadSeconds(0.0),
+      waitSeconds(0.0),
+      histograms(0),
+      histogramSeconds(0.0)
+{
+    if (!validStepPattern(options.pattern))
+    {
+        fprintf(stderr, "Bad --time-series '%s': expected one %%d (or %%i) for the "
+                "step and no other %% directives but %%%%\n", options.pattern.c_str());
+        return;
+    }
+
+    // Without an end step, the series runs to the first missing file.
+    int endStep = options.endStep;
+    if (endStep < 0)
+    {
+        endStep = options.firstStep;
+        while (endStep - options.firstStep < maxScanSteps &&
+               access(stepFileName(options.pattern, endStep).c_str(), R_OK) == 0)
+            ++endStep;
+    }
+    if (endStep <= options.firstStep)
+    {
+        fprintf(stderr, "No timesteps: '%s' has no file for step %d\n",
+                options.pattern.c_str(), options.firstStep);
+        return;
+    }
+
+    this->fileOptions.fileName = stepFileName(options.pattern, options.firstStep);
+    MappedVolume first(this->fileOptions);
+    if (!first.ok())
+        return;
+
+    dims     = first.voxels().dims;
+    fileType = first.voxels().type;
+
+    std::unique_ptr<VoxelHistogram> firstHistogram;
+    if (histogramOptions.emptyBins)
+        firstHistogram.reset(new VoxelHistogram(first.voxels()));
+
+    if (fileOptions.haveValueRange)
+    {
+        firstRange[0] = fileOptions.valueRange[0];
+        firstRange[1] = fileOptions.valueRange[1];
+    }
+    else if (firstHistogram)
+    {
+        firstRange[0] = firstHistogram->percentile(histogramOptions.percentiles[0]);
+        firstRange[1] = firstHistogram->percentile(histogramOptions.percentiles[1]);
+    }
+    else
+    {
+        voxelRange(first.voxels(), firstRange[0], firstRange[1]);
+    }
+
+    if (storageType != VOXEL_UINT8 && storageType != VOXEL_UINT16)
+        this->storageType = fileType;
+
+    size_t bytes = dims.count() * voxelTypeSize(this->storageType);
+    buffers[0].reset(new unsigned char[bytes]);
+    buffers[1].reset(new unsigned char[bytes]);
+
+    numSteps = endStep - options.firstStep;
+
+    char summary[128];
+    snprintf(summary, sizeof(summary), " steps %d:%d (%zux%zux%zu %s)",
+             options.firstStep, endStep, dims.x, dims.y, dims.z,
+             voxelTypeName(this->storageType));
+    what = options.pattern + summary;
+    if (histogramOptions.enabled() && !fileOptions.haveValueRange)
+    {
+        snprintf(summary, sizeof(summary), ", percentiles %g:%g%s",
+                 histogramOptions.percentiles[0], histogramOptions.percentiles[1],
+                 histogramOptions.emptyBins ? " without empty bins" : "");
+        what += summary;
+    }
+}
+
+
+VolumeSeries::~VolumeSeries()
+{
+    join();
+}
+
+
+VoxelArray VolumeSeries::buffer(int index) const
+{
+    return {buffers[index].get(), storageType, dims};
+}
+
+
+int VolumeSeries::fetch(size_t step)
+{
+    if (loader.joinable())
+    {
+        Clock::time_point start = Clock::now();
+        join();
+        waitSeconds += secondsSince(start);
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (held[i] == (long)step)
+        {
+            current = i;
+            return i;
+        }
+    }
+
+    // Not read ahead; read it now into the buffer not being rendered.
+    ++misses;
+    int index = 1 - current;
+    Clock::time_point start = Clock::now();
+    held[index] = load(step, index) ? (long)step : -1;
+    waitSeconds += secondsSince(start);
+    if (held[index] < 0)
+        return -1;
+
+    current = index;
+    return index;
+}
+
+
+void VolumeSeries::prefetch(size_t step)
+{
+    int index = 1 - current;
+    if (loader.joinable() || held[index] == (long)step)
+        return;
+
+    ++prefetched;
+    held[index] = -1;
+    loader = std::thread([this, step, index]()
+    {
+        if (load(step, index))
+            held[index] = step;
+    });
+}
+
+
+bool VolumeSeries::load(size_t step, int index)
+{
+    Clock::time_point start = Clock::now();
+
+    VolumeFileOptions stepOptions = fileOptions;
+    stepOptions.fileName = stepFileName(options.pattern, options.firstStep + step);
+    MappedVolume file(stepOptions);
+    if (!file.ok())
+        return false;
+
+    const VoxelArray &voxels = file.voxels();
+    if (voxels.type != fileType || voxels.dims.x != dims.x ||
+        voxels.dims.y != dims.y || voxels.dims.z != dims.z)
+    {
+        fprintf(stderr, "'%s' is %s, not the %zux%zux%zu %s of the first step\n",
+                file.description().c_str(), voxelTypeName(voxels.type),
+                dims.x, dims.y, dims.z, voxelTypeName(fileType));
+        return false;
+    }
+
+    // One thread, so reading ahead doesn't take cores from rendering.
+    // The opacities leave out the values this step lacks.
+    std::unique_ptr<VoxelHistogram> &histogram = stepHistograms[index];
+    histogram.reset();
+    if (histogramOptions.emptyBins)
+    {
+        histogram.reset(new VoxelHistogram(voxels, 1024, 1));
+        ++histograms;
+        histogramSeconds += histogram->seconds();
+    }
+
+    float *range = ranges[index];
+    stepRange(voxels, histogram.get(), range[0], range[1]);
+    if (storageType == fileType)
+        memcpy(buffers[index].get(), voxels.voxels, voxels.bytes());
+    else
+        quantizeVoxels(voxels, range[0], range[1], storageType,
+                       buffers[index].get(), nullptr, 1);
+
+    loadSeconds += secondsSince(start);
+    return true;
+}
+
+
+void VolumeSeries::stepRange(const VoxelArray &voxels, const VoxelHistogram *histogram,
+                             float &lo, float &hi)
+{
+    if (fileOptions.haveValueRange || !histogramOptions.enabled())
+    {
+        lo = firstRange[0];
+        hi = firstRange[1];
+        return;
+    }
+
+    std::unique_ptr<VoxelHistogram> own;
+    if (histogram == nullptr)
+    {
+        own.reset(new VoxelHistogram(voxels, 1024, 1));
+        histogram = own.get();
+        ++histograms;
+        histogramSeconds += histogram->seconds();
+    }
+    lo = histogram->percentile(histogramOptions.percentiles[0]);
+    hi = histogram->percentile(histogramOptions.percentiles[1]);
+}
+
+
+void VolumeSeries::valueRange(int index, float &lo, float &hi) const
+{
+    if (storageType == fileType)
+    {
+        lo = ranges[index][0];
+        hi = ranges[index][1];
+    }
+    else
+    {
+        lo = 0.0f;
+        hi = quantizedMax(storageType);
+    }
+}
+
+
+std::vector<float> VolumeSeries::opacities(int index, const std::vector<float> &base) const
+{
+    const std::unique_ptr<VoxelHistogram> &histogram = stepHistograms[index];
+    if (!histogram)
+        return base;
+    return histogram->emptyBinOpacities(base, ranges[index][0], ranges[index][1]);
+}
+
+
+void VolumeSeries::join()
+{
+    if (loader.joinable())
+        loader.join();
+}
+
+
+void VolumeSeries::printSummary()
+{
+    // The loader updates the counts below as it goes.
+    join();
+
+    printf("\nTime series: %zu steps read ahead, %zu read on demand; reading took "
+           "%.2f s, rendering waited %.2f s for it\n",
+           prefetched, misses, loadSeconds, waitSeconds);
+    if (histograms > 0)
+        printf("Histograms of %zu steps took %.1f ms each on one thread\n",
+               histograms, 1000.0 * histogramSeconds / histograms);
+}
@@ -0,0 +1,149 @@
+//
+// Time-varying structured volumes: one raw or BOV file per timestep
+// (see volumeFile.h), read into one of two buffers by a background
+// thread while the other is being rendered.
+//
+
+#ifndef OSPRAY_DEMOS_VOLUME_SERIES_H
+#define OSPRAY_DEMOS_VOLUME_SERIES_H
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+
+#include "volumeFile.h"
+#include "voxelArray.h"
+#include "voxelHistogram.h"
+
+//
+// Time series options as given on the command line.
+//
+//   --time-series PATTERN  printf pattern of the timestep files, given
+//                          the step number, e.g. run/density_%04d.bov;
+//                          exactly one %d or %i, and no other % but %%
+//   --steps B:E            steps B up to (not including) E; either end
+//                          may be left out, and E defaults to the first
+//                          missing file (looking at most a million on)
+//
+// Raw files take --raw-dims, --raw-type and --raw-offset, and every
+// file takes --madvise, as for --volume.
+//
+struct VolumeSeriesOptions
+{
+    std::string pattern;
+    int         firstStep;
+    int         endStep;
+
+    VolumeSeriesOptions()
+        : firstStep(0),
+          endStep(-1)
+    {}
+
+    bool enabled() const { return !pattern.empty(); }
+};
+
+VolumeSeriesOptions parseVolumeSeriesOptions(int argc, const char **argv);
+
+class VolumeSeries
+{
+  public:
+    //
+    // Find the steps and read the first one, which sets the size and
+    // type every step must have. The value range is --value-range, or
+    // else the first step's, or with percentiles in histogramOptions
+    // each step's own; with storageType uint8 or uint16 every step is
+    // quantized over it (see voxelQuantize.h), otherwise the
+    // voxels keep their type. Check ok() after; failures are printed.
+    //
+    VolumeSeries(const VolumeSeriesOptions &options,
+                 const VolumeFileOptions &fileOptions,
+                 VoxelType storageType,
+                 const HistogramOptions &histogramOptions = HistogramOptions());
+
+    // Waits for a prefetch still running.
+    ~VolumeSeries();
+
+    VolumeSeries(const VolumeSeries &) = delete;
+    VolumeSeries &operator=(const VolumeSeries &) = delete;
+
+    bool ok() const { return numSteps > 0; }
+
+    size_t steps() const { return numSteps; }
+
+    // The voxels of buffer 0 or 1.
+    VoxelArray buffer(int index) const;
+
+    // The range of the transfer function for buffer 0 or 1, in stored
+    // units.
+    void valueRange(int index, float &lo, float &hi) const;
+
+    //
+    // The transfer function opacities for buffer 0 or 1 to use in place
+    // of base, with zeros where its step has no voxels in its value
+    // range if --empty-bins is given (see
+    // VoxelHistogram::emptyBinOpacities).
+    //
+    std::vector<float> opacities(int index, const std::vector<float> &base) const;
+
+    //
+    // The buffer holding step, 0 to steps() - 1, after waiting for a
+    // prefetch of it, or reading it now if it wasn't prefetched. The
+    // other buffer may then be overwritten by prefetch. Returns -1 if
+    // the step can't be read.
+    //
+    int fetch(size_t step);
+
+    //
+    // Start reading step into the buffer fetch didn't return last.
+    //
+    void prefetch(size_t step);
+
+    //
+    // Print how many steps were read ahead, how long rendering had to
+    // wait for them and how long their histograms took, after waiting
+    // for any step still being read.
+    //
+    void printSummary();
+
+    const std::string &description() const { return what; }
+
+  private:
+    bool load(size_t step, int index);
+    void join();
+
+    // The value range of the file's voxels: fixed, or from histogram,
+    // or from one made now if that is null.
+    void stepRange(const VoxelArray &voxels, const VoxelHistogram *histogram,
+                   float &lo, float &hi);
+
+    VolumeSeriesOptions options;
+    VolumeFileOptions   fileOptions;
+    VoxelType           storageType;
+    HistogramOptions    histogramOptions;
+    VoxelType           fileType;
+    VolumeDims          dims;
+    size_t              numSteps;
+    std::string         what;
+
+    float firstRange[2];
+
+    std::unique_ptr<unsigned char[]> buffers[2];
+    float                            ranges[2][2];
+    long                             held[2];
+    int                              current;
+    std::thread                      loader;
+
+    // The histogram of each buffer's step, for --empty-bins.
+    std::unique_ptr<VoxelHistogram> stepHistograms[2];
+
+    size_t prefetched;
+    size_t misses;
+    double loadSeconds;
+    double waitSeconds;
+    size_t histograms;
+    double histogramSeconds;
+};
+
+#endif
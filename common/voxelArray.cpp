@@ -0,0 +1,189 @@
+//
+// Structured volume voxels of any of the scalar types OSPRay takes.
+//
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include "voxelArray.h"
+#include "parallelFor.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+const char *typeNames[] = {
+    "uint8",
+    "uint16",
+    "float",
+    "double",
+};
+
+const int numTypes = sizeof(typeNames) / sizeof(typeNames[0]);
+
+// Voxels per thread below which the range is found on one thread.
+const size_t minVoxelsPerThread = 1 << 18;
+
+//
+// The comparisons below are false for NaN, so NaN voxels are skipped
+// rather than carried into the range; hence the infinite seeds instead
+// of the first voxel.
+//
+template <typename T>
+void rangeScalar(const T *voxels, size_t count, float &minValue, float &maxValue)
+{
+    T lo = std::numeric_limits<T>::max();
+    T hi = std::numeric_limits<T>::lowest();
+    for (size_t i = 0; i < count; ++i)
+    {
+        lo = std::min(lo, voxels[i]);
+        hi = std::max(hi, voxels[i]);
+    }
+    minValue = std::min(minValue, (float)lo);
+    maxValue = std::max(maxValue, (float)hi);
+}
+
+template <typename T>
+void rangeChunk(const T *voxels, size_t count, float &minValue, float &maxValue)
+{
+    minValue = std::numeric_limits<float>::infinity();
+    maxValue = -std::numeric_limits<float>::infinity();
+    rangeScalar(voxels, count, minValue, maxValue);
+}
+
+#if defined(__SSE__)
+
+//
+// Keeps four running minima and maxima in SSE registers, two registers
+// of each to hide the instruction latency, then folds them together.
+// _mm_min_ps and _mm_max_ps return their second operand for NaN, so
+// the running values go second.
+//
+template <>
+void rangeChunk<float>(const float *voxels, size_t count, float &minValue, float &maxValue)
+{
+    minValue = std::numeric_limits<float>::infinity();
+    maxValue = -std::numeric_limits<float>::infinity();
+
+    size_t i = 0;
+    if (count >= 8)
+    {
+        __m128 min0 = _mm_set1_ps(minValue), min1 = min0;
+        __m128 max0 = _mm_set1_ps(maxValue), max1 = max0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128 a = _mm_loadu_ps(voxels + i);
+            __m128 b = _mm_loadu_ps(voxels + i + 4);
+            min0 = _mm_min_ps(a, min0);
+            min1 = _mm_min_ps(b, min1);
+            max0 = _mm_max_ps(a, max0);
+            max1 = _mm_max_ps(b, max1);
+        }
+
+        float mins[4], maxs[4];
+        _mm_storeu_ps(mins, _mm_min_ps(min0, min1));
+        _mm_storeu_ps(maxs, _mm_max_ps(max0, max1));
+        minValue = *std::min_element(mins, mins + 4);
+        maxValue = *std::max_element(maxs, maxs + 4);
+    }
+    if (i < count)
+        rangeScalar(voxels + i, count - i, minValue, maxValue);
+}
+
+#endif
+
+template <typename T>
+void rangeParallel(const T *voxels,
+                   size_t count,
+                   float &minValue,
+                   float &maxValue,
+                   int numThreads)
+{
+    std::vector<float> mins(numThreads), maxs(numThreads);
+    int numChunks = parallelChunks(count,
+        [&](int chunk, size_t begin, size_t end)
+        {
+            rangeChunk(voxels + begin, end - begin, mins[chunk], maxs[chunk]);
+        },
+        numThreads, minVoxelsPerThread);
+
+    minValue = *std::min_element(mins.begin(), mins.begin() + numChunks);
+    maxValue = *std::max_element(maxs.begin(), maxs.begin() + numChunks);
+
+    // Nothing but NaN.
+    if (minValue > maxValue)
+        minValue = maxValue = 0.0f;
+}
+
+}
+
+
+size_t voxelTypeSize(VoxelType type)
+{
+    switch (type)
+    {
+    case VOXEL_UINT8:  return 1;
+    case VOXEL_UINT16: return 2;
+    case VOXEL_FLOAT:  return 4;
+    case VOXEL_DOUBLE: return 8;
+    }
+    return 0;
+}
+
+
+const char *voxelTypeName(VoxelType type)
+{
+    return type < numTypes ? typeNames[type] : "unknown";
+}
+
+
+bool parseVoxelType(const char *name, VoxelType &type)
+{
+    for (int t = 0; t < numTypes; ++t)
+    {
+        if (strcmp(name, typeNames[t]) == 0)
+        {
+            type = (VoxelType)t;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void voxelRange(const VoxelArray &array,
+                float &minValue,
+                float &maxValue,
+                int numThreads)
+{
+    size_t count = array.dims.count();
+    if (count == 0)
+    {
+        minValue = maxValue = 0.0f;
+        return;
+    }
+
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    switch (array.type)
+    {
+    case VOXEL_UINT8:
+        rangeParallel((const uint8_t *)array.voxels, count, minValue, maxValue, numThreads);
+        break;
+    case VOXEL_UINT16:
+        rangeParallel((const uint16_t *)array.voxels, count, minValue, maxValue, numThreads);
+        break;
+    case VOXEL_FLOAT:
+        rangeParallel((const float *)array.voxels, count, minValue, maxValue, numThreads);
+        break;
+    case VOXEL_DOUBLE:
+        rangeParallel((const double *)array.voxels, count, minValue, maxValue, numThreads);
+        break;
+    }
+}
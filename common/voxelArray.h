@@ -0,0 +1,62 @@
+//
+// Structured volume voxels of any of the scalar types OSPRay takes.
+//
+
+#ifndef OSPRAY_DEMOS_VOXEL_ARRAY_H
+#define OSPRAY_DEMOS_VOXEL_ARRAY_H
+
+#include <stddef.h>
+
+enum VoxelType
+{
+    VOXEL_UINT8,
+    VOXEL_UINT16,
+    VOXEL_FLOAT,
+    VOXEL_DOUBLE
+};
+
+size_t voxelTypeSize(VoxelType type);
+
+const char *voxelTypeName(VoxelType type);
+
+//
+// Accepts the names voxelTypeName gives: uint8, uint16, float, double.
+//
+bool parseVoxelType(const char *name, VoxelType &type);
+
+//
+// Voxel counts along x, y and z. Voxels are stored x fastest.
+//
+struct VolumeDims
+{
+    size_t x;
+    size_t y;
+    size_t z;
+
+    size_t count() const { return x * y * z; }
+};
+
+//
+// A view of voxels owned elsewhere: generated, loaded or mapped.
+//
+struct VoxelArray
+{
+    const void *voxels;
+    VoxelType   type;
+    VolumeDims  dims;
+
+    size_t bytes() const { return dims.count() * voxelTypeSize(type); }
+};
+
+//
+// Smallest and largest voxel, on several threads for large arrays and
+// with SSE for float voxels where available. Reads every voxel, so for
+// a mapped file this faults in all of it. NaN voxels are skipped,
+// and a range of only NaN is 0:0.
+//
+void voxelRange(const VoxelArray &array,
+                float &minValue,
+                float &maxValue,
+                int numThreads = 0);
+
+#endif
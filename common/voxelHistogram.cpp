@@ -0,0 +1,335 @@
+//
+// Histograms of voxel values.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "voxelHistogram.h"
+#include "parallelFor.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+HistogramOptions parseHistogramOptions(int argc, const char **argv)
+{
+    HistogramOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--percentiles") == 0 && i + 1 < argc)
+        {
+            const char *range = argv[++i];
+            const char *colon = strchr(range, ':');
+            if (colon == nullptr)
+            {
+                fprintf(stderr, "Bad --percentiles '%s', expected LO:HI\n", range);
+                continue;
+            }
+            options.percentiles[0] = std::max(0.0f, (float)atof(range));
+            options.percentiles[1] = std::min(100.0f, (float)atof(colon + 1));
+        }
+        else if (strcmp(argv[i], "--empty-bins") == 0)
+            options.emptyBins = true;
+    }
+
+    return options;
+}
+
+
+namespace {
+
+// Values per thread below which counting runs on one thread.
+const size_t minValuesPerThread = 1 << 18;
+
+//
+// Every thread counts into its own histogram, and each of those is
+// split into lanes that successive values take turns at, so runs of
+// equal values don't wait on one counter. Lanes count in 32 bits to
+// stay in the L1 cache, so they are emptied into 64 bit totals every
+// blockSize values.
+//
+const size_t numLanes = 4;
+const size_t blockSize = (size_t)1 << 30;
+
+//
+// Count integer values directly, one counter per possible value.
+//
+template <typename T>
+void countValues(const T *values, size_t begin, size_t end, uint32_t *lanes,
+                 size_t numValues)
+{
+    size_t i = begin;
+    for (; i + numLanes <= end; i += numLanes)
+        for (size_t lane = 0; lane < numLanes; ++lane)
+            ++lanes[lane * numValues + values[i + lane]];
+    for (; i < end; ++i)
+        ++lanes[values[i]];
+}
+
+//
+// Count values into bins of the range [lo, lo + numBins / scale],
+// skipping NaN, which belongs in no bin.
+//
+template <typename T>
+void countBins(const T *values, size_t begin, size_t end, float lo, float scale,
+               size_t numBins, uint32_t *lanes)
+{
+    const float top = (float)(numBins - 1);
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (values[i] != values[i])
+            continue;
+        float x = ((float)values[i] - lo) * scale;
+        x = (x >= 0.0f) ? std::min(x, top) : 0.0f;
+        ++lanes[(i % numLanes) * numBins + (size_t)x];
+    }
+}
+
+#if defined(__SSE2__)
+
+//
+// Four bin indices at a time, one for each lane. Groups with a NaN in
+// them only count their other values.
+//
+template <>
+void countBins<float>(const float *values, size_t begin, size_t end, float lo,
+                      float scale, size_t numBins, uint32_t *lanes)
+{
+    const __m128 loV    = _mm_set1_ps(lo);
+    const __m128 scaleV = _mm_set1_ps(scale);
+    const __m128 topV   = _mm_set1_ps((float)(numBins - 1));
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(values + i);
+        __m128 x = _mm_mul_ps(_mm_sub_ps(v, loV), scaleV);
+        x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), topV);
+
+        alignas(16) int32_t bins[4];
+        _mm_store_si128((__m128i *)bins, _mm_cvttps_epi32(x));
+        int ordered = _mm_movemask_ps(_mm_cmpord_ps(v, v));
+        if (ordered == 0xf)
+        {
+            ++lanes[bins[0]];
+            ++lanes[numBins + bins[1]];
+            ++lanes[2 * numBins + bins[2]];
+            ++lanes[3 * numBins + bins[3]];
+        }
+        else
+        {
+            for (size_t lane = 0; lane < 4; ++lane)
+                if (ordered & (1 << lane))
+                    ++lanes[lane * numBins + bins[lane]];
+        }
+    }
+
+    const float top = (float)(numBins - 1);
+    for (; i < end; ++i)
+    {
+        if (values[i] != values[i])
+            continue;
+        float x = (values[i] - lo) * scale;
+        x = (x >= 0.0f) ? std::min(x, top) : 0.0f;
+        ++lanes[(size_t)x];
+    }
+}
+
+#endif
+
+//
+// Run count(begin, end, lanes) over chunks of n values and sum the
+// lanes of every chunk into one histogram of size counters.
+//
+template <typename Count>
+std::vector<uint64_t> countParallel(size_t n, size_t size, int numThreads, Count count)
+{
+    std::vector<std::vector<uint64_t>> totals(numThreads);
+    int numChunks = parallelChunks(n,
+        [&](int chunk, size_t begin, size_t end)
+        {
+            std::vector<uint32_t> lanes(numLanes * size);
+            std::vector<uint64_t> &total = totals[chunk];
+            total.assign(size, 0);
+
+            for (size_t block = begin; block < end; block += blockSize)
+            {
+                std::fill(lanes.begin(), lanes.end(), 0);
+                count(block, std::min(end, block + blockSize), lanes.data());
+
+                for (size_t lane = 0; lane < numLanes; ++lane)
+                    for (size_t i = 0; i < size; ++i)
+                        total[i] += lanes[lane * size + i];
+            }
+        },
+        numThreads, minValuesPerThread);
+
+    for (int chunk = 1; chunk < numChunks; ++chunk)
+        for (size_t i = 0; i < size; ++i)
+            totals[0][i] += totals[chunk][i];
+    return totals[0];
+}
+
+template <typename T>
+std::vector<uint64_t> integerHistogram(const T *values, size_t n, size_t numBins,
+                                       int numThreads, float &lo, float &hi)
+{
+    const size_t numValues = (size_t)1 << (8 * sizeof(T));
+    std::vector<uint64_t> perValue = countParallel(n, numValues, numThreads,
+        [&](size_t begin, size_t end, uint32_t *lanes)
+        {
+            countValues(values, begin, end, lanes, numValues);
+        });
+
+    size_t first = 0, last = numValues - 1;
+    while (first < last && perValue[first] == 0)
+        ++first;
+    while (last > first && perValue[last] == 0)
+        --last;
+    lo = (float)first;
+    hi = (float)last;
+
+    // Spread the per-value counts over the bins.
+    std::vector<uint64_t> bins(numBins, 0);
+    const float scale = hi > lo ? numBins / (hi - lo) : 0.0f;
+    for (size_t v = first; v <= last; ++v)
+        bins[std::min(numBins - 1, (size_t)((v - first) * scale))] += perValue[v];
+    return bins;
+}
+
+template <typename T>
+std::vector<uint64_t> binnedHistogram(const VoxelArray &array, size_t numBins,
+                                      int numThreads, float &lo, float &hi)
+{
+    voxelRange(array, lo, hi, numThreads);
+
+    const T *values = (const T *)array.voxels;
+    const float scale = hi > lo ? numBins / (hi - lo) : 0.0f;
+    return countParallel(array.dims.count(), numBins, numThreads,
+        [&](size_t begin, size_t end, uint32_t *lanes)
+        {
+            countBins(values, begin, end, lo, scale, numBins, lanes);
+        });
+}
+
+}
+
+
+VoxelHistogram::VoxelHistogram(const VoxelArray &values, size_t numBins, int numThreads)
+    : lo(0.0f),
+      hi(0.0f),
+      totalCount(values.dims.count()),
+      buildSeconds(0.0)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    numBins = std::max<size_t>(1, numBins);
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    if (totalCount == 0)
+    {
+        counts.assign(numBins, 0);
+        return;
+    }
+
+    switch (values.type)
+    {
+    case VOXEL_UINT8:
+        counts = integerHistogram((const uint8_t *)values.voxels, totalCount, numBins,
+                                  numThreads, lo, hi);
+        break;
+    case VOXEL_UINT16:
+        counts = integerHistogram((const uint16_t *)values.voxels, totalCount, numBins,
+                                  numThreads, lo, hi);
+        break;
+    case VOXEL_FLOAT:
+        counts = binnedHistogram<float>(values, numBins, numThreads, lo, hi);
+        break;
+    case VOXEL_DOUBLE:
+        counts = binnedHistogram<double>(values, numBins, numThreads, lo, hi);
+        break;
+    }
+
+    // NaN voxels are in no bin, and don't count towards the percentiles.
+    totalCount = 0;
+    for (uint64_t binCount : counts)
+        totalCount += binCount;
+
+    buildSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+
+float VoxelHistogram::percentile(float p) const
+{
+    if (totalCount == 0)
+        return lo;
+
+    const double target = std::min(std::max(p, 0.0f), 100.0f) / 100.0 * totalCount;
+    const double binWidth = (double)(hi - lo) / counts.size();
+
+    uint64_t below = 0;
+    for (size_t b = 0; b < counts.size(); ++b)
+    {
+        if (counts[b] > 0 && below + counts[b] >= target)
+        {
+            double fraction = (target - below) / counts[b];
+            return (float)(lo + (b + fraction) * binWidth);
+        }
+        below += counts[b];
+    }
+    return hi;
+}
+
+
+uint64_t VoxelHistogram::count(float from, float to) const
+{
+    if (to < lo || from > hi)
+        return 0;
+    if (hi <= lo)
+        return totalCount;
+
+    const float scale = counts.size() / (hi - lo);
+    const size_t last = counts.size() - 1;
+    size_t first = (size_t)std::max(0.0f, (from - lo) * scale);
+    size_t end   = std::min(last, (size_t)std::max(0.0f, (to - lo) * scale));
+
+    uint64_t sum = 0;
+    for (size_t b = std::min(first, last); b <= end; ++b)
+        sum += counts[b];
+    return sum;
+}
+
+
+std::vector<float> VoxelHistogram::emptyBinOpacities(const std::vector<float> &base,
+                                                     float rangeLo,
+                                                     float rangeHi,
+                                                     size_t numPoints) const
+{
+    numPoints = std::max<size_t>(2, numPoints);
+    const float step = (rangeHi - rangeLo) / (numPoints - 1);
+
+    std::vector<float> opacities(numPoints, 0.0f);
+    for (size_t i = 0; i < numPoints; ++i)
+    {
+        // base at the same fraction of the range.
+        float t = base.size() > 1 ? (float)i / (numPoints - 1) * (base.size() - 1) : 0.0f;
+        size_t j = std::min((size_t)t, base.size() > 1 ? base.size() - 2 : 0);
+        float f = t - j;
+        float opacity = base.empty() ? 0.0f
+                      : base.size() == 1 ? base[0]
+                      : base[j] * (1.0f - f) + base[j + 1] * f;
+
+        // The values this point's opacity reaches.
+        float from = i == 0 ? lo : rangeLo + (i - 1) * step;
+        float to   = i == numPoints - 1 ? hi : rangeLo + (i + 1) * step;
+        opacities[i] = count(from, to) > 0 ? opacity : 0.0f;
+    }
+    return opacities;
+}
@@ -0,0 +1,97 @@
+//
+// Histograms of voxel values, for transfer function ranges that aren't
+// stretched by a few outliers and for leaving empty value ranges out of
+// the transfer function altogether.
+//
+
+#ifndef OSPRAY_DEMOS_VOXEL_HISTOGRAM_H
+#define OSPRAY_DEMOS_VOXEL_HISTOGRAM_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "voxelArray.h"
+
+//
+// Histogram options as given on the command line.
+//
+//   --percentiles LO:HI    transfer function range from the LO and HI
+//                          percentiles of the voxel values, e.g. 1:99,
+//                          instead of their minimum and maximum
+//   --empty-bins           zero opacity wherever the histogram is empty
+//
+struct HistogramOptions
+{
+    float percentiles[2];
+    bool  emptyBins;
+
+    HistogramOptions()
+        : percentiles{0.0f, 100.0f},
+          emptyBins(false)
+    {}
+
+    bool enabled() const
+    {
+        return percentiles[0] > 0.0f || percentiles[1] < 100.0f || emptyBins;
+    }
+};
+
+HistogramOptions parseHistogramOptions(int argc, const char **argv);
+
+class VoxelHistogram
+{
+  public:
+    //
+    // Count values into numBins equal bins between their minimum and
+    // maximum, on numThreads threads (one per core for 0). uint8 and
+    // uint16 voxels are counted per value in one pass; float and double
+    // need a second for the range, and float bins with SSE where
+    // available. NaN values are in no bin and left out of total().
+    // Cell data, or any other flat array, can be passed as a VoxelArray
+    // of dims {count, 1, 1}.
+    //
+    VoxelHistogram(const VoxelArray &values, size_t numBins = 1024, int numThreads = 0);
+
+    float minValue() const { return lo; }
+    float maxValue() const { return hi; }
+
+    const std::vector<uint64_t> &bins() const { return counts; }
+
+    uint64_t total() const { return totalCount; }
+
+    //
+    // The value below which p percent of the values lie, interpolated
+    // within its bin.
+    //
+    float percentile(float p) const;
+
+    //
+    // The number of values in the bins overlapping [from, to].
+    //
+    uint64_t count(float from, float to) const;
+
+    //
+    // numPoints opacities spaced evenly over [rangeLo, rangeHi] for a
+    // piecewise linear transfer function: base, itself spaced evenly
+    // over the range, resampled, with zero wherever no value lies
+    // between a point's neighbours. The first and last points also
+    // cover the values beyond the range, which clamp to them.
+    //
+    std::vector<float> emptyBinOpacities(const std::vector<float> &base,
+                                         float rangeLo,
+                                         float rangeHi,
+                                         size_t numPoints = 64) const;
+
+    // Seconds the constructor took.
+    double seconds() const { return buildSeconds; }
+
+  private:
+    float                 lo;
+    float                 hi;
+    std::vector<uint64_t> counts;
+    uint64_t              totalCount;
+    double                buildSeconds;
+};
+
+#endif
@@ -0,0 +1,252 @@
+//
+// Quantization of structured volume voxels to 8 or 16 bit integers.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+
+#include "voxelQuantize.h"
+#include "parallelFor.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Voxels per thread below which quantizing runs on one thread.
+const size_t minVoxelsPerThread = 1 << 18;
+
+//
+// Quantizes voxels [begin, end) and returns the largest error in
+// quantized units. NaN becomes 0, as in the SSE paths, and has no
+// error.
+//
+template <typename In, typename Out>
+float quantizeScalar(const In *in,
+                     Out *out,
+                     size_t begin,
+                     size_t end,
+                     float minValue,
+                     float scale,
+                     float top)
+{
+    float maxError = 0.0f;
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (in[i] != in[i])
+        {
+            out[i] = 0;
+            continue;
+        }
+        float x = std::min(std::max(((float)in[i] - minValue) * scale, 0.0f), top);
+        Out q = (Out)(x + 0.5f);
+        out[i] = q;
+        maxError = std::max(maxError, fabsf(((float)in[i] - minValue) * scale - q));
+    }
+    return maxError;
+}
+
+template <typename In, typename Out>
+float quantizeChunk(const In *in,
+                    Out *out,
+                    size_t begin,
+                    size_t end,
+                    float minValue,
+                    float scale,
+                    float top)
+{
+    return quantizeScalar(in, out, begin, end, minValue, scale, top);
+}
+
+#if defined(__SSE2__)
+
+//
+// Scales, clamps and rounds 4 floats, folding the rounding error into
+// maxError. NaN clamps to 0, since max and min return their second
+// operand when either is NaN, and its NaN error is dropped the same
+// way.
+//
+inline __m128i quantize4(const float *in, __m128 minValue, __m128 scale,
+                         __m128 top, __m128 &maxError)
+{
+    const __m128 half     = _mm_set1_ps(0.5f);
+    const __m128 absMask  = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 unclamped = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in), minValue), scale);
+    __m128 x = _mm_min_ps(_mm_max_ps(unclamped, _mm_setzero_ps()), top);
+    __m128i q = _mm_cvttps_epi32(_mm_add_ps(x, half));
+
+    __m128 error = _mm_and_ps(_mm_sub_ps(unclamped, _mm_cvtepi32_ps(q)), absMask);
+    maxError = _mm_max_ps(error, maxError);
+    return q;
+}
+
+float horizontalMax(__m128 v)
+{
+    float lanes[4];
+    _mm_storeu_ps(lanes, v);
+    return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+//
+// 16 floats at a time: the 32 bit results fit signed 16 bits, and
+// then unsigned 8 bits, so two saturating packs narrow them.
+//
+template <>
+float quantizeChunk<float, uint8_t>(const float *in,
+                                    uint8_t *out,
+                                    size_t begin,
+                                    size_t end,
+                                    float minValue,
+                                    float scale,
+                                    float top)
+{
+    const __m128 minV = _mm_set1_ps(minValue);
+    const __m128 scaleV = _mm_set1_ps(scale);
+    const __m128 topV = _mm_set1_ps(top);
+    __m128 maxError = _mm_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m128i q0 = quantize4(in + i,      minV, scaleV, topV, maxError);
+        __m128i q1 = quantize4(in + i + 4,  minV, scaleV, topV, maxError);
+        __m128i q2 = quantize4(in + i + 8,  minV, scaleV, topV, maxError);
+        __m128i q3 = quantize4(in + i + 12, minV, scaleV, topV, maxError);
+
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q0, q1),
+                                          _mm_packs_epi32(q2, q3));
+        _mm_storeu_si128((__m128i *)(out + i), packed);
+    }
+
+    return std::max(horizontalMax(maxError),
+                    quantizeScalar(in, out, i, end, minValue, scale, top));
+}
+
+//
+// 8 floats at a time. Values up to 65535 don't fit the signed pack, so
+// they are shifted down by 32768 first and back up after.
+//
+template <>
+float quantizeChunk<float, uint16_t>(const float *in,
+                                     uint16_t *out,
+                                     size_t begin,
+                                     size_t end,
+                                     float minValue,
+                                     float scale,
+                                     float top)
+{
+    const __m128 minV = _mm_set1_ps(minValue);
+    const __m128 scaleV = _mm_set1_ps(scale);
+    const __m128 topV = _mm_set1_ps(top);
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    __m128 maxError = _mm_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m128i q0 = _mm_sub_epi32(quantize4(in + i,     minV, scaleV, topV, maxError), bias32);
+        __m128i q1 = _mm_sub_epi32(quantize4(in + i + 4, minV, scaleV, topV, maxError), bias32);
+
+        __m128i packed = _mm_xor_si128(_mm_packs_epi32(q0, q1), bias16);
+        _mm_storeu_si128((__m128i *)(out + i), packed);
+    }
+
+    return std::max(horizontalMax(maxError),
+                    quantizeScalar(in, out, i, end, minValue, scale, top));
+}
+
+#endif
+
+template <typename In, typename Out>
+float quantizeParallel(const In *in,
+                       Out *out,
+                       size_t count,
+                       float minValue,
+                       float scale,
+                       float top,
+                       int numThreads)
+{
+    std::vector<float> errors(numThreads, 0.0f);
+    int numChunks = parallelChunks(count,
+        [&](int chunk, size_t begin, size_t end)
+        {
+            errors[chunk] = quantizeChunk(in, out, begin, end, minValue, scale, top);
+        },
+        numThreads, minVoxelsPerThread);
+
+    return *std::max_element(errors.begin(), errors.begin() + numChunks);
+}
+
+template <typename Out>
+float quantizeTo(const VoxelArray &input,
+                 Out *out,
+                 float minValue,
+                 float scale,
+                 float top,
+                 int numThreads)
+{
+    size_t count = input.dims.count();
+    switch (input.type)
+    {
+    case VOXEL_UINT8:
+        return quantizeParallel((const uint8_t *)input.voxels, out, count,
+                                minValue, scale, top, numThreads);
+    case VOXEL_UINT16:
+        return quantizeParallel((const uint16_t *)input.voxels, out, count,
+                                minValue, scale, top, numThreads);
+    case VOXEL_FLOAT:
+        return quantizeParallel((const float *)input.voxels, out, count,
+                                minValue, scale, top, numThreads);
+    case VOXEL_DOUBLE:
+        return quantizeParallel((const double *)input.voxels, out, count,
+                                minValue, scale, top, numThreads);
+    }
+    return 0.0f;
+}
+
+}
+
+
+float quantizedMax(VoxelType type)
+{
+    return type == VOXEL_UINT8 ? 255.0f : 65535.0f;
+}
+
+
+bool quantizeVoxels(const VoxelArray &input,
+                    float minValue,
+                    float maxValue,
+                    VoxelType type,
+                    void *output,
+                    QuantizeStats *stats,
+                    int numThreads)
+{
+    if (type != VOXEL_UINT8 && type != VOXEL_UINT16)
+        return false;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    const float top = quantizedMax(type);
+    const float scale = maxValue > minValue ? top / (maxValue - minValue) : 0.0f;
+
+    float maxError = type == VOXEL_UINT8
+        ? quantizeTo(input, (uint8_t *)output, minValue, scale, top, numThreads)
+        : quantizeTo(input, (uint16_t *)output, minValue, scale, top, numThreads);
+
+    if (stats)
+    {
+        stats->maxError = scale > 0.0f ? maxError / scale : 0.0;
+        stats->seconds  = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return true;
+}
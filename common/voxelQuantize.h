@@ -0,0 +1,46 @@
+//
+// Quantization of structured volume voxels to 8 or 16 bit integers.
+//
+
+#ifndef OSPRAY_DEMOS_VOXEL_QUANTIZE_H
+#define OSPRAY_DEMOS_VOXEL_QUANTIZE_H
+
+#include <stddef.h>
+
+#include "voxelArray.h"
+
+struct QuantizeStats
+{
+    // Largest difference between a voxel and its quantized value,
+    // in the units of the input.
+    double maxError;
+
+    double seconds;
+};
+
+//
+// Convert input to type, VOXEL_UINT8 or VOXEL_UINT16, into output,
+// which must hold input.dims.count() voxels of that type. Values in
+// [minValue, maxValue] are mapped linearly onto the full integer
+// range, rounding to nearest; values outside are clamped, and NaN
+// becomes 0. A transfer function over [minValue, maxValue] on the
+// input looks the same over [0, quantizedMax(type)] on the output.
+//
+// Runs on numThreads threads, or one per core when numThreads is 0,
+// with SSE2 for float input where available. Returns false for an
+// unsupported output type.
+//
+bool quantizeVoxels(const VoxelArray &input,
+                    float minValue,
+                    float maxValue,
+                    VoxelType type,
+                    void *output,
+                    QuantizeStats *stats = nullptr,
+                    int numThreads = 0);
+
+//
+// The largest quantized value of type: 255 or 65535.
+//
+float quantizedMax(VoxelType type);
+
+#endif
@@ -0,0 +1,226 @@
+//
+// Conversion of OSPRay's RGBA8 framebuffers into planar YUV 4:2:0.
+//
+// Fixed point BT.601 limited range:
+//
+//   Y = ((  66 R + 129 G +  25 B + 128) >> 8) +  16
+//   U = (( -38 R -  74 G + 112 B + 128) >> 8) + 128
+//   V = (( 112 R -  94 G -  18 B + 128) >> 8) + 128
+//
+// Chroma is computed from the sum of a 2x2 block, so it is shifted by
+// two more bits rather than averaging first.
+//
+
+#include "yuvConvert.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define YUV_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline unsigned char clampByte(int value)
+{
+    return (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+inline unsigned char luma(const unsigned char *p)
+{
+    return clampByte(((66*p[0] + 129*p[1] + 25*p[2] + 128) >> 8) + 16);
+}
+
+//
+// Convert pixels [begin, width) of a pair of image rows. bottom may be
+// the same row as top when the image has an odd height, in which case
+// yBottom is null.
+//
+void convertRowPairScalar(const unsigned char *top,
+                          const unsigned char *bottom,
+                          unsigned char *yTop,
+                          unsigned char *yBottom,
+                          unsigned char *u,
+                          unsigned char *v,
+                          int begin,
+                          int width)
+{
+    for (int x = begin; x < width; x += 2)
+    {
+        // Repeat the last column for odd widths.
+        int x1 = x + 1 < width ? x + 1 : x;
+
+        const unsigned char *p[4] = {
+            top + 4*x, top + 4*x1, bottom + 4*x, bottom + 4*x1
+        };
+
+        yTop[x]  = luma(p[0]);
+        yTop[x1] = luma(p[1]);
+        if (yBottom)
+        {
+            yBottom[x]  = luma(p[2]);
+            yBottom[x1] = luma(p[3]);
+        }
+
+        int r = p[0][0] + p[1][0] + p[2][0] + p[3][0];
+        int g = p[0][1] + p[1][1] + p[2][1] + p[3][1];
+        int b = p[0][2] + p[1][2] + p[2][2] + p[3][2];
+
+        u[x/2] = clampByte(((-38*r -  74*g + 112*b + 512) >> 10) + 128);
+        v[x/2] = clampByte(((112*r -  94*g -  18*b + 512) >> 10) + 128);
+    }
+}
+
+#ifdef YUV_CONVERT_X86
+
+//
+// Luma of 8 pixels as 16 bit values.
+//
+__attribute__((target("ssse3")))
+inline __m128i lumaSSSE3(__m128i a, __m128i b)
+{
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i coeff = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i bias  = _mm_set1_epi32(16);
+
+    __m128i ya = _mm_hadd_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(a, zero), coeff),
+                                _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), coeff));
+    __m128i yb = _mm_hadd_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(b, zero), coeff),
+                                _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), coeff));
+
+    ya = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(ya, round), 8), bias);
+    yb = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(yb, round), 8), bias);
+
+    return _mm_packs_epi32(ya, yb);
+}
+
+//
+// Channel sums of the two 2x2 blocks covered by 4 pixels of two rows,
+// as 16 bit RGBA RGBA.
+//
+__attribute__((target("ssse3")))
+inline __m128i blockSumsSSSE3(__m128i top, __m128i bottom)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero),
+                               _mm_unpacklo_epi8(bottom, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero),
+                               _mm_unpackhi_epi8(bottom, zero));
+
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i chromaSSSE3(__m128i blocks01, __m128i blocks23, __m128i coeff)
+{
+    const __m128i round = _mm_set1_epi32(512);
+    const __m128i bias  = _mm_set1_epi32(128);
+
+    __m128i c = _mm_hadd_epi32(_mm_madd_epi16(blocks01, coeff),
+                               _mm_madd_epi16(blocks23, coeff));
+    return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(c, round), 10), bias);
+}
+
+//
+// 8 pixels of both rows per iteration, giving 16 luma and 4 of each
+// chroma sample.
+//
+__attribute__((target("ssse3")))
+void convertRowPairSSSE3(const unsigned char *top,
+                         const unsigned char *bottom,
+                         unsigned char *yTop,
+                         unsigned char *yBottom,
+                         unsigned char *u,
+                         unsigned char *v,
+                         int width)
+{
+    const __m128i coeffU = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+    const __m128i coeffV = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i ta = _mm_loadu_si128((const __m128i *)(top + 4*x));
+        __m128i tb = _mm_loadu_si128((const __m128i *)(top + 4*x + 16));
+        __m128i ba = _mm_loadu_si128((const __m128i *)(bottom + 4*x));
+        __m128i bb = _mm_loadu_si128((const __m128i *)(bottom + 4*x + 16));
+
+        __m128i yt = lumaSSSE3(ta, tb);
+        _mm_storel_epi64((__m128i *)(yTop + x), _mm_packus_epi16(yt, yt));
+        if (yBottom)
+        {
+            __m128i yb = lumaSSSE3(ba, bb);
+            _mm_storel_epi64((__m128i *)(yBottom + x), _mm_packus_epi16(yb, yb));
+        }
+
+        __m128i blocks01 = blockSumsSSSE3(ta, ba);
+        __m128i blocks23 = blockSumsSSSE3(tb, bb);
+
+        __m128i uv = _mm_packs_epi32(chromaSSSE3(blocks01, blocks23, coeffU),
+                                     chromaSSSE3(blocks01, blocks23, coeffV));
+        uv = _mm_packus_epi16(uv, uv);
+
+        int uBytes = _mm_cvtsi128_si32(uv);
+        int vBytes = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+        __builtin_memcpy(u + x/2, &uBytes, 4);
+        __builtin_memcpy(v + x/2, &vBytes, 4);
+    }
+
+    convertRowPairScalar(top, bottom, yTop, yBottom, u, v, x, width);
+}
+
+bool haveSSSE3()
+{
+    static const bool have = __builtin_cpu_supports("ssse3");
+    return have;
+}
+
+#endif
+
+}
+
+
+void convertYUV420Flipped(const uint32_t *pixel,
+                          int width,
+                          int height,
+                          unsigned char *y,
+                          unsigned char *u,
+                          unsigned char *v,
+                          bool allowSIMD)
+{
+    const int cw = chromaWidth(width);
+
+#ifdef YUV_CONVERT_X86
+    const bool simd = allowSIMD && haveSSSE3();
+#else
+    (void)allowSIMD;
+#endif
+
+    for (int row = 0; row < height; row += 2)
+    {
+        // Image rows are stored bottom first in the framebuffer.
+        const unsigned char *top =
+            (const unsigned char *)&pixel[(size_t)(height-1-row)*width];
+        bool pair = row + 1 < height;
+        const unsigned char *bottom = pair ?
+            (const unsigned char *)&pixel[(size_t)(height-2-row)*width] : top;
+
+        unsigned char *yTop    = y + (size_t)row * width;
+        unsigned char *yBottom = pair ? yTop + width : nullptr;
+        unsigned char *uRow    = u + (size_t)(row/2) * cw;
+        unsigned char *vRow    = v + (size_t)(row/2) * cw;
+
+#ifdef YUV_CONVERT_X86
+        if (simd)
+        {
+            convertRowPairSSSE3(top, bottom, yTop, yBottom, uRow, vRow, width);
+            continue;
+        }
+#endif
+        convertRowPairScalar(top, bottom, yTop, yBottom, uRow, vRow, 0, width);
+    }
+}
@@ -0,0 +1,31 @@
+//
+// Conversion of OSPRay's RGBA8 framebuffers into planar YUV 4:2:0
+// (BT.601, limited range), as used by Y4M streams and most encoders.
+//
+
+#ifndef OSPRAY_DEMOS_YUV_CONVERT_H
+#define OSPRAY_DEMOS_YUV_CONVERT_H
+
+#include <stdint.h>
+
+//
+// Size of one chroma plane for a width x height image.
+//
+inline int chromaWidth(int width)   { return (width + 1) / 2; }
+inline int chromaHeight(int height) { return (height + 1) / 2; }
+
+//
+// Convert a width x height RGBA8 image (bottom row first) into the
+// planes y (width x height), u and v (chromaWidth x chromaHeight), top
+// row first. Chroma is averaged over each 2x2 block. An SSSE3 kernel
+// is used when the CPU has it unless allowSIMD is false.
+//
+void convertYUV420Flipped(const uint32_t *pixel,
+                          int width,
+                          int height,
+                          unsigned char *y,
+                          unsigned char *u,
+                          unsigned char *v,
+                          bool allowSIMD = true);
+
+#endif
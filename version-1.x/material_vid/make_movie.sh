@@ -1,2 +1,4 @@
 #!/bin/bash
-ffmpeg -framerate 25 -i frames/frame_%d.ppm -c:v libx264 -profile:v high -crf 20 -pix_fmt yuv420p output.mp4
+# Usage: make_movie.sh [frame extension, e.g. png (default ppm)]
+ext=${1:-ppm}
+ffmpeg -framerate 25 -i frames/frame_%d.$ext -c:v libx264 -profile:v high -crf 20 -pix_fmt yuv420p output.mp4
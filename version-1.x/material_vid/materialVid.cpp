@@ -7,42 +7,82 @@
 // Date: Wed Feb 12 10:32:32 MST 2020
 //
 
+#include <algorithm>
 #include <memory>
 #include <random>
-#include <alloca.h>
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 
 #include "ospray_cpp.h"
 
+#include "frameSink.h"
+
+
+//
+// How many passes to accumulate per movie frame. With a variance
+// threshold set, accumulation stops as soon as OSPRay's estimate
+// drops to it (or maxFrames is reached); otherwise a fixed number
+// of passes is rendered.
+//
+struct AccumulationOptions
+{
+    float varianceThreshold = 0.0f;
+    int   fixedFrames       = 10;
+    int   maxFrames         = 64;
+};
+
+
 //
-// Helper function to write the rendered image as PPM file.
-// Taken from opsray examples.
+// Read --adaptive T and --max-samples N from the command line.
 //
-void writePPM(const char *fileName,
-              const osp::vec2i &size,
-              const uint32_t *pixel)
+AccumulationOptions parseAccumulationOptions(int argc, const char **argv)
 {
-    FILE *file = fopen(fileName, "wb");
-    if(file == nullptr) {
-        fprintf(stderr, "fopen('%s', 'wb') failed: %d", fileName, errno);
-        return;
+    AccumulationOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc)
+            options.varianceThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-samples") == 0 && i + 1 < argc)
+            options.maxFrames = std::max(1, atoi(argv[++i]));
     }
-    fprintf(file, "P6\n%i %i\n255\n", size.x, size.y);
-    unsigned char *out = (unsigned char *)alloca(3*size.x);
-    for (int y = 0; y < size.y; y++) {
-        const unsigned char *in = (const unsigned char *)&pixel[(size.y-1-y)*size.x];
-        for (int x = 0; x < size.x; x++) {
-          out[3*x + 0] = in[4*x + 0];
-          out[3*x + 1] = in[4*x + 1];
-          out[3*x + 2] = in[4*x + 2];
-        }
-        fwrite(out, 3*size.x, sizeof(char), file);
+
+    return options;
+}
+
+
+//
+// Accumulate the current frame and return the number of passes
+// rendered. In OSPRay 1.8 ospRenderFrame returns the variance
+// estimate when the framebuffer has a variance channel.
+//
+int accumulateFrame(OSPFrameBuffer framebuffer,
+                    OSPRenderer renderer,
+                    const AccumulationOptions &options,
+                    float &variance)
+{
+    ospFrameBufferClear(framebuffer, OSP_FB_COLOR | OSP_FB_ACCUM);
+
+    if (options.varianceThreshold <= 0.0f)
+    {
+        for (int frames = 0; frames < options.fixedFrames; frames++)
+          ospRenderFrame(framebuffer, renderer, OSP_FB_COLOR | OSP_FB_ACCUM);
+        return options.fixedFrames;
     }
-    fprintf(file, "\n");
-    fclose(file);
+
+    int frames = 0;
+    do
+    {
+        variance = ospRenderFrame(framebuffer, renderer,
+            OSP_FB_COLOR | OSP_FB_ACCUM | OSP_FB_VARIANCE);
+        frames++;
+    } while (variance > options.varianceThreshold && frames < options.maxFrames);
+
+    return frames;
 }
 
 
@@ -55,10 +95,18 @@ void makeMovieFrames(osp::vec3f cam_pos,
                      osp::vec2i imgSize, 
                      OSPRenderer renderer,
                      OSPCamera camera,
+                     FrameSink &sink,
+                     const AccumulationOptions &accumOptions,
                      float stepSize = 1.0)
 {
-    OSPFrameBuffer framebuffer = ospNewFrameBuffer(imgSize, OSP_FB_SRGBA, 
-        OSP_FB_COLOR | /*OSP_FB_DEPTH |*/ OSP_FB_ACCUM);
+    OSPFrameBufferFormat fbFormat =
+        sink.format() == FRAME_RGBA32F ? OSP_FB_RGBA32F : OSP_FB_SRGBA;
+    const bool adaptive = accumOptions.varianceThreshold > 0.0f;
+    uint32_t channels   = OSP_FB_COLOR | /*OSP_FB_DEPTH |*/ OSP_FB_ACCUM;
+    if (adaptive)
+        channels |= OSP_FB_VARIANCE;
+    OSPFrameBuffer framebuffer = ospNewFrameBuffer(imgSize, fbFormat, 
+        channels);
     ospFrameBufferClear(framebuffer, OSP_FB_COLOR | OSP_FB_ACCUM);
 
     float zpos_low  = cam_pos.z;
@@ -67,22 +115,22 @@ void makeMovieFrames(osp::vec3f cam_pos,
     float z_inc     = stepSize;
     int f_idx       = 0;
     int rsqr        = zpos_high * zpos_high;
+    long passes     = 0;
+    float variance  = 0.0f;
 
     while (zpos_cur < zpos_high)
     {
-        char f_name[128];
-        sprintf(f_name, "frames/frame_%i.ppm", f_idx++);
+        int frames = accumulateFrame(framebuffer, renderer, accumOptions, variance);
+        passes    += frames;
 
-        ospFrameBufferClear(framebuffer, OSP_FB_COLOR | OSP_FB_ACCUM);
-        for (int frames = 0; frames < 10; frames++)
-          ospRenderFrame(framebuffer, renderer, OSP_FB_COLOR | OSP_FB_ACCUM);
-
-        uint32_t* fb = (uint32_t*)ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
-        writePPM(f_name, imgSize, fb);
+        const void* fb = ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
+        sink.writeFrame({f_idx++, imgSize.x, imgSize.y, sink.format(), fb});
         ospUnmapFrameBuffer(fb, framebuffer);
 
         zpos_cur += z_inc;
         printf("\nX: %f, Z: %f", cam_pos.x, cam_pos.z);
+        if (adaptive)
+            printf(", frame %i: %i passes, variance %f", f_idx - 1, frames, variance);
 
         cam_pos.z = zpos_cur;
         float xsqr = rsqr - (zpos_cur * zpos_cur);
@@ -103,19 +151,17 @@ void makeMovieFrames(osp::vec3f cam_pos,
 
     while (zpos_cur > zpos_low)
     {
-        char f_name[128];
-        sprintf(f_name, "frames/frame_%i.ppm", f_idx++);
-
-        ospFrameBufferClear(framebuffer, OSP_FB_COLOR | OSP_FB_ACCUM);
-        for (int frames = 0; frames < 10; frames++)
-          ospRenderFrame(framebuffer, renderer, OSP_FB_COLOR | OSP_FB_ACCUM);
+        int frames = accumulateFrame(framebuffer, renderer, accumOptions, variance);
+        passes    += frames;
 
-        uint32_t* fb = (uint32_t*)ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
-        writePPM(f_name, imgSize, fb);
+        const void* fb = ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
+        sink.writeFrame({f_idx++, imgSize.x, imgSize.y, sink.format(), fb});
         ospUnmapFrameBuffer(fb, framebuffer);
 
         zpos_cur -= z_inc;
         printf("\nX: %f, Z: %f", cam_pos.x, cam_pos.z);
+        if (adaptive)
+            printf(", frame %i: %i passes, variance %f", f_idx - 1, frames, variance);
 
         cam_pos.z = zpos_cur;
         float xsqr = rsqr - (zpos_cur * zpos_cur);
@@ -134,6 +180,10 @@ void makeMovieFrames(osp::vec3f cam_pos,
         ospCommit(camera);
     }
 
+    if (adaptive && f_idx > 0)
+        printf("\nAdaptive accumulation: %li passes for %i frames (%.2f per frame)\n",
+               passes, f_idx, (double)passes / f_idx);
+
     ospRelease(framebuffer);
 }
 
@@ -151,6 +201,14 @@ int main(int argc, const char **argv) {
             exit(error);
         });
 
+    FrameSinkOptions sinkOptions = parseFrameSinkOptions(argc, argv);
+    std::unique_ptr<FrameSink> sink =
+        createFrameSink(sinkOptions.spec, sinkOptions.dir);
+    if (!sink)
+        return 1;
+
+    AccumulationOptions accumOptions = parseAccumulationOptions(argc, argv);
+
 
     // image size
     osp::vec2i imgSize;
@@ -265,6 +323,8 @@ int main(int argc, const char **argv) {
                     imgSize, 
                     renderer,
                     camera,
+                    *sink,
+                    accumOptions,
                     .8);
 
     // Final cleanups
@@ -11,7 +11,6 @@
 
 #include <memory>
 #include <random>
-#include <alloca.h>
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
@@ -20,33 +19,7 @@
 #include "ospray/ospray_cpp.h"
 #include "ospcommon/vec.h"
 
-//
-// Helper function to write the rendered image as PPM file.
-// Taken from opsray examples.
-//
-void writePPM(const char *fileName,
-              const osp::vec2i &size,
-              const uint32_t *pixel)
-{
-    FILE *file = fopen(fileName, "wb");
-    if(file == nullptr) {
-        fprintf(stderr, "fopen('%s', 'wb') failed: %d", fileName, errno);
-        return;
-    }
-    fprintf(file, "P6\n%i %i\n255\n", size.x, size.y);
-    unsigned char *out = (unsigned char *)alloca(3*size.x);
-    for (int y = 0; y < size.y; y++) {
-        const unsigned char *in = (const unsigned char *)&pixel[(size.y-1-y)*size.x];
-        for (int x = 0; x < size.x; x++) {
-            out[3*x + 0] = in[4*x + 0];
-            out[3*x + 1] = in[4*x + 1];
-            out[3*x + 2] = in[4*x + 2];
-        }
-        fwrite(out, 3*size.x, sizeof(char), file);
-    }
-    fprintf(file, "\n");
-    fclose(file);
-}
+#include "ppmFile.h"
 
 
 //
@@ -161,7 +134,7 @@ int main(int argc, const char **argv) {
     ospRenderFrame(framebuffer, renderer, OSP_FB_COLOR | OSP_FB_ACCUM);
 
     uint32_t* fb = (uint32_t*)ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
-    writePPM("firstFrameCpp.ppm", imgSize, fb);
+    writePPM("firstFrameCpp.ppm", imgSize.x, imgSize.y, fb);
     ospUnmapFrameBuffer(fb, framebuffer);
 
     // Render 10 more frames, which are accumulated to result in a better 
@@ -172,7 +145,7 @@ int main(int argc, const char **argv) {
     }
 
     fb = (uint32_t*)ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
-    writePPM("accumulatedFrameCpp.ppm", imgSize, fb);
+    writePPM("accumulatedFrameCpp.ppm", imgSize.x, imgSize.y, fb);
     ospUnmapFrameBuffer(fb, framebuffer);
 
     // Final cleanups
@@ -0,0 +1,272 @@
+//
+// The scenes the benchmark harness renders headless.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "benchScenes.h"
+#include "meshReorder.h"
+#include "meshVolume.h"
+#include "volumeGen.h"
+#include "voxelQuantize.h"
+
+namespace {
+
+//
+// The demo scenes themselves, built by the factories their demos use.
+// Nothing is cached, so the keys are thrown away.
+//
+void createTriangles(BenchScene &scene)
+{
+    SceneKey key("triangles");
+    scene.world = newDemoWorld(newTrianglesGroup(key), key);
+    scene.demo  = DEMO_TRIANGLES;
+}
+
+void createMaterialMesh(BenchScene &scene)
+{
+    SceneKey key("material_mesh");
+    scene.world = newDemoWorld(newMaterialMeshGroup(key), key);
+    scene.demo  = DEMO_MATERIAL_MESH;
+}
+
+void createStructuredVolume(BenchScene &scene)
+{
+    // The volume structuredVolume renders without options.
+    static const char *noOptions[] = { "ospray_demos_bench" };
+    scene.source.reset(new VolumeSource(1, noOptions));
+    if (!scene.source->ok())
+        exit(1);
+
+    SceneKey key("structured_volume");
+    scene.opacities = scene.source->opacities(structuredVolumeOpacities());
+    OSPTransferFunction tfn = newDemoTransferFunction(scene.source->valueRange(),
+                                                      scene.opacities, key);
+    OSPGroup group = newStructuredVolumeGroup(scene.source->voxels(), tfn);
+    ospRelease(tfn);
+
+    scene.world = newDemoWorld(group, key);
+    scene.demo  = DEMO_STRUCTURED_VOLUME;
+}
+
+void createUnstructuredVolume(BenchScene &scene)
+{
+    const UnstructuredMesh &cells = demoCells();
+    ospcommon::math::vec2f range = meshValueRange(cells, 0, nullptr);
+
+    SceneKey key("unstructured_volume");
+    scene.world = newDemoWorld(newUnstructuredVolumeGroup(cells, range, key), key);
+    scene.demo  = DEMO_UNSTRUCTURED_VOLUME;
+}
+
+
+//
+// structured_noise_<type>: a 256^3 noise field stored as float, or
+// quantized to 16 or 8 bits, to see what the voxel type does to render
+// time. The transfer function covers the whole value range in each.
+//
+void createNoiseVolume(BenchScene &scene, VoxelType type)
+{
+    const VolumeDims dims {256, 256, 256};
+    scene.storage.resize(dims.count());
+    generateVolume(FIELD_NOISE, dims, scene.storage.data());
+
+    VoxelArray voxels {scene.storage.data(), VOXEL_FLOAT, dims};
+    ospcommon::math::vec2f range;
+    voxelRange(voxels, range[0], range[1]);
+
+    if (type != VOXEL_FLOAT)
+    {
+        VoxelArray output {nullptr, type, dims};
+        scene.quantized.resize(output.bytes());
+        quantizeVoxels(voxels, range[0], range[1], type, scene.quantized.data());
+        std::vector<float>().swap(scene.storage);
+
+        output.voxels = scene.quantized.data();
+        voxels   = output;
+        range[0] = 0.0f;
+        range[1] = quantizedMax(type);
+    }
+
+    // Rendered as the structured_volume demo renders its volume.
+    SceneKey key("structured_noise");
+    OSPTransferFunction tfn = newDemoTransferFunction(range, structuredVolumeOpacities(),
+                                                      key);
+    OSPGroup group = newStructuredVolumeGroup(voxels, tfn);
+    ospRelease(tfn);
+
+    scene.world = newDemoWorld(group, key);
+    scene.demo  = DEMO_STRUCTURED_VOLUME;
+}
+
+void createNoiseFloat(BenchScene &scene)  { createNoiseVolume(scene, VOXEL_FLOAT); }
+void createNoiseUint16(BenchScene &scene) { createNoiseVolume(scene, VOXEL_UINT16); }
+void createNoiseUint8(BenchScene &scene)  { createNoiseVolume(scene, VOXEL_UINT8); }
+
+
+//
+// unstructured_mesh_<order>: a 48^3 grid of hexahedra split into six
+// tetrahedra each, with cells and vertices shuffled the way a
+// partitioned simulation leaves them, or the mesh setBenchMeshFile
+// names, rendered as given and along a Morton and a Hilbert curve to
+// see what cell order does to BVH build time, memory and render time.
+//
+MeshFileOptions benchMeshFile;
+
+uint32_t shuffledIndex(const std::vector<uint32_t> &newVertex, int p, int x, int y, int z)
+{
+    return newVertex[((size_t)z * p + y) * p + x];
+}
+
+void generateShuffledMesh(UnstructuredMesh &mesh)
+{
+    const int n = 48, p = n + 1;
+    const size_t numVertices = (size_t)p * p * p;
+    std::mt19937 random(2020);
+
+    // The noise field at the grid's vertices, each moved to a random place.
+    std::vector<uint32_t> newVertex(numVertices);
+    for (size_t i = 0; i < numVertices; ++i)
+        newVertex[i] = (uint32_t)i;
+    std::shuffle(newVertex.begin(), newVertex.end(), random);
+
+    std::vector<float> field(numVertices);
+    generateVolume(FIELD_NOISE, {(size_t)p, (size_t)p, (size_t)p}, field.data());
+
+    mesh.positions.resize(3 * numVertices);
+    mesh.values.resize(numVertices);
+    for (int z = 0; z < p; ++z)
+        for (int y = 0; y < p; ++y)
+            for (int x = 0; x < p; ++x)
+            {
+                size_t i = shuffledIndex(newVertex, p, x, y, z);
+                mesh.positions[3 * i]     = 2.0f * x / n - 1.0f;
+                mesh.positions[3 * i + 1] = 2.0f * y / n - 1.0f;
+                mesh.positions[3 * i + 2] = 2.0f * z / n - 1.0f;
+                mesh.values[i] = field[((size_t)z * p + y) * p + x];
+            }
+
+    // Six tetrahedra per hexahedron, each along the diagonal from its
+    // lowest to its highest corner, so neighbors share faces.
+    static const int axisOrders[6][3] = {
+        {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+    };
+    std::vector<size_t> cells((size_t)n * n * n);
+    for (size_t i = 0; i < cells.size(); ++i)
+        cells[i] = i;
+    std::shuffle(cells.begin(), cells.end(), random);
+
+    for (size_t cell : cells)
+    {
+        int corner[3] = {(int)(cell % n), (int)(cell / n % n), (int)(cell / n / n)};
+        for (const int *axes : axisOrders)
+        {
+            int at[3] = {corner[0], corner[1], corner[2]};
+            mesh.cellStarts.push_back((uint32_t)mesh.indices.size());
+            mesh.cellTypes.push_back(MESH_TETRAHEDRON);
+            mesh.indices.push_back(shuffledIndex(newVertex, p, at[0], at[1], at[2]));
+            for (int step = 0; step < 3; ++step)
+            {
+                ++at[axes[step]];
+                mesh.indices.push_back(shuffledIndex(newVertex, p, at[0], at[1], at[2]));
+            }
+        }
+    }
+    mesh.fieldName   = "noise";
+    mesh.description = "48^3 hexahedra as shuffled tetrahedra";
+}
+
+//
+// The mesh every unstructured_mesh scene starts from, made once.
+//
+const UnstructuredMesh &benchMesh()
+{
+    static UnstructuredMesh mesh;
+    static bool made = false;
+    if (!made)
+    {
+        if (!benchMeshFile.enabled())
+            generateShuffledMesh(mesh);
+        else if (!readMeshFile(benchMeshFile, mesh))
+            exit(1);
+        made = true;
+    }
+    return mesh;
+}
+
+double residentMB()
+{
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(statm);
+    }
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+void createMeshVolume(BenchScene &scene, MeshOrder order)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    UnstructuredMesh &mesh = scene.mesh;
+    mesh = benchMesh();
+    double reorderSeconds = reorderMesh(mesh, order);
+    fprintf(stderr, "%s: %zu cells, %zu vertices, ordered in %.1f ms\n",
+            mesh.description.c_str(), mesh.cells(), mesh.vertices(),
+            1000.0 * reorderSeconds);
+
+    ospcommon::math::vec2f range = meshValueRange(mesh, 0, nullptr);
+
+    // The BVH over the cells is built on commit.
+    SceneKey key("unstructured_mesh");
+    double startMB = residentMB();
+    Clock::time_point start = Clock::now();
+
+    OSPGroup group = newUnstructuredVolumeGroup(mesh, range, key);
+    scene.world = newDemoWorld(group, key, &mesh);
+
+    scene.buildMillis = std::chrono::duration<double, std::milli>(
+        Clock::now() - start).count();
+    scene.buildMB = residentMB() - startMB;
+
+    // Rendered as the unstructured_volume demo renders a mesh file.
+    scene.demo = DEMO_UNSTRUCTURED_VOLUME;
+}
+
+void createMeshFileOrder(BenchScene &scene) { createMeshVolume(scene, MESH_ORDER_FILE); }
+void createMeshMorton(BenchScene &scene)    { createMeshVolume(scene, MESH_ORDER_MORTON); }
+void createMeshHilbert(BenchScene &scene)   { createMeshVolume(scene, MESH_ORDER_HILBERT); }
+
+}
+
+
+const std::vector<BenchSceneEntry> &benchScenes()
+{
+    static const std::vector<BenchSceneEntry> scenes = {
+        {"triangles",           createTriangles},
+        {"material_mesh",       createMaterialMesh},
+        {"structured_volume",   createStructuredVolume},
+        {"unstructured_volume", createUnstructuredVolume},
+        {"structured_noise_float",  createNoiseFloat},
+        {"structured_noise_uint16", createNoiseUint16},
+        {"structured_noise_uint8",  createNoiseUint8},
+        {"unstructured_mesh",         createMeshFileOrder},
+        {"unstructured_mesh_morton",  createMeshMorton},
+        {"unstructured_mesh_hilbert", createMeshHilbert},
+    };
+    return scenes;
+}
+
+
+void setBenchMeshFile(const MeshFileOptions &options)
+{
+    benchMeshFile = options;
+}
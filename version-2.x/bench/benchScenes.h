@@ -0,0 +1,80 @@
+//
+// The scenes the benchmark harness renders headless: the version 2.x
+// demo scenes, and larger volumes and meshes built the same way. All
+// code is written using OSPRay's C interface.
+//
+
+#ifndef OSPRAY_DEMOS_BENCH_SCENES_H
+#define OSPRAY_DEMOS_BENCH_SCENES_H
+
+#include <memory>
+#include <vector>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "demoScenes.h"
+#include "meshFile.h"
+#include "volumeSource.h"
+
+//
+// A committed world, built by the demo scene factories (see
+// demoScenes.h), and the demo whose camera and renderer settings go
+// with it. The world shares arrays held below, so the scene must
+// outlive any rendering of it. release() drops the world.
+//
+struct BenchScene
+{
+    OSPWorld  world;
+    DemoScene demo;
+
+    // The structured_volume demo's default volume, and the opacities
+    // its transfer function shares.
+    std::unique_ptr<VolumeSource> source;
+    std::vector<float>            opacities;
+
+    std::vector<float> storage;
+
+    // Quantized voxels, for the scenes that use them.
+    std::vector<unsigned char> quantized;
+
+    // The unstructured mesh, for the scenes that use one.
+    UnstructuredMesh mesh;
+
+    // Milliseconds committing the volume and world, which builds the
+    // BVH, and how many megabytes resident memory grew meanwhile, for
+    // the scenes that measure it; 0 otherwise.
+    double buildMillis;
+    double buildMB;
+
+    void release()
+    {
+        if (world)
+            ospRelease(world);
+        world = nullptr;
+    }
+};
+
+typedef void (*BenchSceneFactory)(BenchScene &scene);
+
+struct BenchSceneEntry
+{
+    const char       *name;
+    BenchSceneFactory create;
+};
+
+//
+// Every scene, in the order they are benchmarked: triangles,
+// material_mesh, structured_volume, unstructured_volume, the
+// structured_noise_float, _uint16 and _uint8 voxel type comparison and
+// the unstructured_mesh, _morton and _hilbert cell order comparison.
+//
+const std::vector<BenchSceneEntry> &benchScenes();
+
+//
+// Have the unstructured_mesh scenes render this mesh file rather than
+// their generated one. Call before the first of them is created.
+//
+void setBenchMeshFile(const MeshFileOptions &options);
+
+#endif
@@ -0,0 +1,279 @@
+//
+// Headless benchmark of the version 2.x demo scenes. Every scene is
+// rendered reps times after some warm-up frames, and the throughput
+// (Mpixels/s, samples/s) and frame time statistics are reported as
+// JSON so runs can be compared across OSPRay versions and machines.
+//
+//   --scene NAME       only run this scene (default: all of them)
+//   --size WxH         image size (default 1024x768)
+//   --spp N            pixelSamples per frame (default 1)
+//   --renderer TYPE    renderer to use (default: the scene's own)
+//   --reps N           timed frames per scene (default 20)
+//   --warmup N         untimed frames rendered first (default 3)
+//   --json FILE        write the report to FILE instead of stdout
+//   --mesh FILE        render this .vtu or .vtk in the unstructured_mesh
+//                      scenes instead of their generated mesh
+//   --mesh-field NAME  the mesh's point or cell array to render
+//
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "benchScenes.h"
+#include "qualityController.h"
+#include "sceneKey.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions
+{
+    std::string scene;
+    int         width    = 1024;
+    int         height   = 768;
+    int         spp      = 1;
+    std::string renderer;
+    int         reps     = 20;
+    int         warmup   = 3;
+    std::string jsonFile;
+    MeshFileOptions mesh;
+};
+
+bool parseBenchOptions(int argc, const char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--scene") == 0 && hasValue)
+            options.scene = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && hasValue)
+        {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0)
+            {
+                fprintf(stderr, "Bad --size '%s', expected WxH\n", argv[i]);
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "--spp") == 0 && hasValue)
+            options.spp = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--renderer") == 0 && hasValue)
+            options.renderer = argv[++i];
+        else if (strcmp(argv[i], "--reps") == 0 && hasValue)
+            options.reps = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+            options.warmup = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--json") == 0 && hasValue)
+            options.jsonFile = argv[++i];
+        else if (strcmp(argv[i], "--mesh") == 0 && hasValue)
+            options.mesh.fileName = argv[++i];
+        else if (strcmp(argv[i], "--mesh-field") == 0 && hasValue)
+            options.mesh.fieldName = argv[++i];
+        else
+        {
+            fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct SceneResult
+{
+    std::string         scene;
+    std::string         renderer;
+    std::vector<double> frameMillis;
+    double              buildMillis;
+    double              buildMB;
+};
+
+//
+// Nearest-rank percentile of sorted values.
+//
+double percentile(const std::vector<double> &sorted, double p)
+{
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+SceneResult runScene(const BenchSceneEntry &entry, const BenchOptions &options)
+{
+    BenchScene scene = {};
+    entry.create(scene);
+
+    SceneResult result;
+    result.scene    = entry.name;
+    result.renderer = options.renderer.empty() ? demoRendererType(scene.demo)
+                                               : options.renderer;
+    result.buildMillis = scene.buildMillis;
+    result.buildMB     = scene.buildMB;
+
+    OSPCamera camera = ospNewCamera("perspective");
+    ospSetFloat(camera, "aspect", ((float) options.width) / ((float) options.height));
+    // Looking at the origin from where the demo does.
+    ospcommon::math::vec3f camPos  = demoCameraPosition(scene.demo);
+    ospcommon::math::vec3f camView { -camPos.x, -camPos.y, -camPos.z };
+    ospcommon::math::vec3f camUp   { 0.f, 1.f, 0.f };
+    ospSetParam(camera, "position", OSP_VEC3F, camPos);
+    ospSetParam(camera, "direction", OSP_VEC3F, camView);
+    ospSetParam(camera, "up", OSP_VEC3F, camUp);
+    ospCommit(camera);
+
+    // The demo's own renderer settings only make sense for its renderer.
+    OSPRenderer renderer = ospNewRenderer(result.renderer.c_str());
+    if (result.renderer == demoRendererType(scene.demo))
+    {
+        SceneKey key(entry.name);
+        QualityController quality(renderer, QualityOptions());
+        setDemoRendererParams(scene.demo, renderer, quality, key);
+    }
+    ospSetInt(renderer, "pixelSamples", options.spp);
+    ospCommit(renderer);
+
+    OSPFrameBuffer framebuffer = ospNewFrameBuffer(options.width, options.height,
+        OSP_FB_SRGBA, OSP_FB_COLOR);
+
+    // Every frame starts from scratch, so the frames measure the same
+    // work no matter how many came before.
+    for (int i = 0; i < options.warmup + options.reps; ++i)
+    {
+        ospResetAccumulation(framebuffer);
+
+        Clock::time_point start = Clock::now();
+        ospRenderFrameBlocking(framebuffer, renderer, camera, scene.world);
+        double millis = std::chrono::duration<double, std::milli>(
+            Clock::now() - start).count();
+
+        if (i >= options.warmup)
+            result.frameMillis.push_back(millis);
+    }
+
+    ospRelease(framebuffer);
+    ospRelease(renderer);
+    ospRelease(camera);
+    scene.release();
+
+    return result;
+}
+
+void writeReport(FILE *out,
+                 const BenchOptions &options,
+                 const std::vector<SceneResult> &results)
+{
+    const double pixels = (double)options.width * options.height;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", options.width, options.height);
+    fprintf(out, "  \"spp\": %d,\n  \"reps\": %d,\n  \"warmup\": %d,\n",
+            options.spp, options.reps, options.warmup);
+    fprintf(out, "  \"scenes\": [");
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SceneResult &result = results[i];
+
+        std::vector<double> sorted = result.frameMillis;
+        std::sort(sorted.begin(), sorted.end());
+
+        double totalMillis = 0.0;
+        for (double millis : sorted)
+            totalMillis += millis;
+        double meanMillis = totalMillis / sorted.size();
+
+        double framesPerSecond = 1000.0 / meanMillis;
+        double mpixPerSecond   = pixels * framesPerSecond / 1e6;
+        double samplesPerSecond = pixels * options.spp * framesPerSecond;
+
+        fprintf(out, "%s\n    {\n", i ? "," : "");
+        fprintf(out, "      \"scene\": \"%s\",\n", result.scene.c_str());
+        fprintf(out, "      \"renderer\": \"%s\",\n", result.renderer.c_str());
+        fprintf(out, "      \"frames_per_s\": %.4f,\n", framesPerSecond);
+        fprintf(out, "      \"mpix_per_s\": %.4f,\n", mpixPerSecond);
+        fprintf(out, "      \"samples_per_s\": %.1f,\n", samplesPerSecond);
+        if (result.buildMillis > 0.0)
+            fprintf(out, "      \"build_ms\": %.4f,\n      \"build_rss_mb\": %.1f,\n",
+                    result.buildMillis, result.buildMB);
+        fprintf(out, "      \"frame_ms\": {\"min\": %.4f, \"mean\": %.4f, "
+                "\"median\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}\n",
+                sorted.front(), meanMillis, percentile(sorted, 50.0),
+                percentile(sorted, 95.0), percentile(sorted, 99.0), sorted.back());
+        fprintf(out, "    }");
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+}
+
+}
+
+
+int main(int argc, const char **argv)
+{
+    OSPError initError = ospInit(&argc, argv);
+    if (initError != OSP_NO_ERROR)
+        return initError;
+
+    ospDeviceSetErrorFunc(
+        ospGetCurrentDevice(), [](OSPError error, const char *errorDetails) {
+            std::cerr << "OSPRay error: " << errorDetails << std::endl;
+            exit(error);
+        });
+
+    BenchOptions options;
+    if (!parseBenchOptions(argc, argv, options))
+        return 1;
+    if (options.mesh.enabled())
+        setBenchMeshFile(options.mesh);
+
+    std::vector<SceneResult> results;
+    for (const BenchSceneEntry &entry : benchScenes())
+    {
+        if (!options.scene.empty() && options.scene != entry.name)
+            continue;
+
+        fprintf(stderr, "Benchmarking %s\n", entry.name);
+        results.push_back(runScene(entry, options));
+    }
+
+    if (results.empty())
+    {
+        fprintf(stderr, "Unknown scene '%s'. Scenes are:", options.scene.c_str());
+        for (const BenchSceneEntry &entry : benchScenes())
+            fprintf(stderr, " %s", entry.name);
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (!options.jsonFile.empty())
+    {
+        out = fopen(options.jsonFile.c_str(), "w");
+        if (out == nullptr)
+        {
+            fprintf(stderr, "fopen('%s', 'w') failed: %d\n",
+                    options.jsonFile.c_str(), errno);
+            return 1;
+        }
+    }
+
+    writeReport(out, options, results);
+
+    if (out != stdout)
+        fclose(out);
+
+    ospShutdown();
+
+    return 0;
+}
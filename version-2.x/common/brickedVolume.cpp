@@ -0,0 +1,391 @@
+//
+// Out-of-core structured volumes.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "brickedVolume.h"
+#include "parallelFor.h"
+#include "startupProfiler.h"
+#include "volumeSource.h"
+
+BrickOptions parseBrickOptions(int argc, const char **argv)
+{
+    BrickOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--bricks") == 0 && i + 1 < argc)
+            options.brickSize = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--brick-budget") == 0 && i + 1 < argc)
+            options.budgetMB = std::max(0.0, atof(argv[++i]));
+        else if (strcmp(argv[i], "--skip-empty") == 0)
+            options.skipEmpty = true;
+    }
+
+    return options;
+}
+
+
+namespace {
+
+typedef ospcommon::math::vec3f vec3f;
+
+const double MB = 1024.0 * 1024.0;
+
+float dot(const vec3f &a, const vec3f &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+vec3f cross(const vec3f &a, const vec3f &b)
+{
+    return vec3f { a.y * b.z - a.z * b.y,
+                   a.z * b.x - a.x * b.z,
+                   a.x * b.y - a.y * b.x };
+}
+
+vec3f normalized(const vec3f &v)
+{
+    float length = sqrtf(dot(v, v));
+    return length > 0.0f ? vec3f { v.x / length, v.y / length, v.z / length } : v;
+}
+
+vec3f scaled(const vec3f &v, float s)
+{
+    return vec3f { v.x * s, v.y * s, v.z * s };
+}
+
+vec3f sum(const vec3f &a, const vec3f &b)
+{
+    return vec3f { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+//
+// The half-spaces, through the eye, that bound a perspective camera's
+// view: in front of it, and inside its four sides. A point p is in view
+// when dot(normal, p - eye) >= 0 for every normal.
+//
+struct Frustum
+{
+    vec3f eye;
+    vec3f normals[5];
+
+    //
+    // Whether any part of the box [lower, upper] may be in view. Boxes
+    // near the frustum's edges can pass without being seen, never the
+    // other way round.
+    //
+    bool overlaps(const vec3f &lower, const vec3f &upper) const
+    {
+        for (const vec3f &n : normals)
+        {
+            // The corner furthest along the normal.
+            vec3f corner { n.x >= 0.0f ? upper.x : lower.x,
+                           n.y >= 0.0f ? upper.y : lower.y,
+                           n.z >= 0.0f ? upper.z : lower.z };
+            if (dot(n, vec3f { corner.x - eye.x,
+                               corner.y - eye.y,
+                               corner.z - eye.z }) < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+Frustum viewFrustum(const CameraPose &pose, const vec3f &camUp, float fovy,
+                    float aspect)
+{
+    vec3f forward = normalized(pose.direction);
+    vec3f right   = normalized(cross(forward, camUp));
+    vec3f up      = cross(right, forward);
+
+    float tanY = tanf(0.5f * fovy * (float)M_PI / 180.0f);
+    float tanX = tanY * aspect;
+
+    Frustum frustum;
+    frustum.eye        = pose.position;
+    frustum.normals[0] = forward;
+    frustum.normals[1] = sum(scaled(forward, tanX), scaled(right, -1.0f));
+    frustum.normals[2] = sum(scaled(forward, tanX), right);
+    frustum.normals[3] = sum(scaled(forward, tanY), scaled(up, -1.0f));
+    frustum.normals[4] = sum(scaled(forward, tanY), up);
+    return frustum;
+}
+
+}
+
+
+BrickedVolume::BrickedVolume(const VoxelArray &source,
+                             ospcommon::math::vec3f spacing,
+                             ospcommon::math::vec3f origin,
+                             OSPTransferFunction tfn,
+                             const OpacityTransfer &transfer,
+                             const BrickOptions &options)
+    : source(source),
+      spacing(spacing),
+      origin(origin),
+      tfn(tfn),
+      options(options),
+      budget((size_t)(options.budgetMB * MB)),
+      bricksGroup(ospNewGroup()),
+      frame(0),
+      residentBytes(0),
+      peakBytes(0),
+      loads(0),
+      loadedBytes(0),
+      loadSeconds(0.0),
+      evictions(0),
+      warnedBudget(false),
+      emptyBricks(0),
+      emptyBytes(0)
+{
+    ospRetain(tfn);
+    profiledCommit(bricksGroup);
+
+    std::vector<VolumeBrick> layout = brickLayout(source.dims, options.brickSize);
+    bricks.resize(layout.size());
+    for (size_t i = 0; i < layout.size(); ++i)
+    {
+        Brick &brick   = bricks[i];
+        brick.layout   = layout[i];
+        brick.bytes    = layout[i].bytes(source.type);
+        brick.empty    = false;
+        brick.model    = nullptr;
+        brick.lastUsed = 0;
+
+        const VolumeDims &begin = layout[i].begin;
+        const VolumeDims &dims  = layout[i].dims;
+        brick.lower = vec3f { origin.x + spacing.x * begin.x,
+                              origin.y + spacing.y * begin.y,
+                              origin.z + spacing.z * begin.z };
+        brick.upper = vec3f { brick.lower.x + spacing.x * (dims.x - 1),
+                              brick.lower.y + spacing.y * (dims.y - 1),
+                              brick.lower.z + spacing.z * (dims.z - 1) };
+    }
+
+    printf("Bricked %zux%zux%zu voxels into %zu bricks of up to %d^3 cells, "
+           "%.1f MB budget\n",
+           source.dims.x, source.dims.y, source.dims.z, bricks.size(),
+           options.brickSize, options.budgetMB);
+
+    if (options.skipEmpty)
+    {
+        // Macrocells the size of the bricks give each brick's range
+        // from one cell.
+        MacrocellGrid grid(source, options.brickSize);
+        for (Brick &brick : bricks)
+        {
+            brick.empty = !grid.brickVisible(brick.layout, transfer);
+            if (brick.empty)
+            {
+                ++emptyBricks;
+                emptyBytes += brick.bytes;
+            }
+        }
+
+        printf("Skipping %zu of %zu bricks (%.1f MB) the transfer function makes "
+               "fully transparent; min/max grid took %.3f s\n",
+               emptyBricks, bricks.size(), emptyBytes / MB, grid.buildSeconds());
+    }
+}
+
+
+BrickedVolume::~BrickedVolume()
+{
+    ospRelease(bricksGroup);
+    for (Brick &brick : bricks)
+        if (brick.model)
+            ospRelease(brick.model);
+    ospRelease(tfn);
+}
+
+
+bool BrickedVolume::update(const CameraPose &pose,
+                           ospcommon::math::vec3f camUp,
+                           float fovy,
+                           float aspect)
+{
+    ++frame;
+    retired.clear();
+
+    // The bricks in view, nearest first.
+    Frustum frustum = viewFrustum(pose, camUp, fovy, aspect);
+    std::vector<std::pair<float, size_t>> visible;
+    for (size_t i = 0; i < bricks.size(); ++i)
+    {
+        const Brick &brick = bricks[i];
+        if (brick.empty || !frustum.overlaps(brick.lower, brick.upper))
+            continue;
+
+        vec3f toCenter { 0.5f * (brick.lower.x + brick.upper.x) - pose.position.x,
+                         0.5f * (brick.lower.y + brick.upper.y) - pose.position.y,
+                         0.5f * (brick.lower.z + brick.upper.z) - pose.position.z };
+        visible.push_back({dot(toCenter, toCenter), i});
+    }
+    std::sort(visible.begin(), visible.end());
+
+    // As many as fit in the budget.
+    std::vector<size_t> wanted;
+    std::vector<size_t> missing;
+    size_t wantedBytes = 0;
+    size_t missingBytes = 0;
+    for (const std::pair<float, size_t> &v : visible)
+    {
+        Brick &brick = bricks[v.second];
+        if (wantedBytes + brick.bytes > budget)
+            break;
+
+        wantedBytes += brick.bytes;
+        brick.lastUsed = frame;
+        wanted.push_back(v.second);
+        if (!brick.voxels)
+        {
+            missing.push_back(v.second);
+            missingBytes += brick.bytes;
+        }
+    }
+
+    if (wanted.size() < visible.size() && !warnedBudget)
+    {
+        fprintf(stderr, "Brick budget of %.1f MB holds only %zu of the %zu bricks "
+                "in view; the rest are left out\n",
+                options.budgetMB, wanted.size(), visible.size());
+        warnedBudget = true;
+    }
+
+    // Make room by evicting the least recently used bricks out of view.
+    if (residentBytes + missingBytes > budget)
+    {
+        std::vector<std::pair<uint64_t, size_t>> idle;
+        for (size_t i = 0; i < bricks.size(); ++i)
+            if (bricks[i].voxels && bricks[i].lastUsed != frame)
+                idle.push_back({bricks[i].lastUsed, i});
+        std::sort(idle.begin(), idle.end());
+
+        for (size_t i = 0; i < idle.size() &&
+                           residentBytes + missingBytes > budget; ++i)
+            evict(idle[i].second);
+    }
+
+    load(missing);
+
+    std::sort(wanted.begin(), wanted.end());
+    if (wanted == inGroup)
+        return false;
+
+    if (wanted.empty())
+    {
+        ospRemoveParam(bricksGroup, "volume");
+    }
+    else
+    {
+        std::vector<OSPVolumetricModel> models;
+        for (size_t i : wanted)
+            models.push_back(bricks[i].model);
+
+        OSPData shared = profiledSharedData1D(models.data(), OSP_VOLUMETRIC_MODEL,
+                                              models.size());
+        OSPData copied = ospNewData(OSP_VOLUMETRIC_MODEL, models.size());
+        ospCopyData(shared, copied);
+        ospRelease(shared);
+
+        profiledCommit(copied);
+        ospSetParam(bricksGroup, "volume", OSP_DATA, &copied);
+        ospRelease(copied);
+    }
+    profiledCommit(bricksGroup);
+
+    inGroup.swap(wanted);
+    return true;
+}
+
+
+void BrickedVolume::load(const std::vector<size_t> &indices)
+{
+    if (indices.empty())
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Copying is the part that reads the disk, so bricks are copied on
+    // several threads; the OSPRay objects are made afterwards.
+    for (size_t i : indices)
+        bricks[i].voxels.reset(new unsigned char[bricks[i].bytes]);
+
+    parallelChunks(indices.size(),
+        [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                Brick &brick = bricks[indices[i]];
+                copyBrick(source, brick.layout, brick.voxels.get());
+            }
+        });
+
+    for (size_t i : indices)
+    {
+        Brick &brick = bricks[i];
+        const VolumeDims &begin = brick.layout.begin;
+        const VolumeDims &dims  = brick.layout.dims;
+
+        OSPVolume volume = ospNewVolume("structuredRegular");
+
+        OSPData voxelData = profiledSharedData3D(brick.voxels.get(),
+            ospVoxelType(source.type), dims.x, dims.y, dims.z);
+        profiledCommit(voxelData);
+        ospSetParam(volume, "data", OSP_DATA, &voxelData);
+        ospRelease(voxelData);
+
+        vec3f brickOrigin { origin.x + spacing.x * begin.x,
+                            origin.y + spacing.y * begin.y,
+                            origin.z + spacing.z * begin.z };
+        ospSetParam(volume, "gridSpacing", OSP_VEC3F, spacing);
+        ospSetParam(volume, "gridOrigin", OSP_VEC3F, brickOrigin);
+        profiledCommit(volume);
+
+        brick.model = ospNewVolumetricModel(volume);
+        ospSetObject(brick.model, "transferFunction", tfn);
+        profiledCommit(brick.model);
+        ospRelease(volume);
+
+        residentBytes += brick.bytes;
+        loadedBytes   += brick.bytes;
+        ++loads;
+    }
+
+    peakBytes = std::max(peakBytes, residentBytes);
+    loadSeconds += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+
+void BrickedVolume::evict(size_t index)
+{
+    Brick &brick = bricks[index];
+
+    ospRelease(brick.model);
+    brick.model = nullptr;
+    retired.push_back(std::move(brick.voxels));
+
+    residentBytes -= brick.bytes;
+    ++evictions;
+}
+
+
+void BrickedVolume::printSummary() const
+{
+    printf("\nBricks: %zu loads (%.1f MB in %.2f s), %zu evictions, "
+           "peak %.1f MB resident of a %.1f MB budget, volume %.1f MB\n",
+           loads, loadedBytes / MB, loadSeconds, evictions,
+           peakBytes / MB, options.budgetMB, source.bytes() / MB);
+
+    if (options.skipEmpty)
+        printf("Empty space: %zu fully transparent bricks (%.1f MB) never loaded\n",
+               emptyBricks, emptyBytes / MB);
+}
@@ -0,0 +1,164 @@
+//
+// Out-of-core structured volumes. The volume is split into bricks (see
+// volumeBricks.h), each rendered as its own structuredRegular volume in
+// one group, and only the bricks in view of the camera are kept in
+// memory. Bricks are copied out of the source voxels, usually a mapped
+// file (see volumeFile.h), when they come into view, and the least
+// recently used ones are dropped when the memory budget runs out. The
+// file's own pages are clean and the kernel reclaims them as needed,
+// so a volume several times larger than memory can be orbited.
+//
+// With --skip-empty, a min/max macrocell grid (see macrocellGrid.h) is
+// built first, and bricks whose every value the transfer function
+// makes fully transparent are never loaded or handed to OSPRay.
+//
+
+#ifndef OSPRAY_DEMOS_BRICKED_VOLUME_H
+#define OSPRAY_DEMOS_BRICKED_VOLUME_H
+
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "cameraPath.h"
+#include "macrocellGrid.h"
+#include "volumeBricks.h"
+
+struct BrickOptions
+{
+    // Cells along each side of a brick. Zero renders the volume whole.
+    int brickSize;
+
+    // Memory resident bricks may take, in megabytes.
+    double budgetMB;
+
+    // Leave out bricks the transfer function makes fully transparent.
+    bool skipEmpty;
+
+    BrickOptions()
+        : brickSize(0),
+          budgetMB(1024.0),
+          skipEmpty(false)
+    {}
+
+    bool enabled() const { return brickSize > 0; }
+};
+
+//
+// Read bricking options from the command line.
+//
+//   --bricks N             split the volume into bricks of N^3 cells and
+//                          load only the ones in view
+//   --brick-budget MB      memory for resident bricks (default 1024)
+//   --skip-empty           never load bricks that are fully transparent
+//
+// --bricks can't be combined with --voxel-type (see volumeSource.h):
+// quantizing makes a copy of the whole volume in memory, which is what
+// loading bricks on demand avoids.
+//
+BrickOptions parseBrickOptions(int argc, const char **argv);
+
+class BrickedVolume
+{
+  public:
+    //
+    // Lay out bricks over source, which must outlive this object, on
+    // the grid given by spacing and origin. Every brick is rendered
+    // with tfn, whose opacities are given in transfer for skipping
+    // empty bricks. Nothing is loaded until the first update.
+    //
+    BrickedVolume(const VoxelArray &source,
+                  ospcommon::math::vec3f spacing,
+                  ospcommon::math::vec3f origin,
+                  OSPTransferFunction tfn,
+                  const OpacityTransfer &transfer,
+                  const BrickOptions &options);
+    ~BrickedVolume();
+
+    BrickedVolume(const BrickedVolume &) = delete;
+    BrickedVolume &operator=(const BrickedVolume &) = delete;
+
+    //
+    // The group holding the bricks of the current view. Put it in an
+    // instance once; update changes what it holds.
+    //
+    OSPGroup group() const { return bricksGroup; }
+
+    //
+    // Make the group hold exactly the bricks seen by a perspective
+    // camera at pose, loading the missing ones nearest first and
+    // evicting least recently used bricks out of view to stay within
+    // the budget. Visible bricks that don't fit are left out, with a
+    // warning. Returns true if the group changed, in which case the
+    // world holding it must be committed before rendering.
+    //
+    // Must not be called while a frame using the group renders.
+    //
+    bool update(const CameraPose &pose,
+                ospcommon::math::vec3f camUp,
+                float fovy,
+                float aspect);
+
+    //
+    // Print how many bricks were loaded and evicted, how long loading
+    // took, the most memory the bricks held, and what skipping empty
+    // bricks saved.
+    //
+    void printSummary() const;
+
+  private:
+    struct Brick
+    {
+        VolumeBrick layout;
+        size_t      bytes;
+
+        // Fully transparent, so never loaded.
+        bool        empty;
+
+        ospcommon::math::vec3f lower;
+        ospcommon::math::vec3f upper;
+
+        // Set while resident.
+        std::unique_ptr<unsigned char[]> voxels;
+        OSPVolumetricModel               model;
+        uint64_t                         lastUsed;
+    };
+
+    void load(const std::vector<size_t> &indices);
+    void evict(size_t index);
+
+    VoxelArray             source;
+    ospcommon::math::vec3f spacing;
+    ospcommon::math::vec3f origin;
+    OSPTransferFunction    tfn;
+    BrickOptions           options;
+    size_t                 budget;
+
+    std::vector<Brick> bricks;
+    OSPGroup           bricksGroup;
+
+    // The bricks the group holds, in order.
+    std::vector<size_t> inGroup;
+
+    // Voxels of bricks evicted by the last update. OSPRay may still
+    // reference them until the world is committed, so they are freed
+    // by the next update instead.
+    std::vector<std::unique_ptr<unsigned char[]>> retired;
+
+    uint64_t frame;
+    size_t   residentBytes;
+    size_t   peakBytes;
+    size_t   loads;
+    size_t   loadedBytes;
+    double   loadSeconds;
+    size_t   evictions;
+    bool     warnedBudget;
+    size_t   emptyBricks;
+    size_t   emptyBytes;
+};
+
+#endif
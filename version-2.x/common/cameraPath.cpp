@@ -0,0 +1,257 @@
+//
+// Camera paths for the movie demos.
+//
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cameraPath.h"
+
+namespace {
+
+typedef ospcommon::math::vec3f vec3f;
+
+//
+// Place the camera on the orbit at zposCur. The side of the orbit is
+// given by xSign.
+//
+void orbitPose(float zposCur,
+               int rSqr,
+               float xSign,
+               const vec3f &objCent,
+               vec3f &camPos,
+               vec3f &camView)
+{
+    camPos.z = zposCur;
+    float xsqr = rSqr - (zposCur * zposCur);
+
+    if (xsqr <= 0.0)
+        camPos.x = 0.0;
+    else
+        camPos.x = xSign * sqrt(xsqr);
+
+    camView.x = objCent.x - camPos.x;
+    camView.y = objCent.y - camPos.y;
+    camView.z = objCent.z - camPos.z;
+}
+
+//
+// Catmull-Rom interpolation between p1 and p2 at t in [0, 1].
+//
+float catmullRom(float p0, float p1, float p2, float p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * (2.0f * p1 +
+                   (p2 - p0) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+vec3f catmullRom(const vec3f &p0, const vec3f &p1, const vec3f &p2,
+                 const vec3f &p3, float t)
+{
+    return vec3f { catmullRom(p0.x, p1.x, p2.x, p3.x, t),
+                   catmullRom(p0.y, p1.y, p2.y, p3.y, t),
+                   catmullRom(p0.z, p1.z, p2.z, p3.z, t) };
+}
+
+vec3f lerp(const vec3f &a, const vec3f &b, float t)
+{
+    return vec3f { a.x + (b.x - a.x) * t,
+                   a.y + (b.y - a.y) * t,
+                   a.z + (b.z - a.z) * t };
+}
+
+vec3f offsetFrom(const CameraKeyframe &key)
+{
+    return vec3f { key.position.x - key.target.x,
+                   key.position.y - key.target.y,
+                   key.position.z - key.target.z };
+}
+
+//
+// The offset from a target an orbit reaches at t in [0, 1] from a to
+// b: the angle around the y axis, the distance from it and the height
+// each change evenly, the angle by less than half a turn.
+//
+vec3f orbitLerp(const vec3f &a, const vec3f &b, float t)
+{
+    float angleA = atan2f(a.x, a.z);
+    float turn   = atan2f(b.x, b.z) - angleA;
+    if (turn > (float)M_PI)
+        turn -= 2.0f * (float)M_PI;
+    else if (turn <= -(float)M_PI)
+        turn += 2.0f * (float)M_PI;
+
+    float angle  = angleA + turn * t;
+    float radius = hypotf(a.x, a.z) + (hypotf(b.x, b.z) - hypotf(a.x, a.z)) * t;
+    return vec3f { radius * sinf(angle), a.y + (b.y - a.y) * t, radius * cosf(angle) };
+}
+
+//
+// The path type a path file's "type" line names.
+//
+bool parsePathType(const char *name, CameraPathType &type)
+{
+    if (strcmp(name, "spline") == 0)
+        type = CAMERA_PATH_SPLINE;
+    else if (strcmp(name, "dolly") == 0)
+        type = CAMERA_PATH_DOLLY;
+    else if (strcmp(name, "orbit") == 0)
+        type = CAMERA_PATH_ORBIT;
+    else
+        return false;
+    return true;
+}
+
+CameraPose lookAt(const vec3f &position, const vec3f &target)
+{
+    return { position, vec3f { target.x - position.x,
+                               target.y - position.y,
+                               target.z - position.z } };
+}
+
+}
+
+
+std::vector<CameraPose> orbitPath(vec3f camPos,
+                                  vec3f camView,
+                                  const vec3f &objCent,
+                                  float stepSize)
+{
+    std::vector<CameraPose> poses;
+
+    float zposLow  = camPos.z;
+    float zposHigh = -1.0 * zposLow;
+    float zposCur  = zposLow;
+    float zInc     = stepSize;
+    int rSqr       = zposHigh * zposHigh;
+
+    while (zposCur < zposHigh)
+    {
+        poses.push_back({camPos, camView});
+        zposCur += zInc;
+        orbitPose(zposCur, rSqr, 1.0, objCent, camPos, camView);
+    }
+
+    while (zposCur > zposLow)
+    {
+        poses.push_back({camPos, camView});
+        zposCur -= zInc;
+        orbitPose(zposCur, rSqr, -1.0, objCent, camPos, camView);
+    }
+
+    return poses;
+}
+
+
+std::vector<CameraPose> keyframePath(const std::vector<CameraKeyframe> &keys,
+                                     CameraPathType type,
+                                     int framesPerSegment)
+{
+    std::vector<CameraPose> poses;
+    if (keys.empty())
+        return poses;
+
+    framesPerSegment = std::max(1, framesPerSegment);
+    const int last = (int)keys.size() - 1;
+    poses.reserve((size_t)last * framesPerSegment + 1);
+
+    for (int seg = 0; seg < last; ++seg)
+    {
+        // The spline through the end keys uses them as their own
+        // outer neighbours.
+        const CameraKeyframe &k0 = keys[std::max(seg - 1, 0)];
+        const CameraKeyframe &k1 = keys[seg];
+        const CameraKeyframe &k2 = keys[seg + 1];
+        const CameraKeyframe &k3 = keys[std::min(seg + 2, last)];
+
+        for (int f = 0; f < framesPerSegment; ++f)
+        {
+            float t = (float)f / framesPerSegment;
+
+            if (type == CAMERA_PATH_SPLINE)
+                poses.push_back(lookAt(
+                    catmullRom(k0.position, k1.position, k2.position, k3.position, t),
+                    catmullRom(k0.target, k1.target, k2.target, k3.target, t)));
+            else if (type == CAMERA_PATH_ORBIT)
+            {
+                vec3f target = lerp(k1.target, k2.target, t);
+                vec3f offset = orbitLerp(offsetFrom(k1), offsetFrom(k2), t);
+                poses.push_back(lookAt(vec3f { target.x + offset.x,
+                                               target.y + offset.y,
+                                               target.z + offset.z }, target));
+            }
+            else
+                poses.push_back(lookAt(lerp(k1.position, k2.position, t),
+                                       lerp(k1.target, k2.target, t)));
+        }
+    }
+
+    poses.push_back(lookAt(keys[last].position, keys[last].target));
+    return poses;
+}
+
+
+bool loadCameraPath(const std::string &fileName, std::vector<CameraPose> &poses)
+{
+    FILE *file = fopen(fileName.c_str(), "r");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "fopen('%s', 'r') failed: %d\n", fileName.c_str(), errno);
+        return false;
+    }
+
+    std::vector<CameraKeyframe> keys;
+    CameraPathType type = CAMERA_PATH_SPLINE;
+    int framesPerSegment = 30;
+    bool ok = true;
+
+    char line[512];
+    int lineNo = 0;
+    while (ok && fgets(line, sizeof(line), file))
+    {
+        ++lineNo;
+
+        char word[32] = "";
+        int used = 0;
+        if (sscanf(line, " %31s%n", word, &used) != 1 || word[0] == '#')
+            continue;
+
+        const char *rest = line + used;
+        CameraKeyframe key;
+        char typeName[32];
+
+        if (strcmp(word, "key") == 0 &&
+            sscanf(rest, "%f %f %f %f %f %f",
+                   &key.position.x, &key.position.y, &key.position.z,
+                   &key.target.x, &key.target.y, &key.target.z) == 6)
+            keys.push_back(key);
+        else if (strcmp(word, "frames") == 0 &&
+                 sscanf(rest, "%d", &framesPerSegment) == 1 && framesPerSegment > 0)
+            continue;
+        else if (strcmp(word, "type") == 0 && sscanf(rest, "%31s", typeName) == 1 &&
+                 parsePathType(typeName, type))
+            continue;
+        else
+        {
+            fprintf(stderr, "%s:%d: can't read '%s'\n", fileName.c_str(), lineNo, word);
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if (ok && keys.size() < 2)
+    {
+        fprintf(stderr, "%s: a camera path needs at least two keys\n", fileName.c_str());
+        ok = false;
+    }
+
+    if (ok)
+        poses = keyframePath(keys, type, framesPerSegment);
+    return ok;
+}
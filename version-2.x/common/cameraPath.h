@@ -0,0 +1,73 @@
+//
+// Camera paths for the movie demos. A path is computed up front into
+// one pose per frame, so any range of its frames can be rendered on
+// its own with the same frame numbers it has in the full movie.
+//
+
+#ifndef OSPRAY_DEMOS_CAMERA_PATH_H
+#define OSPRAY_DEMOS_CAMERA_PATH_H
+
+#include <string>
+#include <vector>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+struct CameraPose
+{
+    ospcommon::math::vec3f position;
+    ospcommon::math::vec3f direction;
+};
+
+//
+// A point the camera passes through and the point it looks at there.
+//
+struct CameraKeyframe
+{
+    ospcommon::math::vec3f position;
+    ospcommon::math::vec3f target;
+};
+
+enum CameraPathType
+{
+    CAMERA_PATH_SPLINE,  // Catmull-Rom spline through the keyframes
+    CAMERA_PATH_DOLLY,   // straight lines from keyframe to keyframe
+    CAMERA_PATH_ORBIT    // arcs around the y axis through the targets
+};
+
+//
+// The orbit the demos have always used: from camPos along one side of
+// a circle around objCent in z steps of stepSize, then back along the
+// other side.
+//
+std::vector<CameraPose> orbitPath(ospcommon::math::vec3f camPos,
+                                  ospcommon::math::vec3f camView,
+                                  const ospcommon::math::vec3f &objCent,
+                                  float stepSize);
+
+//
+// framesPerSegment poses from each keyframe to the next, ending on
+// the last keyframe. Positions and targets are interpolated
+// separately, so the camera can pan while it moves. An orbit turns
+// the camera the shorter way around its target, changing its distance
+// and height evenly on the way; keys a quarter turn apart make a
+// circle.
+//
+std::vector<CameraPose> keyframePath(const std::vector<CameraKeyframe> &keys,
+                                     CameraPathType type,
+                                     int framesPerSegment);
+
+//
+// Read a path from a text file and compute its poses. Blank lines and
+// lines starting with # are ignored; the others are
+//
+//   type spline|dolly|orbit  how to get between keyframes (default spline)
+//   frames N                 poses per keyframe segment (default 30)
+//   key PX PY PZ TX TY TZ    a keyframe: position, then look-at target
+//
+// At least two keys are needed. Returns false, after printing why, if
+// the file can't be used.
+//
+bool loadCameraPath(const std::string &fileName, std::vector<CameraPose> &poses);
+
+#endif
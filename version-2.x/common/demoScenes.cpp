@@ -0,0 +1,396 @@
+//
+// The scenes of the version 2.x demos.
+//
+
+#include <stdint.h>
+
+#include "demoScenes.h"
+#include "meshVolume.h"
+#include "startupProfiler.h"
+#include "volumeSource.h"
+
+namespace {
+
+//
+// A mesh geometry of numVertex vertices and numTriangles triangles,
+// shared with OSPRay, with material mat, in a group. Takes over the
+// caller's reference to mat.
+//
+OSPGroup newMeshGroup(const float *vertex,
+                      const float *color,
+                      int numVertex,
+                      const int32_t *index,
+                      int numTriangles,
+                      OSPMaterial mat,
+                      SceneKey &key)
+{
+    OSPGeometry mesh = ospNewGeometry("mesh");
+    key.add("vertex.position", vertex, 3 * numVertex);
+    key.add("vertex.color", color, 4 * numVertex);
+    key.add("index", index, 3 * numTriangles);
+
+    OSPData vertexData = profiledSharedData1D(vertex, OSP_VEC3F, numVertex);
+    profiledCommit(vertexData);
+    ospSetObject(mesh, "vertex.position", vertexData);
+    ospRelease(vertexData);
+
+    OSPData colorData = profiledSharedData1D(color, OSP_VEC4F, numVertex);
+    profiledCommit(colorData);
+    ospSetObject(mesh, "vertex.color", colorData);
+    ospRelease(colorData);
+
+    OSPData indexData = profiledSharedData1D(index, OSP_VEC3UI, numTriangles);
+    profiledCommit(indexData);
+    ospSetObject(mesh, "index", indexData);
+    ospRelease(indexData);
+
+    profiledCommit(mesh);
+
+    // Create a model for our mesh.
+    OSPGeometricModel model = ospNewGeometricModel(mesh);
+    ospSetObject(model, "material", mat);
+    profiledCommit(model);
+    ospRelease(mesh);
+    ospRelease(mat);
+
+    // Create a group for our model(s).
+    OSPGroup group = ospNewGroup();
+    ospSetObjectAsData(group, "geometry", OSP_GEOMETRIC_MODEL, model);
+    profiledCommit(group);
+    ospRelease(model);
+
+    return group;
+}
+
+//
+// A volumetric model of volume with tfn, and mat unless it is null, in
+// a group. Takes over the caller's reference to volume.
+//
+OSPGroup newVolumeGroup(OSPVolume volume, OSPTransferFunction tfn, OSPMaterial mat)
+{
+    OSPVolumetricModel model = ospNewVolumetricModel(volume);
+    if (mat)
+        ospSetObject(model, "material", mat);
+    ospSetObject(model, "transferFunction", tfn);
+    profiledCommit(model);
+    ospRelease(volume);
+
+    OSPGroup group = ospNewGroup();
+    ospSetObjectAsData(group, "volume", OSP_VOLUMETRIC_MODEL, model);
+    profiledCommit(group);
+    ospRelease(model);
+
+    return group;
+}
+
+UnstructuredMesh makeDemoCells()
+{
+    //
+    // Just imagine vertex 8 forms a pyramid with 1, 2, 5, 6....
+    //
+    //      7--------6
+    //     /|       /|
+    //    4--------5 |
+    //    | |      | |  8
+    //    | 3------|-2
+    //    |/       |/
+    //    0--------1
+    //
+    // I've also added a tet that sits behind this geometry.
+    //
+    UnstructuredMesh mesh;
+    mesh.positions = {
+        -1.0, -0.5,  0.5, // 0
+         0.0, -0.5,  0.5, // 1
+         0.0, -0.5, -0.5, // 2
+        -1.0, -0.5, -0.5, // 3
+        -1.0,  0.5,  0.5, // 4
+         0.0,  0.5,  0.5, // 5
+         0.0,  0.5, -0.5, // 6
+        -1.0,  0.5, -0.5, // 7
+         1.0,  0.0,  0.0, // 8
+
+        -0.5, -0.5, -1.0, // 9
+         0.5, -0.5, -1.0, // 10
+         0.0, -0.5, -2.0, // 11
+         0.0,  0.5, -1.5, // 12
+    };
+    mesh.indices = {
+        0, 1, 2, 3, 4, 5, 6, 7, // Hex cell
+        1, 2, 6, 5, 8,          // Pyramid cell
+        9, 10, 11, 12,          // Tet cell
+    };
+    mesh.cellStarts = { 0, 8, 13 };
+    mesh.cellTypes = {
+        MESH_HEXAHEDRON,
+        MESH_PYRAMID,
+        MESH_TETRAHEDRON,
+    };
+
+    for (size_t i = 0; i < mesh.vertices(); ++i)
+        mesh.values.push_back(float(i));
+    return mesh;
+}
+
+}
+
+
+ospcommon::math::vec3f demoCameraPosition(DemoScene scene)
+{
+    switch (scene)
+    {
+    case DEMO_TRIANGLES:         return { 0.0f, 0.0f, -2.0f };
+    case DEMO_MATERIAL_MESH:     return { 0.0f, 0.0f, -5.0f };
+    case DEMO_STRUCTURED_VOLUME: return { 0.0f, 0.0f, -15.0f };
+    default:                     return { 0.0f, 0.0f, -5.0f };
+    }
+}
+
+
+const char *demoRendererType(DemoScene scene)
+{
+    return scene == DEMO_UNSTRUCTURED_VOLUME ? "scivis" : "pathtracer";
+}
+
+
+OSPRenderer newDemoRenderer(DemoScene scene, SceneKey &key)
+{
+    const char *rendererType = demoRendererType(scene);
+    key.add("renderer", rendererType);
+    return ospNewRenderer(rendererType);
+}
+
+
+void setDemoRendererParams(DemoScene scene,
+                           OSPRenderer renderer,
+                           QualityController &quality,
+                           SceneKey &key)
+{
+    switch (scene)
+    {
+    case DEMO_TRIANGLES:
+    {
+        //FIXME: setting background color doesn't seem to work...
+        ospcommon::math::vec4f bgColor { 0.0f, 1.0f, 0.0f, 1.0f };
+        quality.setInt("pixelSamples", 5);
+        key.setFloats(renderer, "backgroundColor", OSP_VEC4F, &bgColor.x, 4);
+        break;
+    }
+    case DEMO_MATERIAL_MESH:
+    {
+        //FIXME: background color not working...
+        ospcommon::math::vec4f bgColor { 1.0f, 0.0f, 0.0f, 1.0f };
+        quality.setInt("pixelSamples", 10);
+        key.setFloats(renderer, "backgroundColor", OSP_VEC4F, &bgColor.x, 4);
+        break;
+    }
+    case DEMO_STRUCTURED_VOLUME:
+        quality.setInt("pixelSamples", 5);
+        break;
+    case DEMO_UNSTRUCTURED_VOLUME:
+        key.setFloat(renderer, "backgroundColor", 1.0f);
+        quality.setInt("pixelSamples", 1);
+        quality.setInt("aoSamples", 100);
+        key.setFloat(renderer, "aoIntensity", 10.0f);
+        quality.setFloat("volumeSamplingRate", 30.0f);
+        break;
+    }
+}
+
+
+OSPGroup newTrianglesGroup(SceneKey &key)
+{
+    // triangle mesh data
+    static const float vertex[] = { -0.5f, -0.5f, 0.0f,
+                                     0.5f, -0.5f, 0.0f,
+                                     0.5f,  0.5f, 0.0f,
+                                    -0.5f,  0.5f, 0.0f };
+    static const float color[]  = { 0.9f, 0.5f, 0.5f, 1.0f,
+                                    0.8f, 0.8f, 0.8f, 1.0f,
+                                    0.8f, 0.8f, 0.8f, 1.0f,
+                                    0.8f, 0.8f, 0.8f, 1.0f };
+    static const int32_t index[] = { 0, 1, 2,
+                                     0, 3, 2 };
+
+    // Create and assign a material to the geometry
+    const char *materialType = "obj";
+    OSPMaterial mat = ospNewMaterial("pathtracer", materialType);
+    key.add("material", materialType);
+    profiledCommit(mat);
+
+    return newMeshGroup(vertex, color, 4, index, 2, mat, key);
+}
+
+
+OSPGroup newMaterialMeshGroup(SceneKey &key)
+{
+    // Mesh data.
+    static const float vertex[] = { -0.5f, -0.5f,  0.5f,
+                                     0.5f, -0.5f,  0.5f,
+                                     0.5f,  0.5f,  0.5f,
+                                    -0.5f,  0.5f,  0.5f,
+                                    -0.5f,  0.5f, -0.5f,
+                                     0.5f,  0.5f, -0.5f,
+                                     0.5f, -0.5f, -0.5f,
+                                    -0.5f, -0.5f, -0.5f };
+    static const float color[]  = { 1.0f, 0.0f, 0.0f, 1.0f,
+                                    0.0f, 1.0f, 0.0f, 1.0f,
+                                    0.0f, 0.0f, 1.0f, 1.0f,
+                                    1.0f, 0.0f, 0.0f, 1.0f,
+                                    1.0f, 0.0f, 0.0f, 1.0f,
+                                    0.0f, 1.0f, 0.0f, 1.0f,
+                                    0.0f, 0.0f, 1.0f, 1.0f,
+                                    1.0f, 0.0f, 0.0f, 1.0f };
+    static const int32_t index[] = { 0, 1, 2,
+                                     0, 3, 2,
+                                     0, 7, 4,
+                                     0, 3, 4,
+                                     7, 6, 5,
+                                     7, 4, 5,
+                                     1, 6, 5,
+                                     1, 2, 5 };
+
+    // Create and assign a material to the geometry.
+    const char *materialType = "thinGlass";
+    OSPMaterial mat = ospNewMaterial("pathtracer", materialType);
+    key.add("material", materialType);
+    key.setFloat(mat, "thickness", .2f);
+    key.setFloat(mat, "attenuationDistance", .2f);
+    profiledCommit(mat);
+
+    return newMeshGroup(vertex, color, 8, index, 8, mat, key);
+}
+
+
+OSPTransferFunction newDemoTransferFunction(ospcommon::math::vec2f range,
+                                            const std::vector<float> &opacities,
+                                            SceneKey &key)
+{
+    static const float colors[] = {
+        1.0, 0.0, 0.0,
+        0.0, 1.0, 0.0,
+        0.0, 0.0, 1.0,
+    };
+    OSPTransferFunction tfn = ospNewTransferFunction("piecewiseLinear");
+
+    key.setFloats(tfn, "valueRange", OSP_VEC2F, &range[0], 2);
+    key.add("color", colors, sizeof(colors) / sizeof(colors[0]));
+    key.add("opacity", opacities);
+
+    // Because color and opacity are "multi-dimensional", we need to
+    // pass these arrays in as OSP_DATA (or OSP_OBJECT).
+    OSPData tfColorData = profiledSharedData1D(colors, OSP_VEC3F, 3);
+    profiledCommit(tfColorData);
+    ospSetParam(tfn, "color", OSP_DATA, &tfColorData);
+    ospRelease(tfColorData);
+
+    OSPData tfOpacityData = profiledSharedData1D(opacities.data(), OSP_FLOAT,
+                                                 opacities.size());
+    profiledCommit(tfOpacityData);
+    ospSetParam(tfn, "opacity", OSP_DATA, &tfOpacityData);
+    ospRelease(tfOpacityData);
+    profiledCommit(tfn);
+
+    return tfn;
+}
+
+
+const std::vector<float> &structuredVolumeOpacities()
+{
+    static const std::vector<float> opacities = { 0.0, 1.0 };
+    return opacities;
+}
+
+
+OSPGroup newStructuredVolumeGroup(const VoxelArray &voxels, OSPTransferFunction tfn)
+{
+    OSPVolume volume = ospNewVolume("structuredRegular");
+
+    OSPData voxelData = newSharedVoxelData(voxels);
+    profiledCommit(voxelData);
+    //ospSetObject(volume, "data", voxelData); Either of these methods works.
+    ospSetParam(volume, "data", OSP_DATA, &voxelData);
+    ospRelease(voxelData);
+
+    ospcommon::math::vec3f spacing = volumeSpacing(voxels.dims);
+    ospcommon::math::vec3f origin  = volumeOrigin(voxels.dims);
+    ospSetParam(volume, "gridSpacing", OSP_VEC3F, spacing);
+    ospSetParam(volume, "gridOrigin", OSP_VEC3F, origin);
+    profiledCommit(volume);
+
+    // Create and assign a material to the geometry.
+    OSPMaterial mat = ospNewMaterial("pathtracer", "obj");
+    profiledCommit(mat);
+
+    OSPGroup group = newVolumeGroup(volume, tfn, mat);
+    ospRelease(mat);
+    return group;
+}
+
+
+const UnstructuredMesh &demoCells()
+{
+    static const UnstructuredMesh cells = makeDemoCells();
+    return cells;
+}
+
+
+OSPGroup newUnstructuredVolumeGroup(const UnstructuredMesh &mesh,
+                                    ospcommon::math::vec2f range,
+                                    SceneKey &key)
+{
+    static const std::vector<float> opacities = { 8.0, 1.0 };
+
+    // Mesh files are known by their description; the built-in cells
+    // have none, so their values go in the key.
+    if (&mesh == &demoCells())
+    {
+        key.add("vertex.position", mesh.positions);
+        key.add("index", mesh.indices);
+        key.add("cell.index", mesh.cellStarts);
+        key.add("cell.type", mesh.cellTypes);
+        key.add("vertex.data", mesh.values);
+    }
+    else
+    {
+        key.add("mesh", mesh.description);
+    }
+
+    OSPVolume volume = ospNewVolume("unstructured");
+    setMeshVolumeParams(volume, mesh);
+    profiledCommit(volume);
+
+    OSPTransferFunction tfn = newDemoTransferFunction(range, opacities, key);
+    OSPGroup group = newVolumeGroup(volume, tfn, nullptr);
+    ospRelease(tfn);
+    return group;
+}
+
+
+OSPWorld newDemoWorld(OSPGroup group, SceneKey &key, const UnstructuredMesh *fitMesh)
+{
+    // Create an instance of our group.
+    OSPInstance instance = ospNewInstance(group);
+    if (fitMesh)
+        fitMeshInstance(instance, *fitMesh, 2.0f);
+    profiledCommit(instance);
+    ospRelease(group);
+
+    // Create a world for our instance.
+    OSPWorld world = ospNewWorld();
+    ospSetObjectAsData(world, "instance", OSP_INSTANCE, instance);
+    ospRelease(instance);
+
+    // Create and setup light for Ambient Occlusion
+    const char *lightType = "ambient";
+    OSPLight ambientLight = ospNewLight(lightType);
+    key.add("light", lightType);
+    profiledCommit(ambientLight);
+
+    // Add light to our world.
+    ospSetObjectAsData(world, "light", OSP_LIGHT, ambientLight);
+    ospRelease(ambientLight);
+    profiledCommit(world);
+
+    return world;
+}
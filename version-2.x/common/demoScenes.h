@@ -0,0 +1,109 @@
+//
+// The scenes of the version 2.x demos, built in one place so that the
+// demos and the benchmark harness (see bench/demoBench.cpp) render the
+// same objects with the same renderer settings. Every object a scene
+// makes is committed through the startup profiler's wrappers (see
+// startupProfiler.h), and what it sets is added to a SceneKey (see
+// sceneKey.h). All code is written using OSPRay's C interface.
+//
+
+#ifndef OSPRAY_DEMOS_DEMO_SCENES_H
+#define OSPRAY_DEMOS_DEMO_SCENES_H
+
+#include <vector>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "meshFile.h"
+#include "qualityController.h"
+#include "sceneKey.h"
+#include "voxelArray.h"
+
+enum DemoScene
+{
+    DEMO_TRIANGLES,           // triangles: two triangles
+    DEMO_MATERIAL_MESH,       // material_vid: an open box of thin glass
+    DEMO_STRUCTURED_VOLUME,   // structured_volume
+    DEMO_UNSTRUCTURED_VOLUME  // unstructured_volume
+};
+
+//
+// Where the scene's demo puts its camera, looking at the origin with
+// y up.
+//
+ospcommon::math::vec3f demoCameraPosition(DemoScene scene);
+
+//
+// The type of renderer the scene's demo uses, and a new one of it.
+// The caller owns the handle.
+//
+const char *demoRendererType(DemoScene scene);
+OSPRenderer newDemoRenderer(DemoScene scene, SceneKey &key);
+
+//
+// Set the parameters the scene's demo sets on renderer, the quality
+// ones through quality so it can adjust them. The renderer still
+// needs committing.
+//
+void setDemoRendererParams(DemoScene scene,
+                           OSPRenderer renderer,
+                           QualityController &quality,
+                           SceneKey &key);
+
+//
+// The triangles and material_mesh geometry, in a group each. The
+// caller owns the handle.
+//
+OSPGroup newTrianglesGroup(SceneKey &key);
+OSPGroup newMaterialMeshGroup(SceneKey &key);
+
+//
+// The red, green and blue transfer function of the volume demos over
+// range. It shares opacities, which must outlive it. The caller owns
+// the handle.
+//
+OSPTransferFunction newDemoTransferFunction(ospcommon::math::vec2f range,
+                                            const std::vector<float> &opacities,
+                                            SceneKey &key);
+
+//
+// The opacities the structured_volume demo gives its transfer
+// function, before --empty-bins changes them.
+//
+const std::vector<float> &structuredVolumeOpacities();
+
+//
+// A structuredRegular volume sharing voxels, which must outlive it, on
+// the grid volumeSpacing and volumeOrigin give them (see
+// volumeSource.h), rendered with tfn, in a group. The caller owns the
+// handle.
+//
+OSPGroup newStructuredVolumeGroup(const VoxelArray &voxels, OSPTransferFunction tfn);
+
+//
+// The hex, pyramid and tet unstructured_volume renders without a mesh
+// file, with a value per vertex.
+//
+const UnstructuredMesh &demoCells();
+
+//
+// An unstructured volume sharing mesh, which must outlive it, with the
+// unstructured_volume demo's transfer function over range, in a group.
+// The caller owns the handle.
+//
+OSPGroup newUnstructuredVolumeGroup(const UnstructuredMesh &mesh,
+                                    ospcommon::math::vec2f range,
+                                    SceneKey &key);
+
+//
+// A world holding an instance of group, lit by an ambient light, and
+// committed. The world takes over the caller's reference to group.
+// With fitMesh, the instance centers that mesh on the origin with its
+// longest side 2 long, the box the movie cameras orbit.
+//
+OSPWorld newDemoWorld(OSPGroup group,
+                      SceneKey &key,
+                      const UnstructuredMesh *fitMesh = nullptr);
+
+#endif
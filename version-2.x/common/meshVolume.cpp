@@ -0,0 +1,88 @@
+//
+// OSPRay "unstructured" volumes from mesh files.
+//
+
+#include <algorithm>
+#include <stdio.h>
+
+#include "meshVolume.h"
+#include "startupProfiler.h"
+#include "voxelArray.h"
+#include "voxelHistogram.h"
+
+namespace {
+
+void setShared(OSPVolume volume, const char *name, const void *data, OSPDataType type,
+               size_t numItems)
+{
+    OSPData shared = profiledSharedData1D(data, type, numItems);
+    profiledCommit(shared);
+    ospSetParam(volume, name, OSP_DATA, &shared);
+    ospRelease(shared);
+}
+
+}
+
+
+void setMeshVolumeParams(OSPVolume volume, const UnstructuredMesh &mesh)
+{
+    setShared(volume, "vertex.position", mesh.positions.data(), OSP_VEC3F,
+              mesh.vertices());
+    setShared(volume, "index", mesh.indices.data(), OSP_UINT, mesh.indices.size());
+    setShared(volume, "cell.index", mesh.cellStarts.data(), OSP_UINT, mesh.cells());
+    setShared(volume, "cell.type", mesh.cellTypes.data(), OSP_UCHAR, mesh.cells());
+    setShared(volume, mesh.cellValues ? "cell.data" : "vertex.data", mesh.values.data(),
+              OSP_FLOAT, mesh.values.size());
+
+    // Whatever the volume held before goes, values of the other kind too.
+    ospRemoveParam(volume, mesh.cellValues ? "vertex.data" : "cell.data");
+}
+
+
+ospcommon::math::vec2f meshValueRange(const UnstructuredMesh &mesh,
+                                      int argc,
+                                      const char **argv)
+{
+    ospcommon::math::vec2f range;
+    const VoxelArray values = {mesh.values.data(), VOXEL_FLOAT,
+                               {mesh.values.size(), 1, 1}};
+
+    HistogramOptions histogramOptions = parseHistogramOptions(argc, argv);
+    if (!histogramOptions.enabled())
+    {
+        voxelRange(values, range[0], range[1]);
+        return range;
+    }
+
+    VoxelHistogram histogram(values);
+    range[0] = histogram.percentile(histogramOptions.percentiles[0]);
+    range[1] = histogram.percentile(histogramOptions.percentiles[1]);
+    printf("Histogram of %zu values in %.1f ms: range %g:%g from percentiles %g:%g "
+           "of %g:%g\n",
+           (size_t)histogram.total(), 1000.0 * histogram.seconds(), range[0], range[1],
+           histogramOptions.percentiles[0], histogramOptions.percentiles[1],
+           histogram.minValue(), histogram.maxValue());
+    return range;
+}
+
+
+void fitMeshInstance(OSPInstance instance, const UnstructuredMesh &mesh, float size)
+{
+    float lower[3], upper[3];
+    meshBounds(mesh, lower, upper);
+
+    float longest = std::max(upper[0] - lower[0],
+                             std::max(upper[1] - lower[1], upper[2] - lower[2]));
+    float scale = longest > 0.0f ? size / longest : 1.0f;
+
+    // Columns of the linear part, then the translation.
+    float xfm[12];
+    std::fill(xfm, xfm + 12, 0.0f);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        xfm[4 * axis] = scale;
+        xfm[9 + axis] = -0.5f * scale * (lower[axis] + upper[axis]);
+    }
+
+    ospSetParam(instance, "xfm", OSP_AFFINE3F, static_cast<const void *>(xfm));
+}
@@ -0,0 +1,36 @@
+//
+// OSPRay "unstructured" volumes from mesh files (see meshFile.h). The
+// mesh's arrays are shared with OSPRay rather than copied, so the mesh
+// must outlive the volume.
+//
+
+#ifndef OSPRAY_DEMOS_MESH_VOLUME_H
+#define OSPRAY_DEMOS_MESH_VOLUME_H
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "meshFile.h"
+
+//
+// Set the volume's vertex.position, index, cell.index, cell.type and
+// vertex.data or cell.data, replacing any set before and removing the
+// other of the two. The volume still has to be committed.
+//
+void setMeshVolumeParams(OSPVolume volume, const UnstructuredMesh &mesh);
+
+//
+// The transfer function's value range: the field's whole range, or
+// the percentiles --percentiles gives (see voxelHistogram.h).
+//
+ospcommon::math::vec2f meshValueRange(const UnstructuredMesh &mesh,
+                                      int argc,
+                                      const char **argv);
+
+//
+// Set the instance's "xfm" to center the mesh on the origin, where the
+// movie's camera orbits, with its longest side size long.
+//
+void fitMeshInstance(OSPInstance instance, const UnstructuredMesh &mesh, float size);
+
+#endif
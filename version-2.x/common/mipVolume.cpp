@@ -0,0 +1,174 @@
+//
+// A structured volume rendered at the mip level each frame needs.
+//
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mipVolume.h"
+#include "startupProfiler.h"
+#include "volumeSource.h"
+
+MipOptions parseMipOptions(int argc, const char **argv)
+{
+    MipOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--pyramid") == 0)
+            options.enabled = true;
+        else if (strcmp(argv[i], "--pyramid-levels") == 0 && i + 1 < argc)
+            options.maxLevels = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--voxel-pixels") == 0 && i + 1 < argc)
+            options.voxelPixels = atof(argv[++i]);
+    }
+
+    return options;
+}
+
+
+namespace {
+
+const double MB = 1024.0 * 1024.0;
+
+//
+// Distance from p to the box [lower, upper] along one axis.
+//
+float outside(float p, float lower, float upper)
+{
+    return p < lower ? lower - p : (p > upper ? p - upper : 0.0f);
+}
+
+}
+
+
+MipVolume::MipVolume(const VoxelArray &base,
+                     ospcommon::math::vec3f spacing,
+                     ospcommon::math::vec3f origin,
+                     OSPTransferFunction tfn,
+                     const MipOptions &options)
+    : pyramid(base, options.maxLevels),
+      spacing(spacing),
+      origin(origin),
+      options(options),
+      volume(ospNewVolume("structuredRegular")),
+      current(0),
+      levelFrames(pyramid.levels(), 0),
+      levelSeconds(pyramid.levels(), 0.0)
+{
+    size_t extraBytes = 0;
+    for (size_t i = 1; i < pyramid.levels(); ++i)
+        extraBytes += pyramid.level(i).bytes();
+    printf("Built a %zu level volume pyramid in %.3f s, %.1f MB beyond full resolution\n",
+           pyramid.levels(), pyramid.buildSeconds(), extraBytes / MB);
+
+    setLevel(0);
+
+    model = ospNewVolumetricModel(volume);
+    ospSetObject(model, "transferFunction", tfn);
+    profiledCommit(model);
+
+    volumeGroup = ospNewGroup();
+    ospSetObjectAsData(volumeGroup, "volume", OSP_VOLUMETRIC_MODEL, model);
+    profiledCommit(volumeGroup);
+}
+
+
+MipVolume::~MipVolume()
+{
+    ospRelease(volumeGroup);
+    ospRelease(model);
+    ospRelease(volume);
+}
+
+
+bool MipVolume::update(const CameraPose &pose, float fovy, int imageHeight)
+{
+    // The nearest point of the volume, where its voxels look largest.
+    const VolumeDims &dims = pyramid.level(0).dims;
+    const ospcommon::math::vec3f &p = pose.position;
+    float dx = outside(p.x, origin.x, origin.x + spacing.x * (dims.x - 1));
+    float dy = outside(p.y, origin.y, origin.y + spacing.y * (dims.y - 1));
+    float dz = outside(p.z, origin.z, origin.z + spacing.z * (dims.z - 1));
+    float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+    // Pixels a unit length spans at that distance.
+    float pixelsPerUnit = distance > 0.0f
+        ? imageHeight / (2.0f * distance * tanf(0.5f * fovy * (float)M_PI / 180.0f))
+        : INFINITY;
+
+    // Each level about doubles the voxel size; take the last that fits.
+    size_t level = 0;
+    while (level + 1 < pyramid.levels() &&
+           voxelSize(level + 1) * pixelsPerUnit <= options.voxelPixels)
+        ++level;
+
+    if (level == current)
+        return false;
+
+    setLevel(level);
+    profiledCommit(model);
+    profiledCommit(volumeGroup);
+    return true;
+}
+
+
+float MipVolume::voxelSize(size_t level) const
+{
+    float scale[3];
+    pyramid.spacingScale(level, scale);
+    return std::max(spacing.x * scale[0],
+                    std::max(spacing.y * scale[1], spacing.z * scale[2]));
+}
+
+
+void MipVolume::setLevel(size_t level)
+{
+    const VoxelArray &voxels = pyramid.level(level);
+    float scale[3];
+    pyramid.spacingScale(level, scale);
+
+    OSPData voxelData = profiledSharedData3D(voxels.voxels, ospVoxelType(voxels.type),
+        voxels.dims.x, voxels.dims.y, voxels.dims.z);
+    profiledCommit(voxelData);
+    ospSetParam(volume, "data", OSP_DATA, &voxelData);
+    ospRelease(voxelData);
+
+    // Every level spans the same extent as full resolution.
+    ospcommon::math::vec3f levelSpacing { spacing.x * scale[0],
+                                          spacing.y * scale[1],
+                                          spacing.z * scale[2] };
+    ospSetParam(volume, "gridSpacing", OSP_VEC3F, levelSpacing);
+    ospSetParam(volume, "gridOrigin", OSP_VEC3F, origin);
+    profiledCommit(volume);
+
+    current = level;
+}
+
+
+void MipVolume::frameRendered(double seconds)
+{
+    ++levelFrames[current];
+    levelSeconds[current] += seconds;
+}
+
+
+void MipVolume::printSummary() const
+{
+    printf("\nlevel  voxels              MB  frames  mean render ms\n");
+    for (size_t i = 0; i < pyramid.levels(); ++i)
+    {
+        const VoxelArray &voxels = pyramid.level(i);
+        char dims[32];
+        snprintf(dims, sizeof(dims), "%zux%zux%zu",
+                 voxels.dims.x, voxels.dims.y, voxels.dims.z);
+
+        printf("%5zu  %-16s %6.1f  %6zu", i, dims, voxels.bytes() / MB, levelFrames[i]);
+        if (levelFrames[i] > 0)
+            printf("  %14.3f", 1000.0 * levelSeconds[i] / levelFrames[i]);
+        printf("\n");
+    }
+}
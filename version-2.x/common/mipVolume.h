@@ -0,0 +1,110 @@
+//
+// A structured volume that renders, for each frame, the coarsest level
+// of a mip pyramid (see volumePyramid.h) whose voxels still project to
+// no more than a given number of pixels. Far from the volume that is a
+// much smaller level than the full resolution, for the same image.
+//
+
+#ifndef OSPRAY_DEMOS_MIP_VOLUME_H
+#define OSPRAY_DEMOS_MIP_VOLUME_H
+
+#include <vector>
+#include <stddef.h>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "cameraPath.h"
+#include "volumePyramid.h"
+
+struct MipOptions
+{
+    // Build a pyramid and pick a level per frame.
+    bool enabled;
+
+    // Most levels to build, including full resolution. Zero builds
+    // them all.
+    int maxLevels;
+
+    // Largest size, in pixels, a voxel of the chosen level may project
+    // to at the volume's nearest point.
+    float voxelPixels;
+
+    MipOptions()
+        : enabled(false),
+          maxLevels(0),
+          voxelPixels(1.0f)
+    {}
+};
+
+//
+// Read mip pyramid options from the command line.
+//
+//   --pyramid              render the level each frame's view needs
+//   --pyramid-levels N     build at most N levels (default all)
+//   --voxel-pixels P       largest projected voxel size (default 1)
+//
+MipOptions parseMipOptions(int argc, const char **argv);
+
+class MipVolume
+{
+  public:
+    //
+    // Build the pyramid over base, which must outlive this object, and
+    // make a volume of its full resolution level on the grid given by
+    // spacing and origin, rendered with tfn.
+    //
+    MipVolume(const VoxelArray &base,
+              ospcommon::math::vec3f spacing,
+              ospcommon::math::vec3f origin,
+              OSPTransferFunction tfn,
+              const MipOptions &options);
+    ~MipVolume();
+
+    MipVolume(const MipVolume &) = delete;
+    MipVolume &operator=(const MipVolume &) = delete;
+
+    //
+    // The group holding the volume. Put it in an instance once.
+    //
+    OSPGroup group() const { return volumeGroup; }
+
+    //
+    // Switch the volume to the level suited to a perspective camera at
+    // pose rendering imageHeight pixels high. Returns true if the level
+    // changed, in which case the world holding the group must be
+    // committed before rendering.
+    //
+    bool update(const CameraPose &pose, float fovy, int imageHeight);
+
+    //
+    // Count a frame rendered with the current level in seconds.
+    //
+    void frameRendered(double seconds);
+
+    //
+    // Print each level's size, the frames rendered with it and their
+    // mean render time.
+    //
+    void printSummary() const;
+
+  private:
+    // The largest grid spacing of a level.
+    float voxelSize(size_t level) const;
+    void setLevel(size_t level);
+
+    VolumePyramid          pyramid;
+    ospcommon::math::vec3f spacing;
+    ospcommon::math::vec3f origin;
+    MipOptions             options;
+
+    OSPVolume          volume;
+    OSPVolumetricModel model;
+    OSPGroup           volumeGroup;
+    size_t             current;
+
+    std::vector<size_t> levelFrames;
+    std::vector<double> levelSeconds;
+};
+
+#endif
@@ -0,0 +1,153 @@
+//
+// Farm mode for the movie demos.
+//
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "movieFarm.h"
+#include "frameSink.h"
+
+namespace {
+
+//
+// Lives in an anonymous shared mapping made before the workers are
+// forked, so every worker sees the same counters.
+//
+struct FarmQueue
+{
+    std::atomic<uint64_t> nextFrame;
+    std::atomic<uint64_t> framesDone;
+};
+
+FarmQueue *queue  = nullptr;
+int        worker = -1;
+
+}
+
+
+void startMovieFarm(int argc, const char **argv)
+{
+    int numWorkers = 0;
+    bool inflightScan = false;
+    bool poster = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--farm") == 0 && i + 1 < argc)
+            numWorkers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--inflight-scan") == 0)
+            inflightScan = true;
+        else if (strcmp(argv[i], "--poster") == 0)
+            poster = true;
+    }
+    if (numWorkers <= 1)
+        return;
+
+    // Each worker only sees some of the frames.
+    if (inflightScan || isStreamingFrameSink(parseFrameSinkOptions(argc, argv).spec))
+    {
+        fprintf(stderr, "--farm can't be combined with --inflight-scan or a "
+                "streaming sink, which need every frame in one process\n");
+        exit(1);
+    }
+    if (poster)
+    {
+        fprintf(stderr, "--farm doesn't apply to --poster, which renders one image\n");
+        exit(1);
+    }
+
+    void *shared = mmap(nullptr, sizeof(FarmQueue), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        fprintf(stderr, "mmap for the farm queue failed: %d; running one process\n", errno);
+        return;
+    }
+    queue = new (shared) FarmQueue();
+    queue->nextFrame  = 0;
+    queue->framesDone = 0;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    // Don't let the workers inherit unwritten output.
+    fflush(stdout);
+    fflush(stderr);
+
+    std::vector<pid_t> workers;
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            worker = i;
+            return;
+        }
+        if (pid < 0)
+        {
+            fprintf(stderr, "fork failed: %d; farming with %d workers\n", errno, i);
+            break;
+        }
+        workers.push_back(pid);
+    }
+
+    int failed = workers.empty() ? 1 : 0;
+    for (pid_t pid : workers)
+    {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            fprintf(stderr, "Farm worker %d failed (status %d)\n", (int)pid, status);
+            failed = 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t frames = queue->framesDone;
+    printf("\nFarm: %zu workers rendered %llu frames in %.2f s (%.2f frames/s)\n",
+           workers.size(), (unsigned long long)frames, seconds, frames / seconds);
+
+    exit(failed);
+}
+
+
+bool inMovieFarm()
+{
+    return worker >= 0;
+}
+
+
+int movieFarmWorker()
+{
+    return worker;
+}
+
+
+bool claimFarmFrame(size_t first, size_t end, size_t &frame)
+{
+    uint64_t claimed = queue->nextFrame.fetch_add(1);
+    if (claimed >= end - first)
+        return false;
+
+    frame = first + claimed;
+    return true;
+}
+
+
+void countFarmFrame()
+{
+    if (queue)
+        queue->framesDone.fetch_add(1);
+}
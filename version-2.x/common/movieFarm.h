@@ -0,0 +1,43 @@
+//
+// Farm mode for the movie demos: several worker processes on one
+// machine, each with its own OSPRay device and copy of the scene,
+// pulling frame indices from a shared queue. Small frames don't keep
+// one OSPRay process busy on a large machine; a few of them side by
+// side do.
+//
+
+#ifndef OSPRAY_DEMOS_MOVIE_FARM_H
+#define OSPRAY_DEMOS_MOVIE_FARM_H
+
+#include <stddef.h>
+
+//
+// With --farm N on the command line, fork N worker processes and
+// return in each of them. The original process waits for the workers,
+// prints the aggregate frames/s and exits. Without --farm this returns
+// straight away.
+//
+// This has to be called before ospInit, while the process still has
+// a single thread.
+//
+void startMovieFarm(int argc, const char **argv);
+
+//
+// Whether this process is a farm worker, and which one (0 to N-1).
+//
+bool inMovieFarm();
+int  movieFarmWorker();
+
+//
+// Claim the next unrendered frame of [first, end) for this worker.
+// Returns false once every frame has been claimed. The queue is a
+// lock-free counter in memory shared by all workers.
+//
+bool claimFarmFrame(size_t first, size_t end, size_t &frame);
+
+//
+// Count a finished frame towards the farm's throughput.
+//
+void countFarmFrame();
+
+#endif
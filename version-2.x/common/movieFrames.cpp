@@ -0,0 +1,657 @@
+//
+// Movie generation shared by the version 2.x demos.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "movieFrames.h"
+#include "cameraPath.h"
+#include "frameCache.h"
+#include "frameJournal.h"
+#include "frameTimings.h"
+#include "frameWriter.h"
+#include "movieFarm.h"
+#include "startupProfiler.h"
+
+MovieOptions parseMovieOptions(int argc, const char **argv)
+{
+    MovieOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--pipelined") == 0)
+            options.pipelined = true;
+        else if (strcmp(argv[i], "--staging-buffers") == 0 && i + 1 < argc)
+            options.stagingBuffers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--inflight") == 0 && i + 1 < argc)
+            options.inflight = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--inflight-scan") == 0)
+            options.inflightScan = true;
+        else if (strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc)
+            options.varianceThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-samples") == 0 && i + 1 < argc)
+            options.maxAccumulation = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--timings") == 0 && i + 1 < argc)
+            options.timingsFile = argv[++i];
+        else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc)
+            options.cacheDir = argv[++i];
+        else if (strcmp(argv[i], "--profile-startup") == 0)
+            options.profileStartup = true;
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+            options.pathFile = argv[++i];
+        else if (strcmp(argv[i], "--resume") == 0)
+            options.resume = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            // B:E, B: or :E
+            const char *range = argv[++i];
+            const char *colon = strchr(range, ':');
+            if (colon == nullptr)
+            {
+                fprintf(stderr, "Bad --frames '%s', expected BEGIN:END\n", range);
+                continue;
+            }
+            options.firstFrame = std::max(0, atoi(range));
+            options.endFrame   = colon[1] ? atoi(colon + 1) : -1;
+        }
+    }
+
+    options.sink = parseFrameSinkOptions(argc, argv);
+
+    return options;
+}
+
+
+namespace {
+
+typedef FrameTimings::Clock Clock;
+
+//
+// The cache key of every pose: the scene key, framebuffer and
+// accumulation settings, and the camera. When the demo changes the
+// scene per frame through prepareFrame, the frame number too, as the
+// same pose may then show a different scene.
+//
+std::vector<uint64_t> frameKeys(const std::vector<CameraPose> &poses,
+                                const ospcommon::math::vec3f &camUp,
+                                const ospcommon::math::vec2i &imgSize,
+                                FramePixelFormat format,
+                                const MovieOptions &options)
+{
+    uint64_t settings = fnv1a(options.sceneKey);
+    settings = fnv1a(&imgSize, sizeof(imgSize), settings);
+    settings = fnv1a(&format, sizeof(format), settings);
+    settings = fnv1a(&camUp, sizeof(camUp), settings);
+    if (options.varianceThreshold > 0.0f)
+    {
+        settings = fnv1a(&options.varianceThreshold,
+                         sizeof(options.varianceThreshold), settings);
+        settings = fnv1a(&options.maxAccumulation,
+                         sizeof(options.maxAccumulation), settings);
+    }
+
+    std::vector<uint64_t> keys;
+    keys.reserve(poses.size());
+    for (size_t i = 0; i < poses.size(); ++i)
+    {
+        const CameraPose &pose = poses[i];
+        uint64_t key = fnv1a(&pose.position, sizeof(pose.position), settings);
+        key = fnv1a(&pose.direction, sizeof(pose.direction), key);
+        if (options.prepareFrame)
+        {
+            const uint64_t frame = i;
+            key = fnv1a(&frame, sizeof(frame), key);
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+//
+// Hands finished frames to the sink, either directly or through the
+// background writer when running pipelined. Destroying it waits for
+// the writer to drain. Stage times are recorded into timings if given,
+// rendered frames are added to cache if given, and frames are synced
+// to disk and recorded in journal if given.
+//
+class FrameOutput
+{
+  public:
+    FrameOutput(const ospcommon::math::vec2i &imgSize,
+                FrameSink &sink,
+                const MovieOptions &options,
+                FrameTimings *timings,
+                FrameCache *cache,
+                const std::vector<uint64_t> &keys,
+                FrameJournal *journal)
+        : imgSize(imgSize),
+          sink(sink),
+          timings(timings),
+          cache(cache),
+          keys(keys),
+          journal(journal),
+          cached(keys.size(), 0)
+    {
+        if (options.pipelined)
+        {
+            writer.reset(new FrameWriter(
+                frameBytes(), options.stagingBuffers,
+                [this](int fIdx, const void *pixels)
+                {
+                    writeFrame(fIdx, pixels);
+                }));
+        }
+    }
+
+    void write(OSPFrameBuffer framebuffer, int fIdx)
+    {
+        Clock::time_point start = Clock::now();
+        const void *fb = ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
+
+        if (writer)
+        {
+            // Waiting for a free staging buffer counts as mapping time;
+            // it is the writer holding up the render loop.
+            void *staging = writer->acquireBuffer();
+            memcpy(staging, fb, frameBytes());
+            ospUnmapFrameBuffer(fb, framebuffer);
+            record(fIdx, STAGE_MAP, FrameTimings::secondsSince(start));
+            writer->submit(fIdx, staging);
+        }
+        else
+        {
+            record(fIdx, STAGE_MAP, FrameTimings::secondsSince(start));
+            writeFrame(fIdx, fb);
+            ospUnmapFrameBuffer(fb, framebuffer);
+        }
+
+        start = Clock::now();
+        ospResetAccumulation(framebuffer);
+        record(fIdx, STAGE_RESET, FrameTimings::secondsSince(start));
+    }
+
+    //
+    // Write a frame that was loaded from the cache.
+    //
+    void writeCached(const void *pixels, int fIdx)
+    {
+        cached[fIdx] = 1;
+
+        if (writer)
+        {
+            void *staging = writer->acquireBuffer();
+            memcpy(staging, pixels, frameBytes());
+            writer->submit(fIdx, staging);
+        }
+        else
+        {
+            writeFrame(fIdx, pixels);
+        }
+    }
+
+    size_t frameBytes() const
+    {
+        return (size_t)imgSize.x * imgSize.y * framePixelBytes(sink.format());
+    }
+
+  private:
+    Frame frame(int fIdx, const void *pixels) const
+    {
+        return {fIdx, imgSize.x, imgSize.y, sink.format(), pixels};
+    }
+
+    void writeFrame(int fIdx, const void *pixels)
+    {
+        if (cache && !cached[fIdx])
+            cache->store(keys[fIdx], pixels, frameBytes());
+
+        sink.writeFrame(frame(fIdx, pixels));
+
+        const FileWriteTimes &times = sink.lastWriteTimes();
+        record(fIdx, STAGE_CONVERT, times.convert);
+        record(fIdx, STAGE_WRITE, times.write);
+
+        // Only journal a frame once it is sure to survive a crash.
+        if (journal)
+        {
+            Clock::time_point start = Clock::now();
+            if (sink.sync(fIdx))
+                journal->record(fIdx);
+            record(fIdx, STAGE_WRITE, FrameTimings::secondsSince(start));
+        }
+    }
+
+    void record(int fIdx, FrameStage stage, double seconds)
+    {
+        if (timings)
+            timings->record(fIdx, stage, seconds);
+    }
+
+    ospcommon::math::vec2i       imgSize;
+    FrameSink                   &sink;
+    FrameTimings                *timings;
+    FrameCache                  *cache;
+    const std::vector<uint64_t> &keys;
+    FrameJournal                *journal;
+    std::vector<char>            cached;
+    std::unique_ptr<FrameWriter> writer;
+};
+
+//
+// A framebuffer and camera that one frame can render into while other
+// frames are in flight.
+//
+struct RenderSlot
+{
+    OSPFrameBuffer framebuffer;
+    OSPCamera      camera;
+    bool           ownsCamera;
+    OSPFuture      future;
+    bool           active;
+    int            fIdx;
+    int            passes;
+    float          variance;
+
+    // Set when the frame came from the cache instead of rendering.
+    bool                       fromCache;
+    std::vector<unsigned char> cachedPixels;
+
+    Clock::time_point renderStart;
+};
+
+//
+// Render poses [first, end), keeping up to inflight frames rendering
+// at once. Frames are numbered by their index in poses.
+// Frames are finished and written in order. Returns the wall time in
+// seconds, including waiting for the writer to drain.
+//
+// The render time recorded for a frame runs from its launch to its
+// last pass finishing, so with several frames in flight it includes
+// time spent waiting behind the others.
+//
+double renderPoses(OSPWorld world,
+                   OSPRenderer renderer,
+                   OSPCamera camera,
+                   const ospcommon::math::vec3f &camUp,
+                   const ospcommon::math::vec2i &imgSize,
+                   const std::vector<CameraPose> &poses,
+                   size_t first,
+                   size_t end,
+                   int inflight,
+                   FrameSink &sink,
+                   const MovieOptions &options,
+                   FrameTimings *timings = nullptr,
+                   FrameCache *cache = nullptr,
+                   FrameJournal *journal = nullptr,
+                   bool logPoses = true)
+{
+    OSPFrameBufferFormat fbFormat =
+        sink.format() == FRAME_RGBA32F ? OSP_FB_RGBA32F : OSP_FB_SRGBA;
+    const bool adaptive = options.varianceThreshold > 0.0f;
+    uint32_t channels = OSP_FB_COLOR | /*OSP_FB_DEPTH |*/ OSP_FB_ACCUM;
+    if (adaptive)
+        channels |= OSP_FB_VARIANCE;
+
+    if (options.prepareFrame)
+        inflight = 1;
+
+    // The first slot renders with the demo's camera. The others get
+    // perspective cameras set up the same way the demos set up theirs.
+    std::vector<RenderSlot> slots(std::max<size_t>(1,
+        std::min<size_t>(inflight, end - first)));
+
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        RenderSlot &slot = slots[i];
+        slot.framebuffer = ospNewFrameBuffer(imgSize[0], imgSize[1], fbFormat,
+            channels);
+        ospResetAccumulation(slot.framebuffer);
+
+        slot.ownsCamera = i > 0;
+        if (slot.ownsCamera)
+        {
+            slot.camera = ospNewCamera("perspective");
+            ospSetFloat(slot.camera, "aspect", ((float) imgSize.x) / ((float) imgSize.y));
+            ospSetParam(slot.camera, "up", OSP_VEC3F, camUp);
+        }
+        else
+        {
+            slot.camera = camera;
+        }
+    }
+
+    std::vector<uint64_t> keys;
+    if (cache)
+        keys = frameKeys(poses, camUp, imgSize, sink.format(), options);
+    size_t cacheHits = 0;
+    size_t resumed = 0;
+
+    Clock::time_point start = Clock::now();
+    size_t next = first;
+
+    // The next frame to render: the next in order, or in farm mode
+    // whichever frame no worker has claimed yet. Frames an earlier run
+    // finished are skipped.
+    auto claim = [&](size_t &frame)
+    {
+        for (;;)
+        {
+            if (inMovieFarm())
+            {
+                if (!claimFarmFrame(first, end, frame))
+                    return false;
+            }
+            else
+            {
+                if (next >= end)
+                    return false;
+                frame = next++;
+            }
+
+            if (!journal || !journal->contains(frame) ||
+                !sink.verifyFrame(frame, imgSize.x, imgSize.y))
+                return true;
+            ++resumed;
+        }
+    };
+
+    // With prefetchFrame, the frame after the one launched is claimed
+    // as soon as that one is prepared, and launched next.
+    bool haveAhead = false;
+    size_t ahead = 0;
+
+    // Start rendering the next frame in slot. Returns false, leaving
+    // the slot idle, when there are no frames left.
+    auto launch = [&](RenderSlot &slot)
+    {
+        Clock::time_point start = Clock::now();
+
+        size_t frame;
+        if (haveAhead)
+        {
+            frame = ahead;
+            haveAhead = false;
+        }
+        else if (!claim(frame))
+        {
+            return false;
+        }
+        slot.fIdx   = frame;
+        slot.passes = 0;
+
+        slot.fromCache = false;
+        if (cache)
+        {
+            slot.cachedPixels.resize((size_t)imgSize.x * imgSize.y *
+                                     framePixelBytes(sink.format()));
+            slot.fromCache = cache->load(keys[frame], slot.cachedPixels.data(),
+                                         slot.cachedPixels.size());
+            if (slot.fromCache)
+                return true;
+        }
+
+        const CameraPose &pose = poses[frame];
+        if (options.prepareFrame)
+        {
+            options.prepareFrame(slot.fIdx, pose);
+            if (options.prefetchFrame)
+            {
+                haveAhead = claim(ahead);
+                if (haveAhead)
+                    options.prefetchFrame((int)ahead);
+            }
+            if (timings)
+                timings->record(slot.fIdx, STAGE_PREPARE,
+                                FrameTimings::secondsSince(start));
+            start = Clock::now();
+        }
+
+        ospSetParam(slot.camera, "position", OSP_VEC3F, pose.position);
+        ospSetParam(slot.camera, "direction", OSP_VEC3F, pose.direction);
+        ospCommit(slot.camera);
+
+        slot.renderStart = Clock::now();
+        if (timings)
+            timings->record(slot.fIdx, STAGE_CAMERA_COMMIT,
+                std::chrono::duration<double>(slot.renderStart - start).count());
+
+        slot.future = ospRenderFrame(slot.framebuffer, renderer, slot.camera, world);
+        return true;
+    };
+
+    // Whether a slot's frame is done accumulating. If not, another
+    // pass is started on the same pose.
+    auto converged = [&](RenderSlot &slot)
+    {
+        ++slot.passes;
+        if (!adaptive)
+            return true;
+
+        slot.variance = ospGetVariance(slot.framebuffer);
+        if (slot.variance <= options.varianceThreshold ||
+            slot.passes >= options.maxAccumulation)
+            return true;
+
+        slot.future = ospRenderFrame(slot.framebuffer, renderer, slot.camera, world);
+        return false;
+    };
+
+    long totalPasses = 0;
+    size_t done = 0;
+
+    // Cached frames don't count: the startup profile wants a render.
+    bool firstRendered = false;
+
+    {
+        FrameOutput output(imgSize, sink, options, timings, cache, keys, journal);
+
+        size_t active = 0;
+        for (RenderSlot &slot : slots)
+        {
+            slot.active = launch(slot);
+            active += slot.active;
+        }
+
+        // Slots are refilled round robin, so waiting on them in the same
+        // order finishes frames in the order they were claimed.
+        for (size_t turn = 0; active > 0; ++turn)
+        {
+            RenderSlot &slot = slots[turn % slots.size()];
+            if (!slot.active)
+                continue;
+
+            ++done;
+            countFarmFrame();
+
+            if (slot.fromCache)
+            {
+                if (logPoses)
+                {
+                    const CameraPose &pose = poses[slot.fIdx];
+                    printf("\nX: %f, Z: %f (cached)", pose.position.x, pose.position.z);
+                }
+
+                output.writeCached(slot.cachedPixels.data(), slot.fIdx);
+                ++cacheHits;
+
+                slot.active = launch(slot);
+                active -= !slot.active;
+                continue;
+            }
+
+            do
+            {
+                ospWait(slot.future, OSP_TASK_FINISHED);
+                ospRelease(slot.future);
+            } while (!converged(slot));
+
+            totalPasses += slot.passes;
+            double renderSeconds = FrameTimings::secondsSince(slot.renderStart);
+            if (timings)
+                timings->record(slot.fIdx, STAGE_RENDER, renderSeconds);
+            if (options.frameRendered)
+                options.frameRendered(renderSeconds);
+            if (!firstRendered && options.profileStartup)
+            {
+                firstRendered = true;
+                StartupProfiler::instance().record(STARTUP_FIRST_RENDER, nullptr,
+                                                   renderSeconds);
+                StartupProfiler::instance().report();
+            }
+
+            if (logPoses)
+            {
+                const CameraPose &pose = poses[slot.fIdx];
+                printf("\nX: %f, Z: %f", pose.position.x, pose.position.z);
+                if (adaptive)
+                    printf(", frame %i: %i passes, variance %f",
+                           slot.fIdx, slot.passes, slot.variance);
+            }
+
+            output.write(slot.framebuffer, slot.fIdx);
+
+            slot.active = launch(slot);
+            active -= !slot.active;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (journal && logPoses)
+        printf("\nResume: skipped %zu frames finished by an earlier run\n", resumed);
+
+    if (cache && logPoses)
+        printf("\nFrame cache: %zu of %zu frames reused\n", cacheHits, done);
+
+    if (adaptive && logPoses && done > 0)
+        printf("\nAdaptive accumulation: %li passes for %zu frames (%.2f per frame)\n",
+               totalPasses, done, (double)totalPasses / done);
+
+    for (RenderSlot &slot : slots)
+    {
+        ospRelease(slot.framebuffer);
+        if (slot.ownsCamera)
+            ospRelease(slot.camera);
+    }
+
+    return seconds;
+}
+
+}
+
+
+void makeMovieFrames(OSPWorld world,
+                     ospcommon::math::vec3f camPos,
+                     ospcommon::math::vec3f camView,
+                     ospcommon::math::vec3f camUp,
+                     ospcommon::math::vec3f objCent,
+                     ospcommon::math::vec2i imgSize,
+                     OSPRenderer renderer,
+                     OSPCamera camera,
+                     float stepSize,
+                     const MovieOptions &options)
+{
+    std::vector<CameraPose> poses;
+    if (options.pathFile.empty())
+        poses = orbitPath(camPos, camView, objCent, stepSize);
+    else if (!loadCameraPath(options.pathFile, poses))
+        return;
+
+    size_t first = std::min<size_t>(options.firstFrame, poses.size());
+    size_t end   = options.endFrame < 0 ? poses.size()
+                                        : std::min<size_t>(options.endFrame, poses.size());
+    if (first >= end)
+    {
+        fprintf(stderr, "No frames to render: the path has %zu frames, asked for %d:%d\n",
+                poses.size(), options.firstFrame, options.endFrame);
+        return;
+    }
+
+    if (options.inflightScan)
+    {
+        if (options.prepareFrame)
+        {
+            fprintf(stderr, "--inflight-scan can't be used with a scene that "
+                    "changes per frame\n");
+            return;
+        }
+
+        // Frames are discarded so the scan measures rendering only.
+        std::unique_ptr<FrameSink> sink = createFrameSink("null");
+        double baseline = 0.0;
+
+        printf("inflight  frames/s  speedup\n");
+        for (int inflight = 1; inflight <= 8; ++inflight)
+        {
+            double seconds = renderPoses(world, renderer, camera, camUp, imgSize,
+                                         poses, first, end, inflight, *sink,
+                                         options, nullptr, nullptr, nullptr, false);
+            double rate = (end - first) / seconds;
+            if (inflight == 1)
+                baseline = rate;
+
+            printf("%8i  %8.2f  %7.2f\n", inflight, rate, rate / baseline);
+        }
+        return;
+    }
+
+    std::unique_ptr<FrameSink> sink =
+        createFrameSink(options.sink.spec, options.sink.dir);
+    if (!sink)
+        return;
+
+    // Farm workers each write their own timings, as FILE.<worker>.
+    std::string timingsFile = options.timingsFile;
+    if (!timingsFile.empty() && inMovieFarm())
+        timingsFile += "." + std::to_string(movieFarmWorker());
+
+    std::unique_ptr<FrameTimings> timings;
+    if (!timingsFile.empty())
+        timings.reset(new FrameTimings());
+
+    std::unique_ptr<FrameCache> cache;
+    if (!options.cacheDir.empty())
+    {
+        if (options.sceneKey.empty())
+            fprintf(stderr, "This demo sets no scene key; not using the frame cache\n");
+        else
+            cache.reset(new FrameCache(options.cacheDir));
+
+        if (cache && !cache->ok())
+            cache.reset();
+    }
+
+    std::unique_ptr<FrameJournal> journal;
+    if (options.resume)
+    {
+        if (isStreamingFrameSink(options.sink.spec) || options.sink.spec == "null")
+        {
+            fprintf(stderr, "--resume needs a sink that writes frame files\n");
+            return;
+        }
+
+        const std::string &dir = options.sink.dir;
+        journal.reset(new FrameJournal((dir.empty() ? "" : dir + "/") + ".progress"));
+        if (!journal->ok())
+            return;
+    }
+
+    if (options.prepareFrame && options.inflight > 1)
+        printf("This scene changes per frame; rendering one frame at a time\n");
+
+    renderPoses(world, renderer, camera, camUp, imgSize, poses, first, end,
+                options.inflight, *sink, options, timings.get(), cache.get(),
+                journal.get());
+
+    if (timings)
+    {
+        timings->printSummary();
+        timings->write(timingsFile);
+    }
+}
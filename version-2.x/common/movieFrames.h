@@ -0,0 +1,157 @@
+//
+// Movie generation shared by the version 2.x demos. All code is
+// written using OSPRay's C interface; demos using the CPP interface
+// pass in the underlying handles.
+//
+
+#ifndef OSPRAY_DEMOS_MOVIE_FRAMES_H
+#define OSPRAY_DEMOS_MOVIE_FRAMES_H
+
+#include <functional>
+#include <string>
+#include <stdint.h>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "cameraPath.h"
+#include "frameSink.h"
+
+//
+// Options controlling how makeMovieFrames renders and writes frames.
+//
+struct MovieOptions
+{
+    // Overlap frame writes with rendering of the next frame.
+    bool pipelined;
+
+    // Number of staging buffers available to the background writer.
+    int  stagingBuffers;
+
+    // Number of frames rendering at once, each with its own
+    // framebuffer and camera.
+    int  inflight;
+
+    // Render the movie with 1 to 8 frames in flight and report the
+    // throughput of each instead of writing frames.
+    bool inflightScan;
+
+    // Keep accumulating a frame until OSPRay's variance estimate drops
+    // to this threshold, or maxAccumulation passes have been rendered.
+    // Zero renders every frame once.
+    float varianceThreshold;
+    int   maxAccumulation;
+
+    // Write the time each stage of each frame took to this file (CSV,
+    // or JSON if it ends in .json) and print a summary. Empty disables
+    // timing.
+    std::string timingsFile;
+
+    // Reuse frames rendered by earlier runs from this directory, and
+    // add newly rendered ones to it. Empty disables the cache.
+    std::string cacheDir;
+
+    // Describes everything about the scene and renderer that affects
+    // the image, as the frame cache can't look inside OSPRay objects.
+    // Demos build it from the values they set (see sceneKey.h). The
+    // cache is only used when it is set.
+    std::string sceneKey;
+
+    // Print where the time before the first frame went (see
+    // startupProfiler.h).
+    bool profileStartup;
+
+    // Follow the keyframed path in this file (see cameraPath.h) instead
+    // of the demo's orbit. Empty keeps the orbit.
+    std::string pathFile;
+
+    // Render only frames [firstFrame, endFrame) of the path, numbered
+    // as in the whole movie. A negative endFrame means the last frame.
+    int firstFrame;
+    int endFrame;
+
+    // Make every written frame durable and note it in a journal,
+    // <frames dir>/.progress, then skip frames the journal lists whose
+    // files are still complete. Lets an interrupted render pick up
+    // where it stopped. Only for file sinks; delete the journal, or use
+    // a fresh frames dir, after changing the scene.
+    bool resume;
+
+    // Where frames go.
+    FrameSinkOptions sink;
+
+    // Called with each frame's number and pose before it renders, for
+    // scenes that change with the view or over time, such as bricked
+    // volumes (see brickedVolume.h) and time series. Demos set this.
+    // Frames then render one at a time, whatever inflight says, as the
+    // scene can't change under a frame that is still rendering.
+    std::function<void(int frame, const CameraPose &pose)> prepareFrame;
+
+    // Called after prepareFrame with the frame this process renders
+    // next, for demos that read ahead, such as time series. In farm
+    // mode (see movieFarm.h) that frame is claimed early for it, as
+    // workers take frames from a shared queue in no fixed order.
+    std::function<void(int frame)> prefetchFrame;
+
+    // Called with each frame's render time once it has rendered, for
+    // demos that break render times down by the scene prepareFrame set
+    // up. Frames from the cache aren't counted.
+    std::function<void(double seconds)> frameRendered;
+
+    MovieOptions()
+        : pipelined(false),
+          stagingBuffers(3),
+          inflight(1),
+          inflightScan(false),
+          varianceThreshold(0.0f),
+          maxAccumulation(64),
+          profileStartup(false),
+          firstFrame(0),
+          endFrame(-1),
+          resume(false)
+    {}
+};
+
+//
+// Read movie options from the command line. This should be called
+// after ospInit so that OSPRay's own arguments have been removed.
+// --farm is handled by startMovieFarm, before ospInit.
+//
+//   --pipelined            write frames on a background thread
+//   --staging-buffers N    number of staging buffers (default 3)
+//   --inflight K           render K frames at once (default 1)
+//   --inflight-scan        report frames/s for K = 1..8, writing nothing
+//   --adaptive T           accumulate each frame until its variance <= T
+//   --max-samples N        cap adaptive accumulation at N passes (default 64)
+//   --timings FILE         per-frame stage times as CSV, or JSON for *.json
+//   --cache-dir DIR        reuse frames cached in DIR by earlier runs
+//   --profile-startup      report the time to the first frame by phase
+//   --path FILE            follow the camera path in FILE, see cameraPath.h
+//   --frames B:E           render frames B up to (not including) E; either
+//                          end may be left out
+//   --resume               sync frames and skip ones an earlier run finished
+//   --farm N               render with N worker processes, see movieFarm.h
+//   --sink SPEC            frame sink, see frameSink.h (default ppm)
+//   --frames-dir DIR       output directory for file sinks (default frames)
+//
+MovieOptions parseMovieOptions(int argc, const char **argv);
+
+//
+// Generate frames for a movie by orbiting the camera around objCent,
+// or along the path file given in options. Frames are handed to the
+// frame sink selected in options. When more
+// than one frame is in flight, the extra frames render with
+// perspective cameras that share the image aspect and camUp.
+//
+void makeMovieFrames(OSPWorld world,
+                     ospcommon::math::vec3f camPos,
+                     ospcommon::math::vec3f camView,
+                     ospcommon::math::vec3f camUp,
+                     ospcommon::math::vec3f objCent,
+                     ospcommon::math::vec2i imgSize,
+                     OSPRenderer renderer,
+                     OSPCamera camera,
+                     float stepSize = 1.0,
+                     const MovieOptions &options = MovieOptions());
+
+#endif
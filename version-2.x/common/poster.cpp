@@ -0,0 +1,158 @@
+//
+// Poster mode for the version 2.x demos.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "poster.h"
+#include "pixelPack.h"
+#include "startupProfiler.h"
+
+PosterOptions parsePosterOptions(int argc, const char **argv)
+{
+    PosterOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--poster") == 0 && i + 1 < argc)
+        {
+            const char *size = argv[++i];
+            if (sscanf(size, "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0)
+            {
+                fprintf(stderr, "Bad --poster '%s', expected WIDTHxHEIGHT\n", size);
+                options.width = options.height = 0;
+            }
+        }
+        else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc)
+            options.tileSize = std::max(16, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--poster-passes") == 0 && i + 1 < argc)
+            options.passes = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--poster-file") == 0 && i + 1 < argc)
+            options.fileName = argv[++i];
+        else if (strcmp(argv[i], "--profile-startup") == 0)
+            options.profileStartup = true;
+    }
+
+    return options;
+}
+
+
+bool renderPoster(OSPWorld world,
+                  OSPRenderer renderer,
+                  OSPCamera camera,
+                  const PosterOptions &options)
+{
+    const int width    = options.width;
+    const int height   = options.height;
+    const int tileSize = options.tileSize;
+
+    FILE *file = fopen(options.fileName.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "fopen('%s', 'wb') failed: %d\n", options.fileName.c_str(), errno);
+        return false;
+    }
+    fprintf(file, "P6\n%i %i\n255\n", width, height);
+
+    ospSetFloat(camera, "aspect", (float)width / (float)height);
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    // One band of tiles, packed to RGB with the top row first.
+    const size_t rowBytes = 3 * (size_t)width;
+    std::vector<unsigned char> band(rowBytes * std::min(tileSize, height));
+
+    OSPFrameBuffer framebuffer = nullptr;
+    int fbWidth  = 0;
+    int fbHeight = 0;
+
+    const int numBands = (height + tileSize - 1) / tileSize;
+    bool ok = true;
+
+    // Bands go from the top of the image down, so rows reach the file
+    // in order. The camera's image window has its origin at the bottom.
+    for (int b = 0; b < numBands && ok; ++b)
+    {
+        int yEnd   = height - b * tileSize;
+        int yStart = std::max(0, yEnd - tileSize);
+        int bandHeight = yEnd - yStart;
+
+        for (int xStart = 0; xStart < width; xStart += tileSize)
+        {
+            int xEnd = std::min(width, xStart + tileSize);
+            int tileWidth = xEnd - xStart;
+
+            // Only the tiles at the right and bottom edges differ in size.
+            if (tileWidth != fbWidth || bandHeight != fbHeight)
+            {
+                if (framebuffer)
+                    ospRelease(framebuffer);
+                framebuffer = ospNewFrameBuffer(tileWidth, bandHeight, OSP_FB_SRGBA,
+                                                OSP_FB_COLOR | OSP_FB_ACCUM);
+                fbWidth  = tileWidth;
+                fbHeight = bandHeight;
+            }
+            ospResetAccumulation(framebuffer);
+
+            float imageStart[2] = {(float)xStart / width, (float)yStart / height};
+            float imageEnd[2]   = {(float)xEnd / width, (float)yEnd / height};
+            ospSetParam(camera, "imageStart", OSP_VEC2F, imageStart);
+            ospSetParam(camera, "imageEnd", OSP_VEC2F, imageEnd);
+            ospCommit(camera);
+
+            Clock::time_point tileStart = Clock::now();
+            for (int pass = 0; pass < options.passes; ++pass)
+            {
+                OSPFuture future = ospRenderFrame(framebuffer, renderer, camera, world);
+                ospWait(future, OSP_TASK_FINISHED);
+                ospRelease(future);
+            }
+            if (options.profileStartup && b == 0 && xStart == 0)
+            {
+                StartupProfiler::instance().record(STARTUP_FIRST_RENDER, nullptr,
+                    std::chrono::duration<double>(Clock::now() - tileStart).count());
+                StartupProfiler::instance().report();
+            }
+
+            const uint32_t *fb = (const uint32_t *)ospMapFrameBuffer(framebuffer, OSP_FB_COLOR);
+            packRGBFlipped(fb, tileWidth, bandHeight, band.data() + 3 * (size_t)xStart,
+                           PIXEL_PACK_BEST, rowBytes);
+            ospUnmapFrameBuffer(fb, framebuffer);
+        }
+
+        if (fwrite(band.data(), rowBytes, bandHeight, file) != (size_t)bandHeight)
+        {
+            fprintf(stderr, "Writing poster '%s' failed: %d\n", options.fileName.c_str(), errno);
+            ok = false;
+        }
+
+        printf("\rPoster: band %i of %i", b + 1, numBands);
+        fflush(stdout);
+    }
+
+    if (framebuffer)
+        ospRelease(framebuffer);
+
+    fputc('\n', file);
+    if (fclose(file) != 0 || !ok)
+    {
+        fprintf(stderr, "Writing poster '%s' failed\n", options.fileName.c_str());
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("\nPoster: %ix%i in %ix%i tiles to '%s' in %.2f s, "
+           "band buffer %.1f MB\n",
+           width, height, std::min(tileSize, width), std::min(tileSize, height),
+           options.fileName.c_str(), seconds, band.size() / (1024.0 * 1024.0));
+    return true;
+}
@@ -0,0 +1,71 @@
+//
+// Poster mode for the version 2.x demos: one very large still image,
+// rendered a tile at a time. Each tile renders into its own small
+// framebuffer through the camera's imageStart/imageEnd window, and a
+// finished band of tiles goes straight out to the poster file, top row
+// first. Memory use depends on the tile size and poster width, not on
+// the poster's area, so a 16K x 16K poster needs tens of megabytes
+// rather than gigabytes of framebuffer and accumulation buffers.
+//
+
+#ifndef OSPRAY_DEMOS_POSTER_H
+#define OSPRAY_DEMOS_POSTER_H
+
+#include <string>
+
+#include "ospray/ospray.h"
+
+struct PosterOptions
+{
+    // Poster size in pixels. Zero disables poster mode.
+    int width;
+    int height;
+
+    // Tiles are at most tileSize x tileSize pixels.
+    int tileSize;
+
+    // Accumulated passes per tile.
+    int passes;
+
+    // The binary PPM file the poster is written to.
+    std::string fileName;
+
+    // Print the startup profile after the first tile.
+    bool profileStartup;
+
+    PosterOptions()
+        : width(0),
+          height(0),
+          tileSize(1024),
+          passes(1),
+          fileName("poster.ppm"),
+          profileStartup(false)
+    {}
+
+    bool enabled() const { return width > 0 && height > 0; }
+};
+
+//
+// Read poster options from the command line.
+//
+//   --poster WxH           render a W x H poster instead of a movie
+//   --tile N               tile size in pixels (default 1024)
+//   --poster-passes N      accumulated passes per tile (default 1)
+//   --poster-file FILE     where the poster goes (default poster.ppm)
+//   --profile-startup      report the time to the first tile by phase
+//                          (see startupProfiler.h)
+//
+PosterOptions parsePosterOptions(int argc, const char **argv);
+
+//
+// Render the world as seen by camera, a perspective camera already
+// committed with the pose the demo wants, into a poster. The camera's
+// aspect ratio is set to the poster's and its image window is changed
+// for every tile. Returns false if the poster could not be written.
+//
+bool renderPoster(OSPWorld world,
+                  OSPRenderer renderer,
+                  OSPCamera camera,
+                  const PosterOptions &options);
+
+#endif
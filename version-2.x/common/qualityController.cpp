@@ -0,0 +1,269 @@
+//
+// Renderer quality adjusted to a frame time budget.
+//
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qualityController.h"
+#include "movieFarm.h"
+
+namespace {
+
+//
+// Parse LO:HI into bounds, either of which may be left out.
+//
+void parseBounds(const char *flag, const char *text, float bounds[2])
+{
+    const char *colon = strchr(text, ':');
+    if (colon == nullptr)
+    {
+        fprintf(stderr, "Bad %s '%s', expected LO:HI\n", flag, text);
+        return;
+    }
+    bounds[0] = colon > text ? atof(text) : -1.0f;
+    bounds[1] = colon[1] ? atof(colon + 1) : -1.0f;
+}
+
+// A frame within this fraction of the target counts as on target.
+const double tolerance = 0.1;
+
+}
+
+
+QualityOptions parseQualityOptions(int argc, const char **argv)
+{
+    QualityOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--target-ms") == 0 && i + 1 < argc)
+            options.targetMs = std::max(0.0f, (float)atof(argv[++i]));
+        else if (strcmp(argv[i], "--pixel-samples") == 0 && i + 1 < argc)
+            parseBounds("--pixel-samples", argv[++i], options.pixelSamples);
+        else if (strcmp(argv[i], "--ao-samples") == 0 && i + 1 < argc)
+            parseBounds("--ao-samples", argv[++i], options.aoSamples);
+        else if (strcmp(argv[i], "--sampling-rate") == 0 && i + 1 < argc)
+            parseBounds("--sampling-rate", argv[++i], options.samplingRate);
+        else if (strcmp(argv[i], "--quality-log") == 0 && i + 1 < argc)
+            options.logFile = argv[++i];
+    }
+
+    return options;
+}
+
+
+QualityController::QualityController(OSPRenderer renderer, const QualityOptions &options,
+                                     SceneKey *sceneKey)
+    : renderer(renderer),
+      options(options),
+      sceneKey(sceneKey),
+      csv(nullptr),
+      quality(0.5f),
+      secondsPerCost(0.0),
+      frame(0),
+      frames(0),
+      onTarget(0),
+      totalSeconds(0.0)
+{}
+
+
+QualityController::~QualityController()
+{
+    if (csv)
+        fclose(csv);
+}
+
+
+void QualityController::setInt(const char *name, int value)
+{
+    if (sceneKey)
+        sceneKey->setInt(renderer, name, value);
+    else
+        ospSetInt(renderer, name, value);
+    add(name, true, value);
+}
+
+
+void QualityController::setFloat(const char *name, float value)
+{
+    if (sceneKey)
+        sceneKey->setFloat(renderer, name, value);
+    else
+        ospSetFloat(renderer, name, value);
+    add(name, false, value);
+}
+
+
+void QualityController::add(const char *name, bool integer, float value)
+{
+    // The bounds given for the parameter, and its default lower bound.
+    const float *bounds;
+    float lo = 1.0f;
+    if (strcmp(name, "pixelSamples") == 0)
+        bounds = options.pixelSamples;
+    else if (strcmp(name, "aoSamples") == 0)
+        bounds = options.aoSamples;
+    else if (strcmp(name, "volumeSamplingRate") == 0)
+    {
+        bounds = options.samplingRate;
+        lo = value / 8.0f;
+    }
+    else
+        return;
+
+    // Costs are compared as products, so every bound must be positive.
+    Parameter parameter;
+    parameter.name    = name;
+    parameter.integer = integer;
+    parameter.lo      = std::max(bounds[0] >= 0.0f ? bounds[0] : lo,
+                                 integer ? 1.0f : 0.001f);
+    parameter.hi      = std::max(bounds[1] >= 0.0f ? bounds[1] : value, parameter.lo);
+    parameter.value   = value;
+    parameters.push_back(parameter);
+}
+
+
+void QualityController::attach(MovieOptions &movieOptions)
+{
+    if (!options.enabled())
+        return;
+
+    if (!options.logFile.empty())
+    {
+        // Farm workers each write their own log, as FILE.<worker>.
+        std::string logFile = options.logFile;
+        if (inMovieFarm())
+            logFile += "." + std::to_string(movieFarmWorker());
+
+        csv = fopen(logFile.c_str(), "w");
+        if (csv == nullptr)
+            fprintf(stderr, "fopen('%s', 'w') failed: %d\n", logFile.c_str(), errno);
+        else
+        {
+            fprintf(csv, "frame,render_ms,target_ms");
+            for (const Parameter &parameter : parameters)
+                fprintf(csv, ",%s", parameter.name.c_str());
+            fprintf(csv, "\n");
+        }
+    }
+
+    char key[64];
+    snprintf(key, sizeof(key), ", quality for %g ms", options.targetMs);
+    movieOptions.sceneKey += key;
+    for (const Parameter &parameter : parameters)
+    {
+        snprintf(key, sizeof(key), " %s %g:%g", parameter.name.c_str(),
+                 parameter.lo, parameter.hi);
+        movieOptions.sceneKey += key;
+    }
+
+    // The renderer changes between frames, so they render one at a time.
+    std::function<void(int, const CameraPose &)> prepareFrame = movieOptions.prepareFrame;
+    movieOptions.prepareFrame = [this, prepareFrame](int frame, const CameraPose &pose)
+    {
+        if (prepareFrame)
+            prepareFrame(frame, pose);
+        prepare(frame);
+    };
+
+    std::function<void(double)> frameRendered = movieOptions.frameRendered;
+    movieOptions.frameRendered = [this, frameRendered](double seconds)
+    {
+        if (frameRendered)
+            frameRendered(seconds);
+        rendered(seconds);
+    };
+}
+
+
+void QualityController::prepare(int frame)
+{
+    this->frame = frame;
+
+    // Each parameter moves the same fraction of its range in log terms,
+    // so the cost, their product, spans its own range evenly.
+    for (Parameter &parameter : parameters)
+    {
+        float value = parameter.lo * powf(parameter.hi / parameter.lo, quality);
+        if (parameter.integer)
+        {
+            parameter.value = std::min(parameter.hi, std::max(parameter.lo, roundf(value)));
+            ospSetInt(renderer, parameter.name.c_str(), (int)parameter.value);
+        }
+        else
+        {
+            parameter.value = value;
+            ospSetFloat(renderer, parameter.name.c_str(), value);
+        }
+    }
+    ospCommit(renderer);
+}
+
+
+void QualityController::rendered(double seconds)
+{
+    const double target = options.targetMs / 1000.0;
+
+    ++frames;
+    totalSeconds += seconds;
+    if (fabs(seconds - target) <= tolerance * target)
+        ++onTarget;
+
+    if (csv)
+    {
+        fprintf(csv, "%d,%.3f,%g", frame, 1000.0 * seconds, options.targetMs);
+        for (const Parameter &parameter : parameters)
+            fprintf(csv, ",%g", parameter.value);
+        fprintf(csv, "\n");
+    }
+    else
+    {
+        printf("\nframe %d: %.1f ms,", frame, 1000.0 * seconds);
+        for (const Parameter &parameter : parameters)
+            printf(" %s %g", parameter.name.c_str(), parameter.value);
+    }
+
+    //
+    // Render time is taken to scale with the product of the parameters.
+    // Measure the time per unit of that cost, weighted towards this
+    // frame as the view changes but averaged with the frames before so
+    // one odd frame doesn't swing the next, and pick the quality whose
+    // cost fits the target. Where the model is wrong the next frame's
+    // measurement corrects it.
+    //
+    double logCost = 0.0, logLo = 0.0, logRange = 0.0;
+    for (const Parameter &parameter : parameters)
+    {
+        logCost  += log(parameter.value);
+        logLo    += log(parameter.lo);
+        logRange += log(parameter.hi / parameter.lo);
+    }
+    if (logRange <= 0.0 || seconds <= 0.0)
+        return;
+
+    double measured = seconds / exp(logCost);
+    secondsPerCost = frames == 1 ? measured
+                                 : 0.25 * secondsPerCost + 0.75 * measured;
+
+    double wanted = (log(target / secondsPerCost) - logLo) / logRange;
+    quality = (float)std::min(1.0, std::max(0.0, wanted));
+}
+
+
+void QualityController::printSummary() const
+{
+    if (!options.enabled() || frames == 0)
+        return;
+
+    printf("\nQuality control: %zu frames rendered in %.1f ms on average for a "
+           "target of %g ms, %zu within %.0f%%\n",
+           frames, 1000.0 * totalSeconds / frames, options.targetMs, onTarget,
+           100.0 * tolerance);
+    for (const Parameter &parameter : parameters)
+        printf("  %-20s %g to %g, last %g\n", parameter.name.c_str(),
+               parameter.lo, parameter.hi, parameter.value);
+}
@@ -0,0 +1,128 @@
+//
+// A frame time budget for movies: between frames, the renderer's
+// quality parameters (pixelSamples, aoSamples, volumeSamplingRate) are
+// raised or lowered within bounds so each frame renders in about a
+// target time, however the cost of the view changes as the camera
+// moves. Meant for batch movie jobs with a deadline, where a steady
+// frame rate matters more than a fixed sample count.
+//
+
+#ifndef OSPRAY_DEMOS_QUALITY_CONTROLLER_H
+#define OSPRAY_DEMOS_QUALITY_CONTROLLER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "ospray/ospray.h"
+
+#include "movieFrames.h"
+#include "sceneKey.h"
+
+struct QualityOptions
+{
+    // Render time each frame aims for. Zero leaves the demo's settings
+    // alone.
+    float targetMs;
+
+    // Bounds on each parameter. A negative bound takes its default.
+    float pixelSamples[2];
+    float aoSamples[2];
+    float samplingRate[2];
+
+    // Write each frame's settings and render time here as CSV. Empty
+    // prints them instead.
+    std::string logFile;
+
+    QualityOptions()
+        : targetMs(0.0f),
+          pixelSamples{-1.0f, -1.0f},
+          aoSamples{-1.0f, -1.0f},
+          samplingRate{-1.0f, -1.0f}
+    {}
+
+    bool enabled() const { return targetMs > 0.0f; }
+};
+
+//
+// Read quality options from the command line.
+//
+//   --target-ms T          adjust quality so frames render in about T ms
+//   --pixel-samples LO:HI  pixelSamples bounds (default 1 to the demo's)
+//   --ao-samples LO:HI     aoSamples bounds (default 1 to the demo's)
+//   --sampling-rate LO:HI  volumeSamplingRate bounds (default 1/8 of the
+//                          demo's to the demo's)
+//   --quality-log FILE     per-frame settings and render times as CSV
+//
+QualityOptions parseQualityOptions(int argc, const char **argv);
+
+class QualityController
+{
+  public:
+    //
+    // Control the quality of renderer, which must outlive this object,
+    // as does sceneKey, if given, which the demo's values are added to.
+    //
+    QualityController(OSPRenderer renderer, const QualityOptions &options,
+                      SceneKey *sceneKey = nullptr);
+
+    ~QualityController();
+
+    QualityController(const QualityController &) = delete;
+    QualityController &operator=(const QualityController &) = delete;
+
+    //
+    // Set an int or float renderer parameter to the demo's value. With
+    // a target, pixelSamples, aoSamples and volumeSamplingRate are then
+    // adjusted between their bounds, starting halfway between them so
+    // the first frame is neither the slowest nor the worst. The
+    // renderer still needs committing.
+    //
+    void setInt(const char *name, int value);
+    void setFloat(const char *name, float value);
+
+    //
+    // Adjust the renderer before each of the movie's frames, from the
+    // render times of the ones before, and note the target in the scene
+    // key. Call after the demo's own hooks are set; they still run
+    // first. Does nothing without a target.
+    //
+    void attach(MovieOptions &movieOptions);
+
+    //
+    // Print how close the frames came to the target.
+    //
+    void printSummary() const;
+
+  private:
+    struct Parameter
+    {
+        std::string name;
+        bool        integer;
+        float       lo;
+        float       hi;
+        float       value;
+    };
+
+    void add(const char *name, bool integer, float value);
+    void prepare(int frame);
+    void rendered(double seconds);
+
+    OSPRenderer            renderer;
+    QualityOptions         options;
+    SceneKey              *sceneKey;
+    std::vector<Parameter> parameters;
+    FILE                  *csv;
+
+    // Quality from 0, every parameter at its lowest, to 1, every one at
+    // its highest, and the render time per unit of cost it measured.
+    float  quality;
+    double secondsPerCost;
+
+    int    frame;
+    size_t frames;
+    size_t onTarget;
+    double totalSeconds;
+};
+
+#endif
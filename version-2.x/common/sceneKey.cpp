@@ -0,0 +1,47 @@
+//
+// Scene keys for the frame cache.
+//
+
+#include <stdio.h>
+
+#include "sceneKey.h"
+
+
+void SceneKey::add(const char *name, const std::string &text)
+{
+    key += ", ";
+    key += name;
+    key += ' ';
+    key += text;
+}
+
+
+void SceneKey::setInt(OSPObject object, const char *name, int value)
+{
+    ospSetInt(object, name, value);
+    add(name, &value, 1);
+}
+
+
+void SceneKey::setFloat(OSPObject object, const char *name, float value)
+{
+    ospSetFloat(object, name, value);
+    add(name, &value, 1);
+}
+
+
+void SceneKey::setFloats(OSPObject object, const char *name, OSPDataType type,
+                         const float *values, size_t count)
+{
+    ospSetParam(object, name, type, values);
+    add(name, values, count);
+}
+
+
+void SceneKey::addNumber(char separator, double value)
+{
+    // Enough digits that no two floats print alike.
+    char number[32];
+    snprintf(number, sizeof(number), "%c%.9g", separator, value);
+    key += number;
+}
@@ -0,0 +1,65 @@
+//
+// Scene keys for the frame cache (see MovieOptions::sceneKey), built
+// from the values the demos set on their OSPRay objects rather than
+// described by hand, so a changed color, opacity or sample count can't
+// reuse frames rendered before the change.
+//
+
+#ifndef OSPRAY_DEMOS_SCENE_KEY_H
+#define OSPRAY_DEMOS_SCENE_KEY_H
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+#include "ospray/ospray.h"
+
+class SceneKey
+{
+  public:
+    explicit SceneKey(const std::string &scene)
+        : key(scene)
+    {}
+
+    //
+    // Add a part of the scene as ", name ...": text, such as a volume
+    // file's description, or every value of an array.
+    //
+    void add(const char *name, const std::string &text);
+
+    template <typename T>
+    void add(const char *name, const T *values, size_t count)
+    {
+        key += ", ";
+        key += name;
+        for (size_t i = 0; i < count; ++i)
+            addNumber(i == 0 ? ' ' : ',', (double)values[i]);
+    }
+
+    template <typename T>
+    void add(const char *name, const std::vector<T> &values)
+    {
+        add(name, values.data(), values.size());
+    }
+
+    //
+    // Set an object's parameter and add it to the key.
+    //
+    void setInt(OSPObject object, const char *name, int value);
+    void setFloat(OSPObject object, const char *name, float value);
+
+    //
+    // Set a vector parameter of type, count floats long, and add it.
+    //
+    void setFloats(OSPObject object, const char *name, OSPDataType type,
+                   const float *values, size_t count);
+
+    const std::string &str() const { return key; }
+
+  private:
+    void addNumber(char separator, double value);
+
+    std::string key;
+};
+
+#endif
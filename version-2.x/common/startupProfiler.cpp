@@ -0,0 +1,78 @@
+//
+// Time-to-first-pixel profiling of the version 2.x demos.
+//
+
+#include "startupProfiler.h"
+
+namespace {
+
+const char *phaseNames[STARTUP_PHASE_COUNT] = {
+    "device init",
+    "data creation",
+    "object commits",
+    "world commit",
+    "first render",
+};
+
+}
+
+
+StartupProfiler &StartupProfiler::instance()
+{
+    static StartupProfiler profiler;
+    return profiler;
+}
+
+
+StartupProfiler::StartupProfiler()
+    : start(Clock::now()),
+      reported(false)
+{
+    for (Tally &phase : phases)
+        phase = {0, 0.0};
+}
+
+
+void StartupProfiler::record(StartupPhase phase, const char *objectType, double seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    phases[phase].calls++;
+    phases[phase].seconds += seconds;
+
+    if (objectType)
+    {
+        Tally &tally = commitsByType.insert({objectType, {0, 0.0}}).first->second;
+        tally.calls++;
+        tally.seconds += seconds;
+    }
+}
+
+
+void StartupProfiler::report(FILE *out)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (reported)
+        return;
+    reported = true;
+
+    double total = std::chrono::duration<double>(Clock::now() - start).count();
+    double other = total;
+
+    fprintf(out, "\nStartup profile\n");
+    fprintf(out, "%-22s %10s %7s\n", "phase", "ms", "calls");
+    for (int phase = 0; phase < STARTUP_PHASE_COUNT; ++phase)
+    {
+        fprintf(out, "%-22s %10.3f %7i\n", phaseNames[phase],
+                1000.0 * phases[phase].seconds, phases[phase].calls);
+        other -= phases[phase].seconds;
+    }
+    fprintf(out, "%-22s %10.3f\n", "other", 1000.0 * other);
+    fprintf(out, "%-22s %10.3f\n", "time to first pixel", 1000.0 * total);
+
+    fprintf(out, "\n%-22s %10s %7s\n", "commits by type", "ms", "count");
+    for (const auto &type : commitsByType)
+        fprintf(out, "%-22s %10.3f %7i\n", type.first.c_str(),
+                1000.0 * type.second.seconds, type.second.calls);
+}
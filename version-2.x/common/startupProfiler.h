@@ -0,0 +1,156 @@
+//
+// Time-to-first-pixel profiling of the version 2.x demos. The demos
+// route their startup calls through the profiled* wrappers below,
+// which always record (the cost is a clock read per call); the report
+// is printed after the first frame or poster tile actually rendered,
+// not read from the frame cache, when --profile-startup is given.
+//
+
+#ifndef OSPRAY_DEMOS_STARTUP_PROFILER_H
+#define OSPRAY_DEMOS_STARTUP_PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ospray/ospray.h"
+
+enum StartupPhase
+{
+    STARTUP_DEVICE_INIT,   // ospInit, including module loading
+    STARTUP_DATA,          // creating shared data arrays
+    STARTUP_COMMITS,       // committing every object but the world
+    STARTUP_WORLD_COMMIT,  // committing the world (BVH builds)
+    STARTUP_FIRST_RENDER,  // rendering the first frame or poster tile
+    STARTUP_PHASE_COUNT
+};
+
+class StartupProfiler
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    //
+    // The process wide profiler. Its clock starts on first use, so
+    // demos should route ospInit through profiledInit.
+    //
+    static StartupProfiler &instance();
+
+    //
+    // Times the enclosing scope as one call in phase.
+    //
+    class Scope
+    {
+      public:
+        Scope(StartupPhase phase, const char *objectType = nullptr)
+            : phase(phase),
+              objectType(objectType),
+              start(Clock::now())
+        {}
+
+        ~Scope()
+        {
+            instance().record(phase, objectType,
+                std::chrono::duration<double>(Clock::now() - start).count());
+        }
+
+      private:
+        StartupPhase      phase;
+        const char       *objectType;
+        Clock::time_point start;
+    };
+
+    //
+    // Add one call of seconds to phase. Commits also name the type of
+    // object committed.
+    //
+    void record(StartupPhase phase, const char *objectType, double seconds);
+
+    //
+    // Print every phase, the time not spent in any of them, the total
+    // time to the first pixel and the commits per object type. Only
+    // the first call prints anything.
+    //
+    void report(FILE *out = stdout);
+
+  private:
+    StartupProfiler();
+
+    struct Tally
+    {
+        int    calls;
+        double seconds;
+    };
+
+    std::mutex                    mutex;
+    Clock::time_point             start;
+    Tally                         phases[STARTUP_PHASE_COUNT];
+    std::map<std::string, Tally>  commitsByType;
+    bool                          reported;
+};
+
+//
+// The OSPRay type name of a handle, for the commit counts.
+//
+inline const char *ospObjectTypeName(OSPCamera)           { return "camera"; }
+inline const char *ospObjectTypeName(OSPData)             { return "data"; }
+inline const char *ospObjectTypeName(OSPFrameBuffer)      { return "framebuffer"; }
+inline const char *ospObjectTypeName(OSPGeometricModel)   { return "geometricModel"; }
+inline const char *ospObjectTypeName(OSPGeometry)         { return "geometry"; }
+inline const char *ospObjectTypeName(OSPGroup)            { return "group"; }
+inline const char *ospObjectTypeName(OSPInstance)         { return "instance"; }
+inline const char *ospObjectTypeName(OSPLight)            { return "light"; }
+inline const char *ospObjectTypeName(OSPMaterial)         { return "material"; }
+inline const char *ospObjectTypeName(OSPRenderer)         { return "renderer"; }
+inline const char *ospObjectTypeName(OSPTransferFunction) { return "transferFunction"; }
+inline const char *ospObjectTypeName(OSPVolume)           { return "volume"; }
+inline const char *ospObjectTypeName(OSPVolumetricModel)  { return "volumetricModel"; }
+inline const char *ospObjectTypeName(OSPWorld)            { return "world"; }
+
+//
+// ospInit, timed as device initialization.
+//
+inline OSPError profiledInit(int *argc, const char **argv)
+{
+    StartupProfiler::Scope scope(STARTUP_DEVICE_INIT);
+    return ospInit(argc, argv);
+}
+
+//
+// ospCommit, timed as an object commit of obj's type. Worlds are
+// timed separately, as that is where acceleration structures are
+// built.
+//
+template <typename T>
+inline void profiledCommit(T obj)
+{
+    const char *type = ospObjectTypeName(obj);
+    StartupProfiler::Scope scope(
+        std::is_same<T, OSPWorld>::value ? STARTUP_WORLD_COMMIT : STARTUP_COMMITS,
+        type);
+    ospCommit(obj);
+}
+
+inline OSPData profiledSharedData1D(const void *data,
+                                    OSPDataType type,
+                                    uint64_t numItems)
+{
+    StartupProfiler::Scope scope(STARTUP_DATA);
+    return ospNewSharedData1D(data, type, numItems);
+}
+
+inline OSPData profiledSharedData3D(const void *data,
+                                    OSPDataType type,
+                                    uint64_t numItems1,
+                                    uint64_t numItems2,
+                                    uint64_t numItems3)
+{
+    StartupProfiler::Scope scope(STARTUP_DATA);
+    return ospNewSharedData3D(data, type, numItems1, numItems2, numItems3);
+}
+
+#endif
@@ -0,0 +1,177 @@
+//
+// The voxels a structured volume demo renders.
+//
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include "volumeSource.h"
+#include "startupProfiler.h"
+#include "voxelQuantize.h"
+
+OSPDataType ospVoxelType(VoxelType type)
+{
+    switch (type)
+    {
+    case VOXEL_UINT8:  return OSP_UCHAR;
+    case VOXEL_UINT16: return OSP_USHORT;
+    case VOXEL_DOUBLE: return OSP_DOUBLE;
+    default:           return OSP_FLOAT;
+    }
+}
+
+
+VoxelType parseStorageVoxelType(int argc, const char **argv)
+{
+    VoxelType storageType = VOXEL_FLOAT;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--voxel-type") == 0 && i + 1 < argc)
+        {
+            VoxelType type;
+            if (parseVoxelType(argv[++i], type) &&
+                (type == VOXEL_UINT8 || type == VOXEL_UINT16))
+                storageType = type;
+            else
+                fprintf(stderr, "Bad --voxel-type '%s' (expected uint8 or uint16)\n",
+                        argv[i]);
+        }
+    }
+    return storageType;
+}
+
+
+ospcommon::math::vec3f volumeSpacing(const VolumeDims &dims)
+{
+    float voxelSize = 10.0f / std::max(dims.x, std::max(dims.y, dims.z));
+    return {voxelSize, voxelSize, voxelSize};
+}
+
+
+ospcommon::math::vec3f volumeOrigin(const VolumeDims &dims)
+{
+    float voxelSize = volumeSpacing(dims).x;
+    return {-0.5f * voxelSize * dims.x,
+            -0.5f * voxelSize * dims.y,
+            -0.5f * voxelSize * dims.z};
+}
+
+
+OSPData newSharedVoxelData(const VoxelArray &voxels)
+{
+    return profiledSharedData3D(voxels.voxels, ospVoxelType(voxels.type),
+                                voxels.dims.x, voxels.dims.y, voxels.dims.z);
+}
+
+
+VolumeSource::VolumeSource(int argc, const char **argv)
+    : array{nullptr, VOXEL_FLOAT, {0, 0, 0}}
+{
+    VolumeFileOptions fileOptions = parseVolumeFileOptions(argc, argv);
+
+    VoxelType storageType = parseStorageVoxelType(argc, argv);
+    bool quantizing = storageType != VOXEL_FLOAT;
+
+    StartupProfiler::Scope scope(STARTUP_DATA);
+
+    VoxelArray voxels;
+    if (!fileOptions.fileName.empty())
+    {
+        mapped.reset(new MappedVolume(fileOptions));
+        if (!mapped->ok())
+            return;
+        voxels = mapped->voxels();
+        what   = mapped->description();
+    }
+    else
+    {
+        VolumeGenOptions genOptions = parseVolumeGenOptions(argc, argv);
+        generated = allocateVoxels(genOptions.dims.count());
+        generateVolume(genOptions.field, genOptions.dims, generated.get());
+        voxels = {generated.get(), VOXEL_FLOAT, genOptions.dims};
+        what   = volumeGenDescription(genOptions);
+    }
+
+    HistogramOptions histogramOptions = parseHistogramOptions(argc, argv);
+    if (histogramOptions.enabled())
+        histogram.reset(new VoxelHistogram(voxels));
+
+    if (fileOptions.haveValueRange)
+    {
+        range[0] = fileOptions.valueRange[0];
+        range[1] = fileOptions.valueRange[1];
+    }
+    else if (histogram)
+    {
+        range[0] = histogram->percentile(histogramOptions.percentiles[0]);
+        range[1] = histogram->percentile(histogramOptions.percentiles[1]);
+    }
+    else
+    {
+        voxelRange(voxels, range[0], range[1]);
+    }
+
+    if (histogram)
+    {
+        const double gb = 1024.0 * 1024.0 * 1024.0;
+        printf("Histogram of %zu voxels in %.1f ms (%.1f ms/GB): range %g:%g from "
+               "percentiles %g:%g of %g:%g\n",
+               (size_t)histogram->total(), 1000.0 * histogram->seconds(),
+               1000.0 * histogram->seconds() / (voxels.bytes() / gb),
+               range[0], range[1], histogramOptions.percentiles[0],
+               histogramOptions.percentiles[1], histogram->minValue(),
+               histogram->maxValue());
+
+        histogramRange = range;
+        if (!histogramOptions.emptyBins)
+            histogram.reset();
+
+        char summary[128];
+        snprintf(summary, sizeof(summary), ", range %g:%g%s", range[0], range[1],
+                 histogramOptions.emptyBins ? " without empty bins" : "");
+        what += summary;
+    }
+
+    array = voxels;
+
+    if (quantizing && storageType != array.type)
+        quantize(storageType);
+}
+
+
+std::vector<float> VolumeSource::opacities(const std::vector<float> &base) const
+{
+    if (!histogram)
+        return base;
+    return histogram->emptyBinOpacities(base, histogramRange.x, histogramRange.y);
+}
+
+
+void VolumeSource::quantize(VoxelType type)
+{
+    VoxelArray output = {nullptr, type, array.dims};
+    quantized.reset(new unsigned char[output.bytes()]);
+    output.voxels = quantized.get();
+
+    QuantizeStats stats;
+    quantizeVoxels(array, range[0], range[1], type, quantized.get(), &stats);
+
+    const double mb = 1024.0 * 1024.0;
+    printf("Quantized %s voxels to %s in %.3f s: %.1f MB -> %.1f MB (%.1f MB saved), "
+           "max error %g (%.3g%% of the value range)\n",
+           voxelTypeName(array.type), voxelTypeName(type), stats.seconds,
+           array.bytes() / mb, output.bytes() / mb,
+           (array.bytes() - output.bytes()) / mb, stats.maxError,
+           range[1] > range[0] ? 100.0 * stats.maxError / (range[1] - range[0]) : 0.0);
+
+    // Only the quantized voxels are needed from here on.
+    generated.reset();
+    mapped.reset();
+
+    array = output;
+    range[0] = 0.0f;
+    range[1] = quantizedMax(type);
+    what += std::string(" as ") + voxelTypeName(type);
+}
+
@@ -0,0 +1,105 @@
+//
+// The voxels a structured volume demo renders: generated in memory
+// (see volumeGen.h) or mapped from a raw or BOV file (see
+// volumeFile.h), chosen on the command line. With
+//
+//   --voxel-type TYPE   uint8 or uint16
+//
+// the voxels are quantized to the smaller type before they go to
+// OSPRay, and the value range becomes that type's full range (not with
+// --bricks; see brickedVolume.h). The histogram options (see
+// voxelHistogram.h) pick the value range from percentiles and leave
+// empty value ranges out of the opacities.
+//
+
+#ifndef OSPRAY_DEMOS_VOLUME_SOURCE_H
+#define OSPRAY_DEMOS_VOLUME_SOURCE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ospray/ospray.h"
+#include "ospray/ospray_cpp.h"
+
+#include "volumeFile.h"
+#include "volumeGen.h"
+#include "voxelHistogram.h"
+
+OSPDataType ospVoxelType(VoxelType type);
+
+//
+// The type --voxel-type asks voxels to be stored as, uint8 or uint16,
+// or VOXEL_FLOAT to keep them as they are.
+//
+VoxelType parseStorageVoxelType(int argc, const char **argv);
+
+//
+// Grid spacing and origin that center a volume of dims voxels on
+// 0, 0, 0 and make its longest side 10 units, whatever its resolution.
+//
+ospcommon::math::vec3f volumeSpacing(const VolumeDims &dims);
+ospcommon::math::vec3f volumeOrigin(const VolumeDims &dims);
+
+//
+// A 3D data array sharing voxels, which must outlive it. The caller
+// owns the handle.
+//
+OSPData newSharedVoxelData(const VoxelArray &voxels);
+
+class VolumeSource
+{
+  public:
+    //
+    // Generate or map the voxels from the options in argv, and find
+    // their value range unless --value-range gives it. Quantizing
+    // prints the memory saved and the largest error, and histogramming
+    // how long it took. Check ok() after.
+    //
+    VolumeSource(int argc, const char **argv);
+
+    bool ok() const { return array.voxels != nullptr; }
+
+    const VoxelArray &voxels() const { return array; }
+
+    ospcommon::math::vec2f valueRange() const { return range; }
+
+    //
+    // The transfer function opacities to use in place of base, spaced
+    // evenly over valueRange() like base: base itself, or with
+    // --empty-bins base resampled with zeros where no voxels lie.
+    //
+    std::vector<float> opacities(const std::vector<float> &base) const;
+
+    //
+    // volumeSpacing and volumeOrigin of the voxels.
+    //
+    ospcommon::math::vec3f spacing() const { return volumeSpacing(array.dims); }
+    ospcommon::math::vec3f origin() const { return volumeOrigin(array.dims); }
+
+    //
+    // What the voxels are, for scene keys: the field and size, or the
+    // file, its size, type and modification time.
+    //
+    const std::string &description() const { return what; }
+
+    //
+    // A 3D data array sharing the voxels, which outlive it as long as
+    // this source does. The caller owns the handle.
+    //
+    OSPData newSharedData() const { return newSharedVoxelData(array); }
+
+  private:
+    void quantize(VoxelType type);
+
+    std::unique_ptr<float[]>         generated;
+    std::unique_ptr<MappedVolume>    mapped;
+    std::unique_ptr<unsigned char[]> quantized;
+    std::unique_ptr<VoxelHistogram>  histogram;
+    ospcommon::math::vec2f           histogramRange;
+    VoxelArray                       array;
+    ospcommon::math::vec2f           range;
+    std::string                      what;
+};
+
+#endif
@@ -8,7 +8,6 @@
 
 #include <memory>
 #include <random>
-#include <alloca.h>
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
@@ -17,132 +16,22 @@
 #include "ospray/ospray.h"
 #include "ospray/ospray_cpp.h"
 
-//
-// Helper function to write the rendered image as PPM file.
-// Taken from opsray examples.
-//
-void writePPM(const char *fileName,
-              const ospcommon::math::vec2i &size,
-              const uint32_t *pixel)
-{
-    FILE *file = fopen(fileName, "wb");
-    if(file == nullptr) 
-    {
-        fprintf(stderr, "fopen('%s', 'wb') failed: %d", fileName, errno);
-        return;
-    }
-    fprintf(file, "P6\n%i %i\n255\n", size.x, size.y);
-    unsigned char *out = (unsigned char *)alloca(3*size.x);
-    for (int y = 0; y < size.y; y++) 
-    {
-        const unsigned char *in = (const unsigned char *)&pixel[(size.y-1-y)*size.x];
-        for (int x = 0; x < size.x; x++) 
-        {
-            out[3*x + 0] = in[4*x + 0];
-            out[3*x + 1] = in[4*x + 1];
-            out[3*x + 2] = in[4*x + 2];
-        }
-        fwrite(out, 3*size.x, sizeof(char), file);
-    }
-    fprintf(file, "\n");
-    fclose(file);
-}
-
-//
-// Generate frames for a movie.
-//
-void makeMovieFrames(ospray::cpp::World world,
-                     ospcommon::math::vec3f camPos,
-                     ospcommon::math::vec3f camView, 
-                     ospcommon::math::vec3f objCent, 
-                     ospcommon::math::vec2i imgSize, 
-                     ospray::cpp::Renderer renderer,
-                     ospray::cpp::Camera camera,
-                     float stepSize = 1.0)
-{
-
-   // create and setup framebuffer
-    ospray::cpp::FrameBuffer framebuffer(
-        imgSize, OSP_FB_SRGBA, OSP_FB_COLOR | OSP_FB_ACCUM);
-    framebuffer.clear();
-
-
-    float zposLow  = camPos.z;
-    float zposHigh = -1.0 * zposLow;
-    float zposCur  = zposLow;
-    float zInc     = stepSize;
-    int fIdx       = 0;
-    int rSqr       = zposHigh * zposHigh;
-
-    while (zposCur < zposHigh)
-    {
-        char fName[128];
-        sprintf(fName, "frames/frame_%i.ppm", fIdx++);
-
-        framebuffer.renderFrame(renderer, camera, world);
-
-        uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
-        writePPM(fName, imgSize, fb);
-        framebuffer.unmap(fb);
-        framebuffer.clear();
-
-        zposCur += zInc;
-        printf("\nX: %f, Z: %f", camPos.x, camPos.z);
-
-        camPos.z = zposCur;
-        float xsqr = rSqr - (zposCur * zposCur);
-
-        if (xsqr <= 0.0)
-            camPos.x = 0.0;
-        else
-            camPos.x = sqrt(xsqr);
-
-        camView.x = objCent.x - camPos.x;
-        camView.y = objCent.y - camPos.y;
-        camView.z = objCent.z - camPos.z;
-
-        camera.setParam("position", camPos);
-        camera.setParam("direction", camView);
-        camera.commit();
-    }
-
-    while (zposCur > zposLow)
-    {
-        char fName[128];
-        sprintf(fName, "frames/frame_%i.ppm", fIdx++);
-
-        framebuffer.renderFrame(renderer, camera, world);
-
-        uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
-        writePPM(fName, imgSize, fb);
-        framebuffer.unmap(fb);
-        framebuffer.clear();
-
-        zposCur -= zInc;
-        printf("\nX: %f, Z: %f", camPos.x, camPos.z);
-
-        camPos.z = zposCur;
-        float xsqr = rSqr - (zposCur * zposCur);
-
-        if (xsqr <= 0.0)
-            camPos.x = 0.0;
-        else
-            camPos.x = -sqrt(xsqr);
-
-        camView.x = objCent.x - camPos.x;
-        camView.y = objCent.y - camPos.y;
-        camView.z = objCent.z - camPos.z;
-
-        camera.setParam("position", camPos);
-        camera.setParam("direction", camView);
-        camera.commit();
-    }
-}
+#include "movieFarm.h"
+#include "movieFrames.h"
+#include "poster.h"
+#include "qualityController.h"
+#include "sceneKey.h"
+#include "startupProfiler.h"
+#include "volumeSeries.h"
+#include "volumeSource.h"
 
 
 int main(int argc, const char **argv)
 {
-    OSPError init_error = ospInit(&argc, argv);
+    // Fork the farm workers, if asked to, before OSPRay starts any threads.
+    startMovieFarm(argc, argv);
+
+    OSPError init_error = profiledInit(&argc, argv);
     if (init_error != OSP_NO_ERROR)
         return init_error;
 
@@ -152,6 +41,11 @@ int main(int argc, const char **argv)
             exit(error);
         });
 
+    MovieOptions movieOptions = parseMovieOptions(argc, argv);
+    PosterOptions posterOptions = parsePosterOptions(argc, argv);
+    VolumeSeriesOptions seriesOptions = parseVolumeSeriesOptions(argc, argv);
+    QualityOptions qualityOptions = parseQualityOptions(argc, argv);
+
     {
         // Image size
         const ospcommon::math::vec2i imgSize {1024, 780};
@@ -169,44 +63,61 @@ int main(int argc, const char **argv)
         camera.setParam("position", camPos);
         camera.setParam("direction", camView);
         camera.setParam("up", cam_up);
-        camera.commit();
-
-        // Create our volume.
-        ospcommon::math::vec3ui dims {10, 10, 10};
-        ospcommon::math::vec3f spacing {1.0, 1.0, 1.0};
-
-        // Center the box at roughly 0, 0, 0.
-        ospcommon::math::vec3f origin { 
-                            (float)(-1.0 * (dims.x / 2.0)), 
-                            (float)(-1.0 * (dims.y / 2.0)),
-                            (float)(-1.0 * (dims.z / 2.0))
-                          };
-
-        int numVoxels = dims.product();
-        std::vector<float> voxels(numVoxels);
-
+        profiledCommit(camera.handle());
+
+        // Create our volume, generated or mapped from a file, or the
+        // first step of a time series. The voxels are shared rather
+        // than copied, and outlive the volume.
+        std::unique_ptr<VolumeSource> source;
+        std::unique_ptr<VolumeSeries> series;
+        VoxelArray voxels;
         ospcommon::math::vec2f range;
-        range[0] = FLT_MAX;
-        range[1] = -FLT_MAX;
-
-        float scalar = 0.0;
-        for (int i = 0; i < numVoxels; ++i)
+        std::string description;
+        int shown = 0;
+        if (seriesOptions.enabled())
+        {
+            series.reset(new VolumeSeries(seriesOptions, parseVolumeFileOptions(argc, argv),
+                                          parseStorageVoxelType(argc, argv),
+                                          parseHistogramOptions(argc, argv)));
+            if (!series->ok() || series->fetch(0) != shown)
+                return 1;
+
+            voxels = series->buffer(shown);
+            series->valueRange(shown, range[0], range[1]);
+            description = series->description();
+        }
+        else
         {
-           voxels[i] = scalar;
-           scalar += 0.987;
+            source.reset(new VolumeSource(argc, argv));
+            if (!source->ok())
+                return 1;
 
-           if (scalar < range[0])
-               range[0] = scalar; 
-           if (scalar > range[1])
-               range[1] = scalar; 
+            voxels = source->voxels();
+            range = source->valueRange();
+            description = source->description();
         }
 
-        // Create our volume.
+        ospcommon::math::vec3f spacing = volumeSpacing(voxels.dims);
+        ospcommon::math::vec3f origin  = volumeOrigin(voxels.dims);
+
+        // What the frame cache knows about the scene, added to as it is set.
+        SceneKey key("structuredVolumeCPP");
+        key.add("volume", description);
+
+        // A time series has two buffers, one being rendered while the
+        // next step is read into the other, and a data array for each.
+        std::vector<ospray::cpp::Data> voxelData;
+        voxelData.emplace_back(newSharedVoxelData(voxels));
+        if (series)
+            voxelData.emplace_back(newSharedVoxelData(series->buffer(1)));
+        for (ospray::cpp::Data &data : voxelData)
+            profiledCommit(data.handle());
+
         ospray::cpp::Volume volume("structuredRegular");
-        volume.setParam("data", ospray::cpp::Data(dims, voxels.data()));
+        volume.setParam("data", voxelData[shown]);
         volume.setParam("gridOrigin", origin);
         volume.setParam("gridSpacing", spacing);
-        volume.commit();
+        profiledCommit(volume.handle());
 
         // Set up the transfer function.
         std::vector<ospcommon::math::vec3f> colors = {
@@ -214,54 +125,120 @@ int main(int argc, const char **argv)
             {0.0, 1.0, 0.0},
             {0.0, 0.0, 1.0},
         };
-        std::vector<float> opacities = {0.0, 1.0};
+        const std::vector<float> baseOpacities = {0.0, 1.0};
+        std::vector<float> opacities = series ? series->opacities(shown, baseOpacities)
+                                              : source->opacities(baseOpacities);
 
         // Set up our transfer function.
         ospray::cpp::TransferFunction transferFunction("piecewiseLinear");
-        transferFunction.setParam("color", ospray::cpp::Data(colors));
-        transferFunction.setParam("opacity", ospray::cpp::Data(opacities));
-        transferFunction.setParam("valueRange", range);
-        transferFunction.commit();
+        ospray::cpp::Data colorData(profiledSharedData1D(colors.data(), OSP_VEC3F,
+                                                         colors.size()));
+        profiledCommit(colorData.handle());
+        transferFunction.setParam("color", colorData);
+
+        ospray::cpp::Data opacityData(profiledSharedData1D(opacities.data(), OSP_FLOAT,
+                                                           opacities.size()));
+        profiledCommit(opacityData.handle());
+        transferFunction.setParam("opacity", opacityData);
+
+        key.setFloats(transferFunction.handle(), "valueRange", OSP_VEC2F, &range[0], 2);
+        key.add("color", &colors[0].x, 3 * colors.size());
+        key.add("opacity", opacities);
+        profiledCommit(transferFunction.handle());
 
         // Set up our model.
         ospray::cpp::VolumetricModel model(volume);
         model.setParam("transferFunction", transferFunction);
-        model.commit();
+        profiledCommit(model.handle());
 
         // Create a group to house our model.
         ospray::cpp::Group group;
         group.setParam("volume", ospray::cpp::Data(model));
-        group.commit();
+        profiledCommit(group.handle());
 
         // Create our instance. 
         ospray::cpp::Instance instance(group);
-        instance.commit();
+        profiledCommit(instance.handle());
 
         // Create our world.
         ospray::cpp::World world;
         world.setParam("instance", ospray::cpp::Data(instance));
 
         // Create our light.
-        ospray::cpp::Light light("ambient");
-        light.commit();
+        const char *lightType = "ambient";
+        ospray::cpp::Light light(lightType);
+        key.add("light", lightType);
+        profiledCommit(light.handle());
 
         world.setParam("light", ospray::cpp::Data(light));
-        world.commit();
+        profiledCommit(world.handle());
 
         // Create our renderer.
-        ospray::cpp::Renderer renderer("pathtracer");
-        renderer.setParam("pixelSamples", 5);
-        renderer.commit();
+        const char *rendererType = "pathtracer";
+        ospray::cpp::Renderer renderer(rendererType);
+        key.add("renderer", rendererType);
+        QualityController quality(renderer.handle(), qualityOptions, &key);
+        quality.setInt("pixelSamples", 5);
+        profiledCommit(renderer.handle());
+
+        // Play the series one step per frame, from the start again after
+        // the last, while the next step is read in the background. Only
+        // the volume's data and the step's value range and opacities
+        // change; the objects above them are committed again so OSPRay
+        // sees them.
+        if (series)
+        {
+            movieOptions.prepareFrame = [&](int frame, const CameraPose &)
+            {
+                int index = series->fetch(frame % series->steps());
+                if (index >= 0 && index != shown)
+                {
+                    volume.setParam("data", voxelData[index]);
+                    volume.commit();
+                    series->valueRange(index, range[0], range[1]);
+                    transferFunction.setParam("valueRange", range);
+                    opacities = series->opacities(index, baseOpacities);
+                    opacityData = ospray::cpp::Data(opacities);
+                    opacityData.commit();
+                    transferFunction.setParam("opacity", opacityData);
+                    transferFunction.commit();
+                    model.commit();
+                    group.commit();
+                    world.commit();
+                    shown = index;
+                }
+            };
+            movieOptions.prefetchFrame = [&](int frame)
+            {
+                series->prefetch(frame % series->steps());
+            };
+        }
+
+        movieOptions.sceneKey = key.str();
+        quality.attach(movieOptions);
 
         // Action.
-        makeMovieFrames(world,
-                        camPos, 
-                        camView, 
-                        objCent, 
-                        imgSize, 
-                        renderer,
-                        camera,
-                        2.0);
+        if (posterOptions.enabled())
+        {
+            renderPoster(world.handle(), renderer.handle(), camera.handle(), posterOptions);
+        }
+        else
+        {
+            makeMovieFrames(world.handle(),
+                            camPos, 
+                            camView, 
+                            cam_up,
+                            objCent, 
+                            imgSize, 
+                            renderer.handle(),
+                            camera.handle(),
+                            2.0,
+                            movieOptions);
+            quality.printSummary();
+        }
+
+        if (series)
+            series->printSummary();
     };
     // In the CPP interface, variables are release when the leave scope.
 
@@ -8,7 +8,6 @@
 
 #include <memory>
 #include <random>
-#include <alloca.h>
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
@@ -17,132 +16,22 @@
 #include "ospray/ospray.h"
 #include "ospray/ospray_cpp.h"
 
-//
-// Helper function to write the rendered image as PPM file.
-// Taken from opsray examples.
-//
-void writePPM(const char *fileName,
-              const ospcommon::math::vec2i &size,
-              const uint32_t *pixel)
-{
-    FILE *file = fopen(fileName, "wb");
-    if(file == nullptr) 
-    {
-        fprintf(stderr, "fopen('%s', 'wb') failed: %d", fileName, errno);
-        return;
-    }
-    fprintf(file, "P6\n%i %i\n255\n", size.x, size.y);
-    unsigned char *out = (unsigned char *)alloca(3*size.x);
-    for (int y = 0; y < size.y; y++) 
-    {
-        const unsigned char *in = (const unsigned char *)&pixel[(size.y-1-y)*size.x];
-        for (int x = 0; x < size.x; x++) 
-        {
-            out[3*x + 0] = in[4*x + 0];
-            out[3*x + 1] = in[4*x + 1];
-            out[3*x + 2] = in[4*x + 2];
-        }
-        fwrite(out, 3*size.x, sizeof(char), file);
-    }
-    fprintf(file, "\n");
-    fclose(file);
-}
-
-//
-// Generate frames for a movie.
-//
-void makeMovieFrames(ospray::cpp::World world,
-		     ospcommon::math::vec3f camPos,
-		     ospcommon::math::vec3f camView, 
-		     ospcommon::math::vec3f objCent, 
-		     ospcommon::math::vec2i imgSize, 
-		     ospray::cpp::Renderer renderer,
-		     ospray::cpp::Camera camera,
-		     float stepSize = 1.0)
-{
-
-   // create and setup framebuffer
-    ospray::cpp::FrameBuffer framebuffer(
-	imgSize, OSP_FB_SRGBA, OSP_FB_COLOR | OSP_FB_ACCUM);
-    framebuffer.clear();
-
-
-    float zposLow  = camPos.z;
-    float zposHigh = -1.0 * zposLow;
-    float zposCur  = zposLow;
-    float zInc     = stepSize;
-    int fIdx       = 0;
-    int rSqr       = zposHigh * zposHigh;
-
-    while (zposCur < zposHigh)
-    {
-	char fName[128];
-	sprintf(fName, "frames/frame_%i.ppm", fIdx++);
-
-	framebuffer.renderFrame(renderer, camera, world);
-
-	uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
-	writePPM(fName, imgSize, fb);
-	framebuffer.unmap(fb);
-	framebuffer.clear();
-
-	zposCur += zInc;
-	printf("\nX: %f, Z: %f", camPos.x, camPos.z);
-
-	camPos.z = zposCur;
-	float xsqr = rSqr - (zposCur * zposCur);
-
-	if (xsqr <= 0.0)
-	    camPos.x = 0.0;
-	else
-	    camPos.x = sqrt(xsqr);
-
-	camView.x = objCent.x - camPos.x;
-	camView.y = objCent.y - camPos.y;
-	camView.z = objCent.z - camPos.z;
-
-	camera.setParam("position", camPos);
-	camera.setParam("direction", camView);
-	camera.commit();
-    }
-
-    while (zposCur > zposLow)
-    {
-	char fName[128];
-	sprintf(fName, "frames/frame_%i.ppm", fIdx++);
-
-	framebuffer.renderFrame(renderer, camera, world);
-
-	uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
-	writePPM(fName, imgSize, fb);
-	framebuffer.unmap(fb);
-	framebuffer.clear();
-
-	zposCur -= zInc;
-	printf("\nX: %f, Z: %f", camPos.x, camPos.z);
-
-	camPos.z = zposCur;
-	float xsqr = rSqr - (zposCur * zposCur);
-
-	if (xsqr <= 0.0)
-	    camPos.x = 0.0;
-	else
-	    camPos.x = -sqrt(xsqr);
-
-	camView.x = objCent.x - camPos.x;
-	camView.y = objCent.y - camPos.y;
-	camView.z = objCent.z - camPos.z;
-
-	camera.setParam("position", camPos);
-	camera.setParam("direction", camView);
-	camera.commit();
-    }
-}
+#include "meshReorder.h"
+#include "meshVolume.h"
+#include "movieFarm.h"
+#include "movieFrames.h"
+#include "poster.h"
+#include "qualityController.h"
+#include "sceneKey.h"
+#include "startupProfiler.h"
 
 
 int main(int argc, const char **argv)
 {
-    OSPError initError = ospInit(&argc, argv);
+    // Fork the farm workers, if asked to, before OSPRay starts any threads.
+    startMovieFarm(argc, argv);
+
+    OSPError initError = profiledInit(&argc, argv);
     if (initError != OSP_NO_ERROR)
         return initError;
 
@@ -152,7 +41,39 @@ int main(int argc, const char **argv)
             exit(error);
         });
 
+    MovieOptions movieOptions = parseMovieOptions(argc, argv);
+    PosterOptions posterOptions = parsePosterOptions(argc, argv);
+    QualityOptions qualityOptions = parseQualityOptions(argc, argv);
+    MeshFileOptions meshOptions = parseMeshFileOptions(argc, argv);
+    MeshOrderOptions orderOptions = parseMeshOrderOptions(argc, argv);
+    if (orderOptions.enabled() && !meshOptions.enabled())
     {
+        fprintf(stderr, "--mesh-order needs a --mesh to reorder\n");
+        return 1;
+    }
+
+    {
+        // A mesh file, if given, replaces the cells below.
+        UnstructuredMesh mesh;
+        if (meshOptions.enabled())
+        {
+            if (!readMeshFile(meshOptions, mesh))
+                return 1;
+            printf("Read %s: %zu vertices, %zu cells, field '%s' per %s in %.2f s "
+                   "(%.2f s decoding)\n",
+                   meshOptions.fileName.c_str(), mesh.vertices(), mesh.cells(),
+                   mesh.fieldName.c_str(), mesh.cellValues ? "cell" : "vertex",
+                   mesh.readSeconds, mesh.decodeSeconds);
+
+            if (orderOptions.enabled())
+            {
+                double seconds = reorderMesh(mesh, orderOptions.order);
+                printf("Reordered %zu cells and %zu vertices along a %s curve in %.1f ms\n",
+                       mesh.cells(), mesh.vertices(), meshOrderName(orderOptions.order),
+                       1000.0 * seconds);
+            }
+        }
+
         // Image size
         const ospcommon::math::vec2i imgSize {1024, 780};
 
@@ -170,7 +91,7 @@ int main(int argc, const char **argv)
         ospSetParam(camera, "position", OSP_VEC3F, camPos);
         ospSetParam(camera, "direction", OSP_VEC3F, camView);
         ospSetParam(camera, "up", OSP_VEC3F, camUp);
-        ospCommit(camera);
+        profiledCommit(camera);
 
         //
         // Just imagine vertex 8 forms a pyramid with 1, 2, 5, 6....
@@ -229,15 +150,54 @@ int main(int argc, const char **argv)
         ospcommon::math::vec2f range;
         range[0] = cellData[0];
         range[1] = cellData.back();
+        if (meshOptions.enabled())
+            range = meshValueRange(mesh, argc, argv);
+
+        // What the frame cache knows about the scene, added to as it is set.
+        SceneKey key("unstructuredVolumeCPP");
 
         // Create our volume.
         ospray::cpp::Volume volume("unstructured");
-        volume.setParam("vertex.position", ospray::cpp::Data(vertexPositions));
-        volume.setParam("index", ospray::cpp::Data(indices));
-        volume.setParam("cell.index", ospray::cpp::Data(cellStarts));
-        volume.setParam("cell.data", ospray::cpp::Data(cellData));
-        volume.setParam("cell.type", ospray::cpp::Data(cellTypes));
-        volume.commit(); 
+        // A mesh file replaces the built-in cells.
+        if (meshOptions.enabled())
+        {
+            setMeshVolumeParams(volume.handle(), mesh);
+            key.add("mesh", mesh.description);
+        }
+        else
+        {
+            key.add("vertex.position", &vertexPositions[0].x, 3 * vertexPositions.size());
+            key.add("index", indices);
+            key.add("cell.index", cellStarts);
+            key.add("cell.type", cellTypes);
+            key.add("cell.data", cellData);
+
+            ospray::cpp::Data vertexPosData(profiledSharedData1D(vertexPositions.data(),
+                OSP_VEC3F, vertexPositions.size()));
+            profiledCommit(vertexPosData.handle());
+            volume.setParam("vertex.position", vertexPosData);
+
+            ospray::cpp::Data indexData(profiledSharedData1D(indices.data(),
+                OSP_UINT, indices.size()));
+            profiledCommit(indexData.handle());
+            volume.setParam("index", indexData);
+
+            ospray::cpp::Data cellStartData(profiledSharedData1D(cellStarts.data(),
+                OSP_UINT, cellStarts.size()));
+            profiledCommit(cellStartData.handle());
+            volume.setParam("cell.index", cellStartData);
+
+            ospray::cpp::Data ospCellData(profiledSharedData1D(cellData.data(),
+                OSP_FLOAT, cellData.size()));
+            profiledCommit(ospCellData.handle());
+            volume.setParam("cell.data", ospCellData);
+
+            ospray::cpp::Data cellTypeData(profiledSharedData1D(cellTypes.data(),
+                OSP_UCHAR, cellTypes.size()));
+            profiledCommit(cellTypeData.handle());
+            volume.setParam("cell.type", cellTypeData);
+        }
+        profiledCommit(volume.handle());
 
         // Set up the transfer function.
         std::vector<ospcommon::math::vec3f> colors = {
@@ -249,53 +209,87 @@ int main(int argc, const char **argv)
 
         // Set up our transfer function.
         ospray::cpp::TransferFunction transferFunction("piecewiseLinear");
-        transferFunction.setParam("color", ospray::cpp::Data(colors));
-        transferFunction.setParam("opacity", ospray::cpp::Data(opacities));
-        transferFunction.setParam("valueRange", range);
-        transferFunction.commit();
+        ospray::cpp::Data colorData(profiledSharedData1D(colors.data(), OSP_VEC3F,
+                                                         colors.size()));
+        profiledCommit(colorData.handle());
+        transferFunction.setParam("color", colorData);
+
+        ospray::cpp::Data opacityData(profiledSharedData1D(opacities.data(), OSP_FLOAT,
+                                                           opacities.size()));
+        profiledCommit(opacityData.handle());
+        transferFunction.setParam("opacity", opacityData);
+
+        key.setFloats(transferFunction.handle(), "valueRange", OSP_VEC2F, &range[0], 2);
+        key.add("color", &colors[0].x, 3 * colors.size());
+        key.add("opacity", opacities);
+        profiledCommit(transferFunction.handle());
 
         // Set up our model.
         ospray::cpp::VolumetricModel model(volume);
         model.setParam("transferFunction", transferFunction);
-        model.commit();
+        profiledCommit(model.handle());
 
         // Create a group to house our model.
         ospray::cpp::Group group;
         group.setParam("volume", ospray::cpp::Data(model));
-        group.commit();
+        profiledCommit(group.handle());
 
         // Create our instance. 
         ospray::cpp::Instance instance(group);
-        instance.commit();
+        // Fit a mesh file to the box the camera orbits.
+        if (meshOptions.enabled())
+            fitMeshInstance(instance.handle(), mesh, 2.0f);
+        profiledCommit(instance.handle());
 
         // Create our world.
         ospray::cpp::World world;
         world.setParam("instance", ospray::cpp::Data(instance));
 
         // Create our light.
-        ospray::cpp::Light light("ambient");
-        light.commit();
+        const char *lightType = "ambient";
+        ospray::cpp::Light light(lightType);
+        key.add("light", lightType);
+        profiledCommit(light.handle());
 
         world.setParam("light", ospray::cpp::Data(light));
-        world.commit();
+        profiledCommit(world.handle());
 
         // Create our renderer.
-        ospray::cpp::Renderer renderer("scivis");
-        renderer.setParam("backgroundColor", 1.0f);
-        renderer.setParam("aoSamples", 100);
-        renderer.setParam("aoIntensity", 10000.0f);
-        renderer.setParam("volumeSamplingRate", 30.0f);
-        renderer.commit();
+        const char *rendererType = "scivis";
+        ospray::cpp::Renderer renderer(rendererType);
+        key.add("renderer", rendererType);
+        key.setFloat(renderer.handle(), "backgroundColor", 1.0f);
+        QualityController quality(renderer.handle(), qualityOptions, &key);
+        quality.setInt("pixelSamples", 1);
+        quality.setInt("aoSamples", 100);
+        key.setFloat(renderer.handle(), "aoIntensity", 10000.0f);
+        quality.setFloat("volumeSamplingRate", 30.0f);
+        profiledCommit(renderer.handle());
+
+        movieOptions.sceneKey = key.str();
+        quality.attach(movieOptions);
 
         // Action.
-        makeMovieFrames(world,
-                        camPos, 
-                        camView, 
-                        objCent, 
-                        imgSize, 
-                        renderer,
-                        camera,
-                        0.3);
+        if (posterOptions.enabled())
+        {
+            renderPoster(world.handle(), renderer.handle(), camera, posterOptions);
+        }
+        else
+        {
+            makeMovieFrames(world.handle(),
+                            camPos, 
+                            camView, 
+                            camUp,
+                            objCent, 
+                            imgSize, 
+                            renderer.handle(),
+                            camera,
+                            0.3,
+                            movieOptions);
+            quality.printSummary();
+        }
+
+        ospRelease(camera);
     };
 
     ospShutdown();